@@ -1,5 +1,6 @@
 #include "application.hpp"
 #include "utils/file_io.hpp"
+#include "utils/profiler.hpp"
 
 
 Application::Application() 
@@ -15,7 +16,7 @@ Application::Application()
         auto entity = scene->create_entity("sponza model");
         entity.add_component<TransformComponent>().scale = glm::vec3(0.01f);
         auto& mesh_component = entity.add_component<MeshComponent>();
-        mesh_component.model = std::make_shared<Model>(context.device, "assets/Sponza/glTF/Sponza.gltf");
+        mesh_component.model = context.model_loader->load("assets/Sponza/glTF/Sponza.gltf");
         //mesh_component.model = std::make_shared<Model>(context.device, "assets/old_sponza/old_sponza.gltf");
     }
 
@@ -24,7 +25,7 @@ Application::Application()
         entity.add_component<TransformComponent>();
 
         auto& mesh_component = entity.add_component<MeshComponent>();
-        mesh_component.model = std::make_shared<Model>(context.device, "assets/DamagedHelmet/glTF/DamagedHelmet.gltf");
+        mesh_component.model = context.model_loader->load("assets/DamagedHelmet/glTF/DamagedHelmet.gltf");
     }
 
     // {
@@ -37,129 +38,122 @@ Application::Application()
 
     controlled_camera.update(window, delta_time);
     scene->update(delta_time);
-
-    glm::vec2 jitter_vec2 = [this]() -> glm::vec2 {
-        glm::vec2 jitter_scale = {1.0f/f32(window.get_width()), 1.0f/f32(window.get_height())};
-        f32 g = 1.32471795724474602596f;
-        f32 a1 = 1.0f / g;
-        f32 a2 = 1.0f / (g * g);
-
-        glm::vec2 jitter = {
-            glm::mod(0.5f + a1 * (static_cast<f32>(jitter_index) + 1.0f), 1.0f) - 0.5f,
-            glm::mod(0.5f + a2 * (static_cast<f32>(jitter_index) + 1.0f), 1.0f) - 0.5f
-        };
-        jitter = jitter * jitter_scale;
-        jitter_index = (jitter_index + 1) % 32; 
-
-        return jitter;
-    }();
-
-    glm::mat4 projection_matrix = controlled_camera.camera.proj_mat;
-    projection_matrix[3][0] += jitter_vec2.x;
-    projection_matrix[3][1] += jitter_vec2.y;
-
-    glm::mat4 inverse_projection_matrix = glm::inverse(projection_matrix);
-    glm::mat4 inverse_view_matrix = glm::inverse(controlled_camera.camera.view_mat);
-    glm::mat4 projection_view_matrix = projection_matrix * controlled_camera.camera.view_mat;
-    glm::mat4 inverse_projection_view = inverse_projection_matrix * inverse_view_matrix;
-    glm::vec4 terrain_y_clip_trick = projection_view_matrix * glm::vec4{0.0f, 1.0f, 0.0f, 0.0f};
-
-    this->context.shader_global_block.globals.camera_projection_matrix = *reinterpret_cast<f32mat4x4*>(&projection_matrix);
-    this->context.shader_global_block.globals.camera_inverse_projection_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_projection_matrix);
-    this->context.shader_global_block.globals.camera_view_matrix = *reinterpret_cast<f32mat4x4*>(&controlled_camera.camera.view_mat);
-    this->context.shader_global_block.globals.camera_inverse_view_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_view_matrix);
-    this->context.shader_global_block.globals.camera_projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&projection_view_matrix);
-    this->context.shader_global_block.globals.camera_inverse_projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_projection_view);
-    this->context.shader_global_block.globals.terrain_y_clip_trick = *reinterpret_cast<f32vec4*>(&terrain_y_clip_trick);
-
-    this->context.shader_global_block.globals.camera_previous_projection_matrix = *reinterpret_cast<f32mat4x4*>(&projection_matrix);
-    this->context.shader_global_block.globals.camera_previous_inverse_projection_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_projection_matrix);
-    this->context.shader_global_block.globals.camera_previous_view_matrix = *reinterpret_cast<f32mat4x4*>(&controlled_camera.camera.view_mat);
-    this->context.shader_global_block.globals.camera_previous_inverse_view_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_view_matrix);
-    this->context.shader_global_block.globals.camera_previous_projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&projection_view_matrix);
-    this->context.shader_global_block.globals.camera_previous_inverse_projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_projection_view);
-    this->context.shader_global_block.globals.terrain_previous_y_clip_trick = *reinterpret_cast<f32vec4*>(&terrain_y_clip_trick);
-
-    this->context.shader_global_block.globals.jitter = *reinterpret_cast<f32vec2*>(&jitter_vec2);
-    this->context.shader_global_block.globals.previous_jitter = *reinterpret_cast<f32vec2*>(&jitter_vec2);
+    renderer.init_globals(controlled_camera.camera, controlled_camera.position);
 }
 
 Application::~Application() {}
 
 auto Application::run() -> i32 {
+    Profiler::set_thread_name("main thread");
+
     while(!window.window_state->close_requested) {
+        Profiler::new_frame();
+        PROFILE_SCOPE("frame");
+
         auto new_time_point = std::chrono::steady_clock::now();
         this->delta_time = std::chrono::duration_cast<std::chrono::duration<float, std::chrono::milliseconds::period>>(new_time_point - this->last_time_point).count() * 0.001f;
         this->last_time_point = new_time_point;
         window.update();
 
+        if(window.key_just_pressed(Key::F9)) {
+            Profiler::capture_frames(profile_capture_frame_count, "profile_capture.json");
+        }
+
+        if(window.key_just_pressed(Key::F10)) {
+            toggle_camera_path_recording();
+        }
+
+        // gpu times come back frames in flight frames late, the path is held on its last frame until they are all in
+        u32 frames_in_flight = context.frames_in_flight;
+        if(replaying_camera_path) {
+            this->delta_time = camera_path.time_step;
+            if(replay_frame == static_cast<u32>(camera_path.frames.size()) + frames_in_flight) {
+                finish_camera_path_replay();
+                break;
+            }
+        }
+
         if(window.window_state->resize_requested) {
             renderer.window_resized();
             controlled_camera.camera.resize(static_cast<i32>(window.get_width()), static_cast<i32>(window.get_height()));
             window.window_state->resize_requested = false;
         }
 
+        if(!renderer.begin_frame()) { continue; }
+
+        if(replaying_camera_path && replay_frame >= frames_in_flight && replay_frame - frames_in_flight < camera_path.frames.size()) {
+            frame_time_report.add_gpu_time(context.gpu_metric_pool->frame_time_elapsed);
+        }
+
+        auto cpu_start = std::chrono::steady_clock::now();
         update();
         renderer.render();
+
+        if(replaying_camera_path) {
+            if(replay_frame < camera_path.frames.size()) {
+                frame_time_report.add_cpu_time(std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - cpu_start).count());
+            }
+            replay_frame++;
+        }
     }
 
     return 0;
 }
 
 void Application::update() {
-    controlled_camera.update(window, delta_time);
+    PROFILE_FUNCTION();
+    if(replaying_camera_path) {
+        const auto& frame = camera_path.frames[std::min<usize>(replay_frame, camera_path.frames.size() - 1)];
+        controlled_camera.position = frame.position;
+        controlled_camera.rotation = frame.rotation;
+        controlled_camera.update_view();
+        renderer.jitter_index = frame.jitter_index;
+    } else {
+        controlled_camera.update(window, delta_time);
+    }
+
+    if(recording_camera_path) {
+        camera_path.frames.push_back(CameraPathFrame {
+            .position = controlled_camera.position,
+            .rotation = controlled_camera.rotation,
+            .jitter_index = renderer.jitter_index
+        });
+    }
+
+    renderer.begin_occlusion_culling(controlled_camera.camera, controlled_camera.position);
     scene->update(delta_time);
+    renderer.update_globals(controlled_camera.camera, controlled_camera.position, delta_time);
+}
+
+void Application::toggle_camera_path_recording() {
+    if(replaying_camera_path) { return; }
+
+    if(recording_camera_path) {
+        recording_camera_path = false;
+        camera_path.save(camera_path_file);
+        std::cout << "recorded " << camera_path.frames.size() << " frames to " << camera_path_file << std::endl;
+    } else {
+        camera_path = {};
+        recording_camera_path = true;
+        std::cout << "recording camera path to " << camera_path_file << std::endl;
+    }
+}
+
+void Application::start_camera_path_replay(const std::string& file_path) {
+    camera_path = CameraPath::load(file_path);
+    if(camera_path.frames.empty()) {
+        throw std::runtime_error("camera path has no frames: " + file_path);
+    }
+
+    recording_camera_path = false;
+    replaying_camera_path = true;
+    replay_frame = 0;
+    frame_time_report = {};
+}
 
-    glm::vec2 jitter_vec2 = [this]() -> glm::vec2 {
-        glm::vec2 jitter_scale = {1.0f/f32(window.get_width()), 1.0f/f32(window.get_height())};
-        f32 g = 1.32471795724474602596f;
-        f32 a1 = 1.0f / g;
-        f32 a2 = 1.0f / (g * g);
-
-        glm::vec2 jitter = {
-            glm::mod(0.5f + a1 * (static_cast<f32>(jitter_index) + 1.0f), 1.0f) - 0.5f,
-            glm::mod(0.5f + a2 * (static_cast<f32>(jitter_index) + 1.0f), 1.0f) - 0.5f
-        };
-        jitter = jitter * jitter_scale;
-        jitter_index = (jitter_index + 1) % 32; 
-
-        return jitter;
-    }();
-
-    glm::mat4 projection_matrix = controlled_camera.camera.proj_mat;
-    projection_matrix[3][0] += jitter_vec2.x;
-    projection_matrix[3][1] += jitter_vec2.y;
-    
-    glm::mat4 inverse_projection_matrix = glm::inverse(projection_matrix);
-    glm::mat4 inverse_view_matrix = glm::inverse(controlled_camera.camera.view_mat);
-    glm::mat4 projection_view_matrix = projection_matrix * controlled_camera.camera.view_mat;
-    glm::mat4 inverse_projection_view = inverse_projection_matrix * inverse_view_matrix;
-    glm::vec4 terrain_y_clip_trick = projection_view_matrix * glm::vec4{0.0f, 1.0f, 0.0f, 0.0f};
-
-    this->context.shader_global_block.globals.camera_previous_projection_matrix = this->context.shader_global_block.globals.camera_projection_matrix;
-    this->context.shader_global_block.globals.camera_previous_inverse_projection_matrix = this->context.shader_global_block.globals.camera_inverse_projection_matrix;
-    this->context.shader_global_block.globals.camera_previous_view_matrix = this->context.shader_global_block.globals.camera_view_matrix;
-    this->context.shader_global_block.globals.camera_previous_inverse_view_matrix = this->context.shader_global_block.globals.camera_inverse_view_matrix;
-    this->context.shader_global_block.globals.camera_previous_projection_view_matrix = this->context.shader_global_block.globals.camera_projection_view_matrix;
-    this->context.shader_global_block.globals.camera_previous_inverse_projection_view_matrix = this->context.shader_global_block.globals.camera_inverse_projection_view_matrix;
-    this->context.shader_global_block.globals.terrain_previous_y_clip_trick = this->context.shader_global_block.globals.terrain_y_clip_trick;
-    this->context.shader_global_block.globals.previous_jitter = this->context.shader_global_block.globals.jitter;
-
-    this->context.shader_global_block.globals.camera_projection_matrix = *reinterpret_cast<f32mat4x4*>(&projection_matrix);
-    this->context.shader_global_block.globals.camera_inverse_projection_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_projection_matrix);
-    this->context.shader_global_block.globals.camera_view_matrix = *reinterpret_cast<f32mat4x4*>(&controlled_camera.camera.view_mat);
-    this->context.shader_global_block.globals.camera_inverse_view_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_view_matrix);
-    this->context.shader_global_block.globals.camera_projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&projection_view_matrix);
-    this->context.shader_global_block.globals.camera_inverse_projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_projection_view);
-    this->context.shader_global_block.globals.terrain_y_clip_trick = *reinterpret_cast<f32vec4*>(&terrain_y_clip_trick);
-    this->context.shader_global_block.globals.jitter = *reinterpret_cast<f32vec2*>(&jitter_vec2);
-
-    this->context.shader_global_block.globals.camera_near_clip = controlled_camera.camera.near_clip;
-    this->context.shader_global_block.globals.camera_far_clip = controlled_camera.camera.far_clip;
-    this->context.shader_global_block.globals.resolution = { static_cast<i32>(window.get_width()), static_cast<i32>(window.get_height()) };
-    this->context.shader_global_block.globals.camera_position = *reinterpret_cast<f32vec3*>(&controlled_camera.position);
-
-    this->context.shader_global_block.globals.delta_time = delta_time;
-    this->context.shader_global_block.globals.elapsed_time += delta_time;
-    this->context.shader_global_block.globals.frame_counter++;
+void Application::finish_camera_path_replay() {
+    replaying_camera_path = false;
+    std::cout << "camera path replay finished\n";
+    frame_time_report.print(std::cout);
+    std::cout << std::flush;
 }
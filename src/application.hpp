@@ -4,6 +4,8 @@
 #include "graphics/camera.hpp"
 #include "context.hpp"
 #include "graphics/renderer.hpp"
+#include "graphics/camera_path.hpp"
+#include "utils/frame_time_report.hpp"
 #include "ecs/scene.hpp"
 #include "ecs/entity.hpp"
 #include "ecs/components.hpp"
@@ -16,6 +18,10 @@ struct Application {
     auto run() -> i32;
     void update();
 
+    void toggle_camera_path_recording();
+    void start_camera_path_replay(const std::string& file_path);
+    void finish_camera_path_replay();
+
     AppWindow window;
     Context context;
     std::shared_ptr<Scene> scene;
@@ -24,5 +30,12 @@ struct Application {
     ControlledCamera3D controlled_camera = {};
     f32 delta_time = 0.016f;
     std::chrono::time_point<std::chrono::steady_clock> last_time_point = {};
-    u32 jitter_index = 0;
+    u32 profile_capture_frame_count = 120;
+
+    CameraPath camera_path = {};
+    std::string camera_path_file = "camera_path.bin";
+    bool recording_camera_path = false;
+    bool replaying_camera_path = false;
+    u32 replay_frame = 0;
+    FrameTimeReport frame_time_report = {};
 };
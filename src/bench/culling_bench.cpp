@@ -0,0 +1,82 @@
+#include "graphics/frustum_culling.hpp"
+
+#include <chrono>
+#include <random>
+
+// measures frustum culling throughput on random boxes and prints it as json
+//   culling_bench [--boxes n] [--iterations n]
+// the boxes are scattered around a camera looking down the z axis, so roughly a quarter of them are visible
+
+struct BenchSettings {
+    u32 box_count = 100000;
+    u32 iteration_count = 256;
+};
+
+auto parse_settings(i32 argc, char** argv) -> BenchSettings {
+    BenchSettings settings = {};
+    auto value = [&](i32& i) -> std::string {
+        if(i + 1 >= argc) { throw std::runtime_error(std::string{"missing value for "} + argv[i]); }
+        return argv[++i];
+    };
+
+    for(i32 i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if(arg == "--boxes") { settings.box_count = static_cast<u32>(std::stoul(value(i))); }
+        else if(arg == "--iterations") { settings.iteration_count = static_cast<u32>(std::stoul(value(i))); }
+        else { throw std::runtime_error("unknown argument: " + std::string{arg}); }
+    }
+
+    settings.iteration_count = std::max(settings.iteration_count, 1u);
+    return settings;
+}
+
+auto main(i32 argc, char** argv) -> i32 {
+    try {
+        BenchSettings settings = parse_settings(argc, argv);
+
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<f32> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<f32> size(0.1f, 8.0f);
+        CullingBounds bounds = {};
+        bounds.reserve(settings.box_count);
+        for(u32 i = 0; i < settings.box_count; i++) {
+            glm::vec3 min = { position(random), position(random) * 0.1f, position(random) };
+            bounds.push(min, min + glm::vec3{size(random), size(random), size(random)});
+        }
+
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3{0.0f, 10.0f, 0.0f}, glm::vec3{0.0f, 10.0f, 1.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+        Frustum frustum = extract_frustum(projection * view);
+
+        std::vector<u32> visible = {};
+        visible.reserve(settings.box_count);
+        auto measure = [&](auto&& cull) -> f64 {
+            std::vector<f64> times = {};
+            for(u32 i = 0; i < settings.iteration_count; i++) {
+                visible.clear();
+                auto start = std::chrono::steady_clock::now();
+                cull(bounds, frustum, visible);
+                times.push_back(std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+            // the fastest run is the least disturbed by the rest of the system
+            return *std::min_element(times.begin(), times.end());
+        };
+
+        f64 scalar_time = measure(cull_boxes_scalar);
+        std::vector<u32> scalar_visible = visible;
+        f64 simd_time = measure(cull_boxes);
+        if(visible != scalar_visible) { throw std::runtime_error("simd and scalar culling disagree"); }
+
+        std::cout << "{\n";
+        std::cout << "  \"boxes\": " << settings.box_count << ",\n";
+        std::cout << "  \"visible\": " << visible.size() << ",\n";
+        std::cout << "  \"scalar\": { \"us\": " << scalar_time << ", \"boxes_per_us\": " << static_cast<f64>(settings.box_count) / scalar_time << " },\n";
+        std::cout << "  \"" << get_culling_instruction_set() << "\": { \"us\": " << simd_time << ", \"boxes_per_us\": " << static_cast<f64>(settings.box_count) / simd_time << " }\n";
+        std::cout << "}" << std::endl;
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "graphics/model_importer.hpp"
+#include "graphics/meshlet_builder.hpp"
+#include "utils/threadpool.hpp"
+
+#include <chrono>
+#include <numeric>
+
+// measures meshlet build throughput on the primitives of a model and prints it as json
+//   meshlet_bench [--model path] [--iterations n]
+// single_thread builds every primitive one after another, thread_pool goes through build_model_meshlets
+
+struct BenchSettings {
+    std::string model_path = "assets/Sponza/glTF/Sponza.gltf";
+    u32 iteration_count = 16;
+};
+
+auto parse_settings(i32 argc, char** argv) -> BenchSettings {
+    BenchSettings settings = {};
+    auto value = [&](i32& i) -> std::string {
+        if(i + 1 >= argc) { throw std::runtime_error(std::string{"missing value for "} + argv[i]); }
+        return argv[++i];
+    };
+
+    for(i32 i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if(arg == "--model") { settings.model_path = value(i); }
+        else if(arg == "--iterations") { settings.iteration_count = static_cast<u32>(std::stoul(value(i))); }
+        else { throw std::runtime_error("unknown argument: " + std::string{arg}); }
+    }
+
+    settings.iteration_count = std::max(settings.iteration_count, 1u);
+    return settings;
+}
+
+auto main(i32 argc, char** argv) -> i32 {
+    try {
+        BenchSettings settings = parse_settings(argc, argv);
+        ThreadPool pool(std::thread::hardware_concurrency());
+        ModelData model = import_gltf_model(settings.model_path, &pool);
+        u64 triangle_count = model.indices.size() / 3;
+
+        auto measure = [&](auto&& build) -> f64 {
+            std::vector<f64> times = {};
+            for(u32 i = 0; i < settings.iteration_count; i++) {
+                auto start = std::chrono::steady_clock::now();
+                build();
+                times.push_back(std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count());
+            }
+            // the fastest run is the least disturbed by the rest of the system
+            return *std::min_element(times.begin(), times.end());
+        };
+
+        u64 meshlet_count = 0;
+        f64 single_thread_time = measure([&]() {
+            meshlet_count = 0;
+            for(const auto& primitive : model.primitives) {
+                MeshletData data = build_meshlets(
+                    std::span{model.indices}.subspan(primitive.first_index, primitive.index_count),
+                    std::span{model.vertices}.subspan(primitive.first_vertex, primitive.vertex_count));
+                meshlet_count += data.meshlets.size();
+            }
+        });
+
+        f64 thread_pool_time = measure([&]() { build_model_meshlets(model, pool); });
+
+        f64 average_triangles = model.meshlets.empty() ? 0.0 : static_cast<f64>(std::accumulate(model.meshlets.begin(), model.meshlets.end(), u64{0}, [](u64 sum, const Meshlet& meshlet) { return sum + meshlet.triangle_count; })) / static_cast<f64>(model.meshlets.size());
+        f64 average_vertices = model.meshlets.empty() ? 0.0 : static_cast<f64>(model.meshlet_vertices.size()) / static_cast<f64>(model.meshlets.size());
+
+        std::cout << "{\n";
+        std::cout << "  \"model\": \"" << settings.model_path << "\",\n";
+        std::cout << "  \"triangles\": " << triangle_count << ",\n";
+        std::cout << "  \"meshlets\": " << meshlet_count << ",\n";
+        std::cout << "  \"avg_meshlet_triangles\": " << average_triangles << ",\n";
+        std::cout << "  \"avg_meshlet_vertices\": " << average_vertices << ",\n";
+        std::cout << "  \"single_thread\": { \"ms\": " << single_thread_time * 1000.0 << ", \"triangles_per_sec\": " << static_cast<f64>(triangle_count) / single_thread_time << " },\n";
+        std::cout << "  \"thread_pool\": { \"threads\": " << pool.get_thread_count() << ", \"ms\": " << thread_pool_time * 1000.0 << ", \"triangles_per_sec\": " << static_cast<f64>(triangle_count) / thread_pool_time << " }\n";
+        std::cout << "}" << std::endl;
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "graphics/occlusion_culling.hpp"
+
+#include <chrono>
+#include <random>
+
+// measures software occlusion culling on random walls and boxes and prints it as json
+//   occlusion_bench [--occluders n] [--boxes n] [--iterations n]
+// the walls stand across a camera looking down the z axis like the arcades of a courtyard, the buffer sizes are
+// 1080p divided into pixels of 6x6, 4x4, 3x3 and 2x2
+
+struct BenchSettings {
+    u32 occluder_count = 64;
+    u32 box_count = 100000;
+    u32 iteration_count = 64;
+};
+
+auto parse_settings(i32 argc, char** argv) -> BenchSettings {
+    BenchSettings settings = {};
+    auto value = [&](i32& i) -> std::string {
+        if(i + 1 >= argc) { throw std::runtime_error(std::string{"missing value for "} + argv[i]); }
+        return argv[++i];
+    };
+
+    for(i32 i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if(arg == "--occluders") { settings.occluder_count = static_cast<u32>(std::stoul(value(i))); }
+        else if(arg == "--boxes") { settings.box_count = static_cast<u32>(std::stoul(value(i))); }
+        else if(arg == "--iterations") { settings.iteration_count = static_cast<u32>(std::stoul(value(i))); }
+        else { throw std::runtime_error("unknown argument: " + std::string{arg}); }
+    }
+
+    settings.iteration_count = std::max(settings.iteration_count, 1u);
+    return settings;
+}
+
+auto main(i32 argc, char** argv) -> i32 {
+    try {
+        BenchSettings settings = parse_settings(argc, argv);
+        std::mt19937 random(1234);
+
+        // every wall is a quad of two triangles split into a grid, so there are enough triangles to measure
+        constexpr u32 WALL_SEGMENTS = 4;
+        std::uniform_real_distribution<f32> wall_x(-150.0f, 150.0f);
+        std::uniform_real_distribution<f32> wall_z(10.0f, 400.0f);
+        std::uniform_real_distribution<f32> wall_width(10.0f, 60.0f);
+        std::uniform_real_distribution<f32> wall_height(5.0f, 30.0f);
+        std::vector<glm::vec3> positions = {};
+        std::vector<u32> indices = {};
+        for(u32 w = 0; w < settings.occluder_count; w++) {
+            glm::vec3 min = { wall_x(random), 0.0f, wall_z(random) };
+            glm::vec2 size = { wall_width(random), wall_height(random) };
+            u32 first_vertex = static_cast<u32>(positions.size());
+            for(u32 y = 0; y <= WALL_SEGMENTS; y++) {
+                for(u32 x = 0; x <= WALL_SEGMENTS; x++) {
+                    positions.push_back(min + glm::vec3{size.x * static_cast<f32>(x) / WALL_SEGMENTS, size.y * static_cast<f32>(y) / WALL_SEGMENTS, 0.0f});
+                }
+            }
+            for(u32 y = 0; y < WALL_SEGMENTS; y++) {
+                for(u32 x = 0; x < WALL_SEGMENTS; x++) {
+                    u32 corner = first_vertex + y * (WALL_SEGMENTS + 1) + x;
+                    indices.insert(indices.end(), { corner, corner + 1, corner + WALL_SEGMENTS + 1, corner + 1, corner + WALL_SEGMENTS + 2, corner + WALL_SEGMENTS + 1 });
+                }
+            }
+        }
+
+        std::uniform_real_distribution<f32> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<f32> size(0.1f, 8.0f);
+        CullingBounds bounds = {};
+        bounds.reserve(settings.box_count);
+        for(u32 i = 0; i < settings.box_count; i++) {
+            glm::vec3 min = { position(random), position(random) * 0.02f, position(random) };
+            bounds.push(min, min + glm::vec3{size(random), size(random), size(random)});
+        }
+
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3{0.0f, 2.0f, 0.0f}, glm::vec3{0.0f, 2.0f, 1.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+        glm::mat4 projection_view = projection * view;
+        std::vector<u32> frustum_visible = {};
+        cull_boxes(bounds, extract_frustum(projection_view), frustum_visible);
+
+        // the fastest run is the least disturbed by the rest of the system
+        auto measure = [&](auto&& run) -> f64 {
+            f64 fastest = std::numeric_limits<f64>::max();
+            for(u32 i = 0; i < settings.iteration_count; i++) {
+                auto start = std::chrono::steady_clock::now();
+                run();
+                fastest = std::min(fastest, std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+            return fastest;
+        };
+
+        std::cout << "{\n";
+        std::cout << "  \"triangles\": " << indices.size() / 3 << ",\n";
+        std::cout << "  \"boxes\": " << settings.box_count << ",\n";
+        std::cout << "  \"frustum_visible\": " << frustum_visible.size() << ",\n";
+        std::cout << "  \"sizes\": [\n";
+
+        const std::array<glm::uvec2, 4> sizes = { glm::uvec2{320, 180}, glm::uvec2{480, 270}, glm::uvec2{640, 360}, glm::uvec2{960, 540} };
+        for(usize s = 0; s < sizes.size(); s++) {
+            OcclusionBuffer buffer = {};
+            buffer.resize(sizes[s].x, sizes[s].y);
+
+            std::vector<OccluderTriangle> triangles = {};
+            f64 project_time = measure([&]{
+                triangles.clear();
+                project_occluder(buffer, projection_view, positions, indices, triangles);
+            });
+
+            f64 scalar_time = measure([&]{
+                buffer.clear();
+                rasterize_occluders_scalar(buffer, triangles, 0, buffer.tiles_y);
+            });
+            std::vector<f32> scalar_depth = buffer.depth;
+            f64 simd_time = measure([&]{
+                buffer.clear();
+                rasterize_occluders(buffer, triangles, 0, buffer.tiles_y);
+            });
+            if(buffer.depth != scalar_depth) { throw std::runtime_error("simd and scalar rasterization disagree"); }
+
+            std::vector<u32> visible = {};
+            f64 test_time = measure([&]{
+                visible = frustum_visible;
+                cull_occluded(buffer, projection_view, bounds, visible);
+            });
+
+            f64 triangle_count = static_cast<f64>(triangles.size());
+            std::cout << "    { \"width\": " << buffer.width << ", \"height\": " << buffer.height;
+            std::cout << ", \"projected_triangles\": " << triangles.size() << ", \"project_us\": " << project_time;
+            std::cout << ", \"scalar\": { \"us\": " << scalar_time << ", \"triangles_per_us\": " << triangle_count / scalar_time << " }";
+            if(get_occlusion_instruction_set() != "scalar") {
+                std::cout << ", \"" << get_occlusion_instruction_set() << "\": { \"us\": " << simd_time << ", \"triangles_per_us\": " << triangle_count / simd_time << " }";
+            }
+            std::cout << ", \"test_us\": " << test_time << ", \"visible\": " << visible.size();
+            std::cout << ", \"cull_rate\": " << 1.0 - static_cast<f64>(visible.size()) / static_cast<f64>(std::max<usize>(frustum_visible.size(), 1)) << " }";
+            std::cout << (s + 1 < sizes.size() ? ",\n" : "\n");
+        }
+
+        std::cout << "  ]\n";
+        std::cout << "}" << std::endl;
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
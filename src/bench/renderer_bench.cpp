@@ -0,0 +1,217 @@
+#include "context.hpp"
+#include "graphics/renderer.hpp"
+#include "graphics/camera.hpp"
+#include "graphics/camera_path.hpp"
+#include "ecs/scene.hpp"
+#include "ecs/entity.hpp"
+#include "ecs/components.hpp"
+#include "utils/frame_time_report.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+
+// renders a fixed camera into an offscreen image without a window and prints per pass timings as json
+//   renderer_bench [--scene path] [--scale s] [--width w] [--height h] [--frames n] [--warmup n]
+//                  [--camera x y z] [--target x y z] [--camera-path path] [--output path]
+// with --camera-path the recorded flythrough replaces the fixed camera and --frames is taken from the path
+// the renderer logs pipeline compilation to stdout, pass --output to get clean json
+
+struct BenchSettings {
+    std::string scene_path = "assets/Sponza/glTF/Sponza.gltf";
+    f32 scene_scale = 0.01f;
+    u32 width = 1920;
+    u32 height = 1080;
+    u32 frame_count = 256;
+    u32 warmup_count = 32;
+    glm::vec3 camera_position = { -8.0f, 2.0f, -0.5f };
+    glm::vec3 camera_target = { 0.0f, 2.0f, -0.5f };
+    std::string camera_path = {};
+    std::string output_path = {};
+};
+
+struct TimingStats {
+    f64 average = {};
+    f64 min = {};
+    f64 max = {};
+};
+
+auto parse_settings(i32 argc, char** argv) -> BenchSettings {
+    BenchSettings settings = {};
+    auto value = [&](i32& i) -> std::string {
+        if(i + 1 >= argc) { throw std::runtime_error(std::string{"missing value for "} + argv[i]); }
+        return argv[++i];
+    };
+
+    for(i32 i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if(arg == "--scene") { settings.scene_path = value(i); }
+        else if(arg == "--scale") { settings.scene_scale = std::stof(value(i)); }
+        else if(arg == "--width") { settings.width = static_cast<u32>(std::stoul(value(i))); }
+        else if(arg == "--height") { settings.height = static_cast<u32>(std::stoul(value(i))); }
+        else if(arg == "--frames") { settings.frame_count = static_cast<u32>(std::stoul(value(i))); }
+        else if(arg == "--warmup") { settings.warmup_count = static_cast<u32>(std::stoul(value(i))); }
+        else if(arg == "--camera") { for(u32 c = 0; c < 3; c++) { settings.camera_position[static_cast<i32>(c)] = std::stof(value(i)); } }
+        else if(arg == "--camera-path") { settings.camera_path = value(i); }
+        else if(arg == "--output") { settings.output_path = value(i); }
+        else if(arg == "--target") { for(u32 c = 0; c < 3; c++) { settings.camera_target[static_cast<i32>(c)] = std::stof(value(i)); } }
+        else { throw std::runtime_error("unknown argument: " + std::string{arg}); }
+    }
+
+    settings.frame_count = std::max(settings.frame_count, 1u);
+    return settings;
+}
+
+auto compute_stats(const std::vector<f64>& samples) -> TimingStats {
+    if(samples.empty()) { return {}; }
+    return TimingStats {
+        .average = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<f64>(samples.size()),
+        .min = *std::min_element(samples.begin(), samples.end()),
+        .max = *std::max_element(samples.begin(), samples.end()),
+    };
+}
+
+// paths and pass names go into json strings, windows paths alone are full of backslashes
+auto escape_json(std::string_view text) -> std::string {
+    std::string result = {};
+    result.reserve(text.size());
+    for(char c : text) {
+        switch(c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default: {
+                if(static_cast<u8>(c) < 0x20) {
+                    std::array<char, 8> code = {};
+                    std::snprintf(code.data(), code.size(), "\\u%04x", static_cast<u32>(c));
+                    result += code.data();
+                } else {
+                    result.push_back(c);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void print_stats(std::ostream& out, const std::string& name, const TimingStats& stats, bool last) {
+    out << "    \"" << escape_json(name) << "\": { \"avg_ms\": " << stats.average << ", \"min_ms\": " << stats.min << ", \"max_ms\": " << stats.max << " }" << (last ? "\n" : ",\n");
+}
+
+auto main(i32 argc, char** argv) -> i32 {
+    BenchSettings settings = parse_settings(argc, argv);
+
+    Context context = {};
+    auto scene = std::make_shared<Scene>("benchmark", &context, nullptr);
+    Renderer renderer{settings.width, settings.height, &context, scene};
+
+    {
+        auto entity = scene->create_entity("benchmark model");
+        entity.add_component<TransformComponent>().scale = glm::vec3(settings.scene_scale);
+        auto& mesh_component = entity.add_component<MeshComponent>();
+        mesh_component.model = std::make_shared<Model>(context.upload_service.get(), context.geometry_arena.get(), context.texture_registry.get(), settings.scene_path, context.model_loader->get_pool());
+    }
+
+    ControlledCamera3D controlled_camera = {};
+    controlled_camera.camera.resize(static_cast<i32>(settings.width), static_cast<i32>(settings.height));
+    controlled_camera.camera.view_mat = glm::lookAt(settings.camera_position, settings.camera_target, glm::vec3{0.0f, 1.0f, 0.0f});
+    controlled_camera.position = settings.camera_position;
+
+    CameraPath camera_path = {};
+    if(!settings.camera_path.empty()) {
+        camera_path = CameraPath::load(settings.camera_path);
+        if(camera_path.frames.empty()) { throw std::runtime_error("camera path has no frames: " + settings.camera_path); }
+        settings.frame_count = static_cast<u32>(camera_path.frames.size());
+    }
+
+    // fixed time step so every run animates and accumulates exposure the same way
+    const f32 delta_time = camera_path.time_step;
+    FrameTimeReport frame_time_report = {};
+
+    std::vector<f64> cpu_frame_times = {};
+    std::vector<f64> cpu_render_times = {};
+    std::vector<f64> gpu_total_times = {};
+    std::vector<std::vector<f64>> gpu_pass_times(context.gpu_metric_pool->metrics.size());
+
+    // gpu results of a frame are read back frames_in_flight frames later, so keep going until the last measured frame is visible
+    u32 total_frames = settings.warmup_count + settings.frame_count + context.frames_in_flight;
+    for(u32 frame = 0; frame < total_frames; frame++) {
+        auto frame_start = std::chrono::steady_clock::now();
+
+        renderer.begin_frame();
+
+        u32 completed_frame = frame - std::min(frame, context.frames_in_flight);
+        if(frame >= context.frames_in_flight && completed_frame >= settings.warmup_count) {
+            f64 total = 0.0;
+            for(usize i = 0; i < context.gpu_metric_pool->metrics.size(); i++) {
+                gpu_pass_times[i].push_back(context.gpu_metric_pool->metrics[i].time_elapsed);
+                total += context.gpu_metric_pool->metrics[i].time_elapsed;
+            }
+            gpu_total_times.push_back(total);
+            frame_time_report.add_gpu_time(context.gpu_metric_pool->frame_time_elapsed);
+        }
+
+        if(!camera_path.frames.empty()) {
+            u32 path_frame = std::min(frame - std::min(frame, settings.warmup_count), settings.frame_count - 1);
+            controlled_camera.position = camera_path.frames[path_frame].position;
+            controlled_camera.rotation = camera_path.frames[path_frame].rotation;
+            controlled_camera.update_view();
+            renderer.jitter_index = camera_path.frames[path_frame].jitter_index;
+        }
+
+        scene->update(delta_time);
+        renderer.update_globals(controlled_camera.camera, controlled_camera.position, delta_time);
+
+        auto render_start = std::chrono::steady_clock::now();
+        renderer.render();
+        auto frame_end = std::chrono::steady_clock::now();
+
+        if(frame >= settings.warmup_count && frame < settings.warmup_count + settings.frame_count) {
+            cpu_frame_times.push_back(std::chrono::duration<f64, std::milli>(frame_end - frame_start).count());
+            cpu_render_times.push_back(std::chrono::duration<f64, std::milli>(frame_end - render_start).count());
+            frame_time_report.add_cpu_time(cpu_frame_times.back());
+        }
+    }
+
+    context.device.wait_idle();
+
+    // metrics of passes that are not part of the task graph never get written
+    std::vector<usize> recorded_passes = {};
+    for(usize i = 0; i < gpu_pass_times.size(); i++) {
+        if(compute_stats(gpu_pass_times[i]).max > 0.0) { recorded_passes.push_back(i); }
+    }
+
+    std::ofstream file = {};
+    if(!settings.output_path.empty()) {
+        file.open(settings.output_path, std::ios::out | std::ios::trunc);
+        if(!file.is_open()) { throw std::runtime_error("couldnt open file: " + settings.output_path); }
+    }
+    std::ostream& out = settings.output_path.empty() ? std::cout : file;
+
+    out << "{\n";
+    out << "  \"scene\": \"" << escape_json(settings.scene_path) << "\",\n";
+    out << "  \"resolution\": [" << settings.width << ", " << settings.height << "],\n";
+    out << "  \"frames\": " << settings.frame_count << ",\n";
+    out << "  \"warmup\": " << settings.warmup_count << ",\n";
+    out << "  \"frame_times\": {\n";
+    frame_time_report.write_json(out, "    ");
+    out << "  },\n";
+    out << "  \"cpu\": {\n";
+    print_stats(out, "frame", compute_stats(cpu_frame_times), false);
+    print_stats(out, "render", compute_stats(cpu_render_times), true);
+    out << "  },\n";
+    out << "  \"gpu\": {\n";
+    print_stats(out, "total", compute_stats(gpu_total_times), recorded_passes.empty());
+    for(usize i = 0; i < recorded_passes.size(); i++) {
+        print_stats(out, context.gpu_metric_pool->metrics[recorded_passes[i]].name, compute_stats(gpu_pass_times[recorded_passes[i]]), i + 1 == recorded_passes.size());
+    }
+    out << "  }\n";
+    out << "}" << std::endl;
+
+    return 0;
+}
@@ -1,12 +1,20 @@
 #include "context.hpp"
 
 
-Context::Context(const AppWindow &window)
+Context::Context(const AppWindow &window) : Context{&window} {}
+
+Context::Context() : Context{nullptr} {}
+
+Context::Context(const AppWindow* window)
     : instance{daxa::create_instance({})},
         device{instance.create_device(daxa::DeviceInfo{
             .enable_buffer_device_address_capture_replay = true,
             .name = "my device"})},
-        swapchain{window.create_swapchain(this->device)},
+        swapchain{window != nullptr ? window->create_swapchain(this->device) : daxa::Swapchain{}},
+        headless{window == nullptr},
+        frames_in_flight{headless ? HEADLESS_FRAMES_IN_FLIGHT : static_cast<u32>(swapchain.info().max_allowed_frames_in_flight)},
+        output_format{headless ? daxa::Format::R8G8B8A8_UNORM : swapchain.get_format()},
+        headless_timeline{headless ? device.create_timeline_semaphore({ .initial_value = 0, .name = "headless timeline" }) : daxa::TimelineSemaphore{}},
         pipeline_manager{daxa::PipelineManagerInfo{
             .device = device,
             .shader_compile_options = {
@@ -26,14 +34,24 @@ Context::Context(const AppWindow &window)
         }},
         shader_global_block{}, 
         shader_globals_buffer{device.create_buffer(daxa::BufferInfo{
-            .size = static_cast<u32>(((static_cast<i32>(sizeof(ShaderGlobalsBlock)) + 256 - 1) / 256) * 256 * swapchain.info().max_allowed_frames_in_flight),
+            .size = static_cast<u32>(((static_cast<i32>(sizeof(ShaderGlobalsBlock)) + 256 - 1) / 256) * 256 * frames_in_flight),
             .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE | daxa::MemoryFlagBits::DEDICATED_MEMORY,
             .name = "globals",
         })},
         shader_globals_set_info{} {
-    gpu_metric_pool = std::make_unique<GPUMetricPool>(device);
+    gpu_metric_pool = std::make_unique<GPUMetricPool>(device, frames_in_flight);
+    upload_service = std::make_unique<UploadService>(device);
+    sampler_cache = std::make_unique<SamplerCache>(device);
+    texture_registry = std::make_unique<TextureRegistry>(upload_service.get(), sampler_cache.get());
+    geometry_arena = std::make_unique<GeometryArena>(device);
+    model_loader = std::make_unique<ModelLoader>(upload_service.get(), geometry_arena.get(), texture_registry.get());
 }
 
 Context::~Context() {
+    model_loader.reset();
+    geometry_arena.reset();
+    texture_registry.reset();
+    sampler_cache.reset();
+    upload_service.reset();
     device.destroy_buffer(shader_globals_buffer);
 }
@@ -2,15 +2,25 @@
 
 #include "graphics/window.hpp"
 #include "utils/gpu_metric.hpp"
+#include "graphics/model_loader.hpp"
+#include "graphics/sampler_cache.hpp"
 
 
 struct Context {
+    static constexpr u32 HEADLESS_FRAMES_IN_FLIGHT = 2;
+
     Context(const AppWindow& window);
+    // headless, frames are paced by headless_timeline instead of a swapchain
+    Context();
     ~Context();
 
     daxa::Instance instance = {};
     daxa::Device device = {};
     daxa::Swapchain swapchain = {};
+    bool headless = {};
+    u32 frames_in_flight = {};
+    daxa::Format output_format = {};
+    daxa::TimelineSemaphore headless_timeline = {};
     daxa::PipelineManager pipeline_manager = {};
     daxa::TransferMemoryPool transient_mem;
 
@@ -22,7 +32,14 @@ struct Context {
     std::unordered_map<std::string_view, std::shared_ptr<daxa::ComputePipeline>> compute_pipelines = {};
 
     std::unique_ptr<GPUMetricPool> gpu_metric_pool = {};
-    std::unordered_map<std::string, std::shared_ptr<GPUMetric>> gpu_metrics = {};
+    std::unique_ptr<UploadService> upload_service = {};
+    std::unique_ptr<SamplerCache> sampler_cache = {};
+    std::unique_ptr<TextureRegistry> texture_registry = {};
+    std::unique_ptr<GeometryArena> geometry_arena = {};
+    std::unique_ptr<ModelLoader> model_loader = {};
 
     usize frame_index = 0;
+
+private:
+    Context(const AppWindow* window);
 };
@@ -2,6 +2,8 @@
 #include "ui/ui.hpp"
 #include "utils/file_io.hpp"
 
+#include <glm/gtx/quaternion.hpp>
+
     void UUIDComponent::draw() {
     GUI::begin_properties();
 
@@ -55,6 +57,12 @@ void TransformComponent::set_scale(const glm::vec3 _scale) {
     is_dirty = true;
 }
 
+auto TransformComponent::compute_model_matrix() const -> glm::mat4 {
+    return glm::translate(glm::mat4(1.0f), position) 
+        * glm::toMat4(glm::quat({glm::radians(rotation.x), glm::radians(rotation.y), glm::radians(rotation.z)})) 
+        * glm::scale(glm::mat4(1.0f), scale);
+}
+
 auto TransformComponent::get_position() -> glm::vec3 {
     return position;
 }
@@ -38,9 +38,8 @@ struct TransformComponent {
     auto get_position() -> glm::vec3;
     auto get_rotation() -> glm::vec3;
     auto get_scale() -> glm::vec3;
-
-    daxa::BufferId buffer = {};
-    daxa::SetConstantBufferInfo buffer_info = {};
+    // the matrix Scene::update stores in model_matrix, for readers that cant wait for the update
+    auto compute_model_matrix() const -> glm::mat4;
 
     void draw();
 };
@@ -48,6 +47,9 @@ struct TransformComponent {
 struct MeshComponent {
     std::string path = {};
     std::shared_ptr<Model> model = {};
+    // lod level of every primitive for the camera and the shadow passes, picked by the renderer each frame
+    std::vector<u32> lods = {};
+    std::vector<u32> shadow_lods = {};
 
     void draw();
 };
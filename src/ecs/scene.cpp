@@ -1,20 +1,14 @@
 #include "scene.hpp"
 #include "entity.hpp"
 #include "components.hpp"
+#include "utils/profiler.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 
 Scene::Scene(const std::string_view& _name, Context* _context, AppWindow* _window) : name{_name}, registry{std::make_unique<entt::registry>()}, context{_context}, window{_window} {}
 
-Scene::~Scene() {
-    iterate([this](Entity entity){
-        if(entity.has_component<TransformComponent>()) {
-            auto& tc = entity.get_component<TransformComponent>();
-            if(!tc.buffer.is_empty()) { context->device.destroy_buffer(tc.buffer); }
-        }
-    });
-}
+Scene::~Scene() = default;
 
 auto Scene::create_entity(const std::string_view& _name) -> Entity {
     return create_entity_with_UUID(_name, UUID());
@@ -45,6 +39,7 @@ void Scene::iterate(std::function<void(Entity)> fn) {
 };
 
 void Scene::update(f32 delta_time) {
+    PROFILE_FUNCTION();
     context->shader_global_block.globals.point_light_count = 0;
     context->shader_global_block.globals.spot_light_count = 0;
 
@@ -52,34 +47,12 @@ void Scene::update(f32 delta_time) {
         if(entity.has_component<TransformComponent>()) {
             auto& tc = entity.get_component<TransformComponent>();
 
-            if(tc.buffer.is_empty()) {
-                tc.buffer = context->device.create_buffer(daxa::BufferInfo{
-                    .size = static_cast<u32>(((static_cast<i32>(sizeof(TransformInfoBlock)) + 256 - 1) / 256) * 256 * context->swapchain.info().max_allowed_frames_in_flight),
-                    .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE | daxa::MemoryFlagBits::DEDICATED_MEMORY,
-                    .name = "transform buffer",
-                });
-
-            }
-
+            // the renderer copies the matrices into the draw instances, there is nothing to upload per entity
             if(tc.is_dirty) {
-                tc.model_matrix = glm::translate(glm::mat4(1.0f), tc.position) 
-                    * glm::toMat4(glm::quat({glm::radians(tc.rotation.x), glm::radians(tc.rotation.y), glm::radians(tc.rotation.z)})) 
-                    * glm::scale(glm::mat4(1.0f), tc.scale);
+                tc.model_matrix = tc.compute_model_matrix();
 
                 tc.normal_matrix = glm::transpose(glm::inverse(tc.model_matrix));
             }
-
-            char* mapped_ptr = reinterpret_cast<char*>(context->device.get_host_address(tc.buffer));
-            auto* ptr = reinterpret_cast<TransformInfoBlock*>(mapped_ptr + ((static_cast<i32>(sizeof(TransformInfoBlock)) + 256 - 1) / 256) * 256 * context->frame_index);
-            ptr->transform.model_matrix = *reinterpret_cast<f32mat4x4*>(&tc.model_matrix);
-            ptr->transform.normal_matrix = *reinterpret_cast<f32mat4x4*>(&tc.normal_matrix);
-
-            tc.buffer_info = {
-                .slot = TRANSFORM_INFO_SLOT,
-                .buffer = tc.buffer,
-                .size = ((static_cast<i32>(sizeof(TransformInfoBlock)) + 256 - 1) / 256) * 256,
-                .offset = ((static_cast<i32>(sizeof(TransformInfoBlock)) + 256 - 1) / 256) * 256 * context->frame_index,
-            };
         }
 
         if(entity.has_component<PointLightComponent>()) {
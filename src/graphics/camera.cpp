@@ -37,7 +37,7 @@ void ControlledCamera3D::update(AppWindow& window, f32 dt) {
     if (rotation.y > MAX_ROT) { rotation.y = MAX_ROT; }
     if (rotation.y < -MAX_ROT) { rotation.y = -MAX_ROT; }
 
-    glm::vec3 forward_direction = glm::normalize(glm::vec3{ cos(rotation.x) * cos(rotation.y), -sin(rotation.y), sin(rotation.x) * cos(rotation.y) });
+    glm::vec3 forward_direction = get_forward_direction();
     glm::vec3 up_direction = glm::vec3{ 0.0f, 1.0f, 0.0f };
     glm::vec3 right_direction = glm::normalize(glm::cross(forward_direction, up_direction));
 
@@ -53,5 +53,13 @@ void ControlledCamera3D::update(AppWindow& window, f32 dt) {
     }
 
     position += move_direction * dt * (window.key_pressed(static_cast<Key>(keybinds.toggle_sprint)) ? sprint_speed : 2.0f) * 7.5f;
-    camera.view_mat = glm::lookAt(position, position + forward_direction, glm::vec3{0.0f, 1.0f, 0.0f});
+    update_view();
+}
+
+void ControlledCamera3D::update_view() {
+    camera.view_mat = glm::lookAt(position, position + get_forward_direction(), glm::vec3{0.0f, 1.0f, 0.0f});
+}
+
+auto ControlledCamera3D::get_forward_direction() const -> glm::vec3 {
+    return glm::normalize(glm::vec3{ cos(rotation.x) * cos(rotation.y), -sin(rotation.y), sin(rotation.x) * cos(rotation.y) });
 }
\ No newline at end of file
@@ -60,4 +60,6 @@ struct ControlledCamera3D {
     f32 acceleration = 10.0f;
 
     void update(AppWindow& window, f32 dt);
+    void update_view();
+    auto get_forward_direction() const -> glm::vec3;
 };
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "camera_path.hpp"
+
+#include <fstream>
+
+namespace {
+    template<typename T>
+    void write_value(std::ofstream& file, const T& value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    auto read_value(std::ifstream& file) -> T {
+        T value = {};
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    // position, rotation and jitter index as they are written by CameraPath::save
+    constexpr u64 SERIALIZED_FRAME_SIZE = 6 * sizeof(f32) + sizeof(u32);
+}
+
+void CameraPath::save(const std::string_view& file_path) const {
+    std::ofstream file(std::string{file_path}, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open()) {
+        throw std::runtime_error("couldnt open file: " + std::string{file_path});
+    }
+
+    write_value(file, MAGIC);
+    write_value(file, VERSION);
+    write_value(file, time_step);
+    write_value(file, static_cast<u32>(frames.size()));
+
+    for(const auto& frame : frames) {
+        write_value(file, frame.position.x);
+        write_value(file, frame.position.y);
+        write_value(file, frame.position.z);
+        write_value(file, frame.rotation.x);
+        write_value(file, frame.rotation.y);
+        write_value(file, frame.rotation.z);
+        write_value(file, frame.jitter_index);
+    }
+}
+
+auto CameraPath::load(const std::string_view& file_path) -> CameraPath {
+    if(!std::filesystem::exists(file_path)) {
+        throw std::runtime_error("file hasnt been found: " + std::string{file_path});
+    }
+
+    std::ifstream file(std::string{file_path}, std::ios::in | std::ios::binary);
+    if(read_value<u32>(file) != MAGIC || read_value<u32>(file) != VERSION) {
+        throw std::runtime_error("file isnt a camera path or has an unsupported version: " + std::string{file_path});
+    }
+
+    CameraPath path = {};
+    path.time_step = read_value<f32>(file);
+    u32 frame_count = read_value<u32>(file);
+
+    // the count comes from the file, it has to fit in what is left of it before anything gets allocated for it
+    u64 header_size = 3 * sizeof(u32) + sizeof(f32);
+    u64 file_size = std::filesystem::file_size(file_path);
+    if(!file || file_size < header_size || frame_count > (file_size - header_size) / SERIALIZED_FRAME_SIZE) {
+        throw std::runtime_error("camera path is truncated: " + std::string{file_path});
+    }
+    path.frames.resize(frame_count);
+
+    for(auto& frame : path.frames) {
+        frame.position.x = read_value<f32>(file);
+        frame.position.y = read_value<f32>(file);
+        frame.position.z = read_value<f32>(file);
+        frame.rotation.x = read_value<f32>(file);
+        frame.rotation.y = read_value<f32>(file);
+        frame.rotation.z = read_value<f32>(file);
+        frame.jitter_index = read_value<u32>(file);
+    }
+
+    if(!file) {
+        throw std::runtime_error("camera path is truncated: " + std::string{file_path});
+    }
+
+    return path;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "pch.hpp"
+
+struct CameraPathFrame {
+    glm::vec3 position = {};
+    glm::vec3 rotation = {};
+    u32 jitter_index = {};
+};
+
+// a recorded flythrough, replayed one frame per rendered frame with a fixed time step
+// so that two runs over the same path render exactly the same sequence of frames
+struct CameraPath {
+    static constexpr u32 MAGIC = 0x48544150; // "PATH"
+    static constexpr u32 VERSION = 1;
+
+    void save(const std::string_view& file_path) const;
+    static auto load(const std::string_view& file_path) -> CameraPath;
+
+    f32 time_step = 1.0f / 60.0f;
+    std::vector<CameraPathFrame> frames = {};
+};
@@ -0,0 +1,227 @@
+#include "cooked_model.hpp"
+#include "texture_container.hpp"
+
+#include <fstream>
+
+namespace {
+    constexpr u64 SECTION_ALIGNMENT = 16;
+
+    auto align_up(u64 value) -> u64 {
+        return (value + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    // whether count elements at offset stay inside a file of file_size bytes, without overflowing on corrupt headers
+    auto section_fits(u64 offset, u64 count, u64 element_size, u64 file_size) -> bool {
+        if(offset > file_size) { return false; }
+        return count <= (file_size - offset) / element_size;
+    }
+
+    // whether [first, first + count) lies in [0, size), the sum cant overflow in 64 bits
+    auto range_fits(u64 first, u64 count, u64 size) -> bool {
+        return first + count <= size;
+    }
+
+    auto image_index_fits(i32 image_index, u32 image_count) -> bool {
+        return image_index < 0 || static_cast<u32>(image_index) < image_count;
+    }
+}
+
+void CookedModel::write(const ModelData& model, const std::filesystem::path& file_path) {
+    CookedModelHeader header = {
+        .magic = MAGIC,
+        .version = VERSION,
+        .index_data_size = static_cast<u32>(model.index_data.size()),
+        .vertex_count = static_cast<u32>(model.packed_vertices.size()),
+        .index_count = static_cast<u32>(model.indices.size()),
+        .primitive_count = static_cast<u32>(model.primitives.size()),
+        .material_count = static_cast<u32>(model.materials.size()),
+        .image_count = static_cast<u32>(model.images.size()),
+        .meshlet_count = static_cast<u32>(model.meshlets.size()),
+        .meshlet_vertex_count = static_cast<u32>(model.meshlet_vertices.size()),
+        .lod_count = static_cast<u32>(model.lods.size()),
+        .meshlet_triangles_size = model.meshlet_triangles.size(),
+    };
+
+    header.vertices_offset = align_up(sizeof(CookedModelHeader));
+    header.positions_offset = align_up(header.vertices_offset + model.packed_vertices.size() * sizeof(PackedVertex));
+    header.indices_offset = align_up(header.positions_offset + model.packed_positions.size() * sizeof(PackedPosition));
+    header.primitives_offset = align_up(header.indices_offset + model.index_data.size());
+    header.materials_offset = align_up(header.primitives_offset + model.primitives.size() * sizeof(Primitive));
+    header.lods_offset = align_up(header.materials_offset + model.materials.size() * sizeof(ModelMaterial));
+    header.meshlets_offset = align_up(header.lods_offset + model.lods.size() * sizeof(PrimitiveLod));
+    header.meshlet_vertices_offset = align_up(header.meshlets_offset + model.meshlets.size() * sizeof(Meshlet));
+    header.meshlet_triangles_offset = align_up(header.meshlet_vertices_offset + model.meshlet_vertices.size() * sizeof(u32));
+    header.images_offset = align_up(header.meshlet_triangles_offset + model.meshlet_triangles.size());
+
+    std::vector<CookedImage> images(model.images.size());
+    std::vector<std::string> image_paths(model.images.size());
+    u64 image_data_offset = align_up(header.images_offset + images.size() * sizeof(CookedImage));
+    for(usize i = 0; i < model.images.size(); i++) {
+        const auto& image = model.images[i];
+        images[i].format = static_cast<u32>(image.format);
+        images[i].embedded = image.path.empty() ? 1 : 0;
+        if(images[i].embedded == 0) {
+            image_paths[i] = std::filesystem::relative(image.path, file_path.parent_path()).generic_string();
+        }
+        images[i].data_offset = image_data_offset;
+        images[i].data_size = images[i].embedded ? image.bytes.size() : image_paths[i].size();
+        image_data_offset = align_up(image_data_offset + images[i].data_size);
+    }
+
+    std::ofstream file(file_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open()) {
+        throw std::runtime_error("couldnt open file: " + file_path.string());
+    }
+
+    auto write_section = [&](u64 offset, const void* data, usize size) {
+        // zero fill the alignment padding in front of the section
+        std::vector<char> padding(static_cast<usize>(offset) - static_cast<usize>(static_cast<std::streamoff>(file.tellp())), 0);
+        file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    write_section(0, &header, sizeof(CookedModelHeader));
+    write_section(header.vertices_offset, model.packed_vertices.data(), model.packed_vertices.size() * sizeof(PackedVertex));
+    write_section(header.positions_offset, model.packed_positions.data(), model.packed_positions.size() * sizeof(PackedPosition));
+    write_section(header.indices_offset, model.index_data.data(), model.index_data.size());
+    write_section(header.primitives_offset, model.primitives.data(), model.primitives.size() * sizeof(Primitive));
+    write_section(header.materials_offset, model.materials.data(), model.materials.size() * sizeof(ModelMaterial));
+    write_section(header.lods_offset, model.lods.data(), model.lods.size() * sizeof(PrimitiveLod));
+    write_section(header.meshlets_offset, model.meshlets.data(), model.meshlets.size() * sizeof(Meshlet));
+    write_section(header.meshlet_vertices_offset, model.meshlet_vertices.data(), model.meshlet_vertices.size() * sizeof(u32));
+    write_section(header.meshlet_triangles_offset, model.meshlet_triangles.data(), model.meshlet_triangles.size());
+    write_section(header.images_offset, images.data(), images.size() * sizeof(CookedImage));
+    for(usize i = 0; i < model.images.size(); i++) {
+        const void* data = images[i].embedded ? static_cast<const void*>(model.images[i].bytes.data()) : static_cast<const void*>(image_paths[i].data());
+        write_section(images[i].data_offset, data, static_cast<usize>(images[i].data_size));
+    }
+
+    if(!file) {
+        throw std::runtime_error("failed writing cooked model: " + file_path.string());
+    }
+}
+
+CookedModel::CookedModel(const std::filesystem::path& _file_path) : file_path{_file_path}, file{_file_path.string()} {
+    if(file.size() < sizeof(CookedModelHeader)) {
+        throw std::runtime_error("cooked model is truncated: " + file_path.string());
+    }
+
+    header = reinterpret_cast<const CookedModelHeader*>(file.data());
+    if(header->magic != MAGIC || header->version != VERSION) {
+        throw std::runtime_error("cooked model has an unsupported version, recook it: " + file_path.string());
+    }
+
+    u64 size = file.size();
+    bool fits = section_fits(header->vertices_offset, header->vertex_count, sizeof(PackedVertex), size)
+        && section_fits(header->positions_offset, header->vertex_count, sizeof(PackedPosition), size)
+        && section_fits(header->indices_offset, header->index_data_size, 1, size)
+        && section_fits(header->primitives_offset, header->primitive_count, sizeof(Primitive), size)
+        && section_fits(header->materials_offset, header->material_count, sizeof(ModelMaterial), size)
+        && section_fits(header->lods_offset, header->lod_count, sizeof(PrimitiveLod), size)
+        && section_fits(header->meshlets_offset, header->meshlet_count, sizeof(Meshlet), size)
+        && section_fits(header->meshlet_vertices_offset, header->meshlet_vertex_count, sizeof(u32), size)
+        && section_fits(header->meshlet_triangles_offset, header->meshlet_triangles_size, 1, size)
+        && section_fits(header->images_offset, header->image_count, sizeof(CookedImage), size);
+    if(!fits) {
+        throw std::runtime_error("cooked model is truncated: " + file_path.string());
+    }
+
+    // the image table is known to be inside the file now, the data it points at is checked per image
+    for(const auto& image : get_images()) {
+        if(!section_fits(image.data_offset, image.data_size, 1, size)) {
+            throw std::runtime_error("cooked model is truncated: " + file_path.string());
+        }
+        if(!is_cooked_texture_format(static_cast<daxa::Format>(image.format))) {
+            throw std::runtime_error("cooked model has an image of unknown format " + std::to_string(image.format) + ", recook it: " + file_path.string());
+        }
+    }
+
+    validate_references();
+}
+
+void CookedModel::validate_references() const {
+    auto fail = [&](const std::string& reason) {
+        throw std::runtime_error("cooked model is corrupt, " + reason + ", recook it: " + file_path.string());
+    };
+
+    for(const auto& material : get_materials()) {
+        for(i32 image_index : { material.albedo_image, material.metallic_roughness_image, material.normal_image, material.occlusion_image, material.emissive_image }) {
+            if(!image_index_fits(image_index, header->image_count)) { fail("a material points past the images"); }
+        }
+    }
+
+    auto index_data = get_index_data();
+    for(const auto& primitive : get_primitives()) {
+        if(!range_fits(primitive.first_vertex, primitive.vertex_count, header->vertex_count)) { fail("a primitive points past the vertices"); }
+        if(!range_fits(primitive.first_index, primitive.index_count, header->index_count)) { fail("a primitive points past the indices"); }
+        // models without materials point every primitive at material 0 like the importer does
+        if(primitive.material_index >= std::max(header->material_count, 1u)) { fail("a primitive points past the materials"); }
+        if(!range_fits(primitive.first_lod, primitive.lod_count, header->lod_count)) { fail("a primitive points past the lods"); }
+        if(!range_fits(primitive.first_meshlet, primitive.meshlet_count, header->meshlet_count)) { fail("a primitive points past the meshlets"); }
+        if(primitive.index_type_size != sizeof(u16) && primitive.index_type_size != sizeof(u32)) { fail("a primitive has an unknown index type"); }
+
+        // every level is read by the gpu and by the occluders, so all of its indices have to name a vertex of the primitive
+        for(const auto& lod : get_lods().subspan(primitive.first_lod, primitive.lod_count)) {
+            if(lod.index_offset % primitive.index_type_size != 0 || !section_fits(lod.index_offset, lod.index_count, primitive.index_type_size, index_data.size())) { fail("a lod points past the index data"); }
+            for(u32 i = 0; i < lod.index_count; i++) {
+                u32 index = 0;
+                std::memcpy(&index, index_data.data() + lod.index_offset + static_cast<usize>(i) * primitive.index_type_size, primitive.index_type_size);
+                if(index >= primitive.vertex_count) { fail("an index points past the vertices of its primitive"); }
+            }
+        }
+
+        for(const auto& meshlet : get_meshlets().subspan(primitive.first_meshlet, primitive.meshlet_count)) {
+            if(!range_fits(meshlet.vertex_offset, meshlet.vertex_count, header->meshlet_vertex_count)) { fail("a meshlet points past the meshlet vertices"); }
+            if(!section_fits(meshlet.triangle_offset, meshlet.triangle_count, 3, header->meshlet_triangles_size)) { fail("a meshlet points past the meshlet triangles"); }
+        }
+    }
+}
+
+auto CookedModel::get_vertices() const -> std::span<const PackedVertex> {
+    return { reinterpret_cast<const PackedVertex*>(file.data() + header->vertices_offset), header->vertex_count };
+}
+
+auto CookedModel::get_positions() const -> std::span<const PackedPosition> {
+    return { reinterpret_cast<const PackedPosition*>(file.data() + header->positions_offset), header->vertex_count };
+}
+
+auto CookedModel::get_index_data() const -> std::span<const u8> {
+    return { file.data() + header->indices_offset, header->index_data_size };
+}
+
+auto CookedModel::get_primitives() const -> std::span<const Primitive> {
+    return { reinterpret_cast<const Primitive*>(file.data() + header->primitives_offset), header->primitive_count };
+}
+
+auto CookedModel::get_materials() const -> std::span<const ModelMaterial> {
+    return { reinterpret_cast<const ModelMaterial*>(file.data() + header->materials_offset), header->material_count };
+}
+
+auto CookedModel::get_lods() const -> std::span<const PrimitiveLod> {
+    return { reinterpret_cast<const PrimitiveLod*>(file.data() + header->lods_offset), header->lod_count };
+}
+
+auto CookedModel::get_meshlets() const -> std::span<const Meshlet> {
+    return { reinterpret_cast<const Meshlet*>(file.data() + header->meshlets_offset), header->meshlet_count };
+}
+
+auto CookedModel::get_meshlet_vertices() const -> std::span<const u32> {
+    return { reinterpret_cast<const u32*>(file.data() + header->meshlet_vertices_offset), header->meshlet_vertex_count };
+}
+
+auto CookedModel::get_meshlet_triangles() const -> std::span<const u8> {
+    return { file.data() + header->meshlet_triangles_offset, static_cast<usize>(header->meshlet_triangles_size) };
+}
+
+auto CookedModel::get_images() const -> std::span<const CookedImage> {
+    return { reinterpret_cast<const CookedImage*>(file.data() + header->images_offset), header->image_count };
+}
+
+auto CookedModel::get_image_path(const CookedImage& image) const -> std::filesystem::path {
+    auto bytes = get_image_bytes(image);
+    return file_path.parent_path() / std::string{reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+auto CookedModel::get_image_bytes(const CookedImage& image) const -> std::span<const u8> {
+    return { file.data() + image.data_offset, static_cast<usize>(image.data_size) };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "model_importer.hpp"
+#include "utils/mapped_file.hpp"
+
+struct CookedModelHeader {
+    u32 magic = {};
+    u32 version = {};
+    u32 index_data_size = {};
+    u32 vertex_count = {};
+    u32 index_count = {};
+    u32 primitive_count = {};
+    u32 material_count = {};
+    u32 image_count = {};
+    u32 meshlet_count = {};
+    u32 meshlet_vertex_count = {};
+    u32 lod_count = {};
+    // keeps the offsets below 8 byte aligned without implicit padding, the header is written as raw bytes
+    u32 reserved = {};
+    u64 vertices_offset = {};
+    u64 positions_offset = {};
+    u64 indices_offset = {};
+    u64 primitives_offset = {};
+    u64 materials_offset = {};
+    u64 lods_offset = {};
+    u64 images_offset = {};
+    u64 meshlets_offset = {};
+    u64 meshlet_vertices_offset = {};
+    u64 meshlet_triangles_offset = {};
+    u64 meshlet_triangles_size = {};
+};
+
+// external images store their path relative to the cooked file, embedded ones the encoded image
+struct CookedImage {
+    u32 format = {};
+    u32 embedded = {};
+    u64 data_offset = {};
+    u64 data_size = {};
+};
+
+// engine native model blob written by asset_cooker. every section is laid out exactly like the
+// gpu consumes it, so loading is mapping the file and copying the sections straight into staging
+struct CookedModel {
+    static constexpr u32 MAGIC = 0x4C444F4D; // "MODL"
+    static constexpr u32 VERSION = 7;
+    static constexpr std::string_view EXTENSION = ".cmodel";
+
+    static void write(const ModelData& model, const std::filesystem::path& file_path);
+
+    CookedModel(const std::filesystem::path& _file_path);
+
+    [[nodiscard]] auto get_header() const -> const CookedModelHeader& { return *header; }
+    [[nodiscard]] auto get_vertices() const -> std::span<const PackedVertex>;
+    [[nodiscard]] auto get_positions() const -> std::span<const PackedPosition>;
+    [[nodiscard]] auto get_index_data() const -> std::span<const u8>;
+    [[nodiscard]] auto get_primitives() const -> std::span<const Primitive>;
+    [[nodiscard]] auto get_lods() const -> std::span<const PrimitiveLod>;
+    [[nodiscard]] auto get_meshlets() const -> std::span<const Meshlet>;
+    [[nodiscard]] auto get_meshlet_vertices() const -> std::span<const u32>;
+    [[nodiscard]] auto get_meshlet_triangles() const -> std::span<const u8>;
+    [[nodiscard]] auto get_materials() const -> std::span<const ModelMaterial>;
+    [[nodiscard]] auto get_images() const -> std::span<const CookedImage>;
+    [[nodiscard]] auto get_image_path(const CookedImage& image) const -> std::filesystem::path;
+    [[nodiscard]] auto get_image_bytes(const CookedImage& image) const -> std::span<const u8>;
+
+    std::filesystem::path file_path = {};
+    MappedFile file;
+    const CookedModelHeader* header = {};
+
+private:
+    // every index, offset and range that points from one section into another, so a stale or corrupt file throws
+    // here instead of being read out of bounds later
+    void validate_references() const;
+};
@@ -0,0 +1,288 @@
+#include "draw_list.hpp"
+#include "context.hpp"
+#include "draw_sort.hpp"
+
+#include "utils/profiler.hpp"
+#include "utils/threadpool.hpp"
+
+namespace {
+    constexpr u32 MIN_DRAW_CAPACITY = 1024;
+    // marks the sort values of items the camera sees, items are indexed well below it
+    constexpr u32 CAMERA_VISIBLE_BIT = 1u << 31;
+    // the height follows the aspect ratio, 320 is 1080p divided into pixels of 6x6
+    constexpr u32 OCCLUSION_BUFFER_WIDTH = 320;
+    // triangles rasterized per frame, the occluders biggest on screen go first
+    constexpr u32 OCCLUDER_TRIANGLE_BUDGET = 16384;
+}
+
+void DrawList::begin_occlusion(Scene* scene, const glm::mat4& camera_projection_view, const glm::vec3& camera_position, f32 aspect, ThreadPool& pool) {
+    PROFILE_SCOPE("DrawList::begin_occlusion");
+    for(auto& job : occlusion_jobs) { job.wait(); }
+    occlusion_jobs.clear();
+    occlusion_projection_view = camera_projection_view;
+    occlusion_buffer.resize(OCCLUSION_BUFFER_WIDTH, static_cast<u32>(static_cast<f32>(OCCLUSION_BUFFER_WIDTH) / std::max(aspect, 0.01f)));
+
+    struct Occluder {
+        glm::mat4 model_matrix = {};
+        const OccluderMesh* mesh = {};
+        // roughly the solid angle of the bounds
+        f32 priority = {};
+    };
+    std::vector<Occluder> occluders = {};
+    CullingBounds occluder_bounds = {};
+
+    // the transform is rebuilt rather than read, Scene::update only writes model_matrix after this returns
+    scene->iterate([&](Entity entity){
+        if(!entity.has_component<MeshComponent>() || !entity.has_component<TransformComponent>()) { return; }
+        auto& mesh = entity.get_component<MeshComponent>();
+        if(!mesh.model || !mesh.model->is_ready()) { return; }
+
+        glm::mat4 model_matrix = entity.get_component<TransformComponent>().compute_model_matrix();
+        for(usize i = 0; i < mesh.model->occluders.size(); i++) {
+            const auto& occluder = mesh.model->occluders[i];
+            if(occluder.indices.empty()) { continue; }
+
+            const auto& primitive = mesh.model->primitives[i];
+            glm::vec3 min = *reinterpret_cast<const glm::vec3*>(&primitive.position_min);
+            glm::vec3 max = min + *reinterpret_cast<const glm::vec3*>(&primitive.position_scale);
+            auto [world_min, world_max] = transform_bounds(model_matrix, min, max);
+
+            f32 radius = glm::length(world_max - world_min) * 0.5f;
+            f32 distance = std::max(glm::distance((world_min + world_max) * 0.5f, camera_position) - radius, 0.1f);
+            occluders.push_back(Occluder { .model_matrix = model_matrix, .mesh = &occluder, .priority = radius * radius / (distance * distance) });
+            occluder_bounds.push(world_min, world_max);
+        }
+    });
+
+    std::vector<u32> visible = {};
+    cull_boxes(occluder_bounds, extract_frustum(camera_projection_view), visible);
+    std::sort(visible.begin(), visible.end(), [&](u32 a, u32 b){ return occluders[a].priority > occluders[b].priority; });
+
+    occluder_triangles.clear();
+    usize triangle_count = 0;
+    for(u32 index : visible) {
+        const auto& occluder = occluders[index];
+        usize occluder_triangle_count = occluder.mesh->indices.size() / 3;
+        if(triangle_count + occluder_triangle_count > OCCLUDER_TRIANGLE_BUDGET) { continue; }
+        triangle_count += occluder_triangle_count;
+        project_occluder(occlusion_buffer, camera_projection_view * occluder.model_matrix, occluder.mesh->positions, occluder.mesh->indices, occluder_triangles);
+    }
+
+    // bands of tile rows dont share pixels, so every worker takes one
+    u32 band_count = std::clamp(static_cast<u32>(pool.get_thread_count()), 1u, occlusion_buffer.tiles_y);
+    u32 rows_per_band = (occlusion_buffer.tiles_y + band_count - 1) / band_count;
+    for(u32 first_row = 0; first_row < occlusion_buffer.tiles_y; first_row += rows_per_band) {
+        occlusion_jobs.push_back(pool.submit([this, first_row, rows_per_band]{
+            PROFILE_SCOPE("DrawList::rasterize_occluders");
+            rasterize_occluders(occlusion_buffer, occluder_triangles, first_row, rows_per_band);
+        }));
+    }
+}
+
+void DrawList::gather(Scene* scene) {
+    PROFILE_SCOPE("DrawList::gather");
+    items.clear();
+    bounds.clear();
+
+    scene->iterate([&](Entity entity){
+        if(!entity.has_component<MeshComponent>() || !entity.has_component<TransformComponent>()) { return; }
+        auto& mesh = entity.get_component<MeshComponent>();
+        // models that are still streaming in are skipped until their geometry is uploaded
+        if(!mesh.model || !mesh.model->is_ready()) { return; }
+
+        const glm::mat4& model_matrix = entity.get_component<TransformComponent>().model_matrix;
+        for(u32 i = 0; i < static_cast<u32>(mesh.model->primitives.size()); i++) {
+            const auto& primitive = mesh.model->primitives[i];
+            glm::vec3 min = *reinterpret_cast<const glm::vec3*>(&primitive.position_min);
+            glm::vec3 max = min + *reinterpret_cast<const glm::vec3*>(&primitive.position_scale);
+            auto [world_min, world_max] = transform_bounds(model_matrix, min, max);
+
+            items.push_back(DrawItem { .entity = entity, .primitive_index = i });
+            bounds.push(world_min, world_max);
+        }
+    });
+}
+
+void DrawList::cull(const glm::mat4& camera_projection_view, std::span<const glm::mat4> sun_projection_views) {
+    PROFILE_SCOPE("DrawList::cull");
+    camera_visible.clear();
+    sun_visible.clear();
+    cull_boxes(bounds, extract_frustum(camera_projection_view), camera_visible);
+    for(const auto& sun_projection_view : sun_projection_views) {
+        cascade_visible.clear();
+        cull_boxes(bounds, extract_frustum(sun_projection_view), cascade_visible);
+        merged_visible.clear();
+        std::set_union(sun_visible.begin(), sun_visible.end(), cascade_visible.begin(), cascade_visible.end(), std::back_inserter(merged_visible));
+        sun_visible.swap(merged_visible);
+    }
+
+    if(!occlusion_jobs.empty()) {
+        PROFILE_SCOPE("DrawList::cull_occluded");
+        for(auto& job : occlusion_jobs) { job.get(); }
+        occlusion_jobs.clear();
+        cull_occluded(occlusion_buffer, occlusion_projection_view, bounds, camera_visible);
+    }
+}
+
+void DrawList::upload(Context* context) {
+    PROFILE_SCOPE("DrawList::upload");
+    uploaded.clear();
+    std::set_union(camera_visible.begin(), camera_visible.end(), sun_visible.begin(), sun_visible.end(), std::back_inserter(uploaded));
+    // sized by all items rather than the uploaded ones, the visibility history is indexed by item
+    reserve(context, static_cast<u32>(items.size()));
+
+    usize region_offset = static_cast<usize>(capacity) * context->frame_index;
+    DrawInstance* instances = context->device.get_host_address_as<DrawInstance>(instance_buffer) + region_offset;
+    instances_address = context->device.get_device_address(instance_buffer) + region_offset * sizeof(DrawInstance);
+    DrawIndexedIndirect* camera_batches = context->device.get_host_address_as<DrawIndexedIndirect>(batch_buffer) + region_offset * 2;
+    DrawIndexedIndirect* sun_batches = camera_batches + capacity;
+    batch_region_offset = region_offset * 2 * sizeof(DrawIndexedIndirect);
+
+    // the first index of both lods names the index ranges of a primitive in the arena, instances with the same pair
+    // draw the same indices
+    auto get_batch_key = [&](const DrawItem& item) -> u64 {
+        auto& mesh = item.entity.get_component<MeshComponent>();
+        const auto& primitive = mesh.model->primitives[item.primitive_index];
+        const auto& lod = mesh.model->get_lod(primitive, item.primitive_index < mesh.lods.size() ? mesh.lods[item.primitive_index] : 0);
+        const auto& shadow_lod = mesh.model->get_lod(primitive, item.primitive_index < mesh.shadow_lods.size() ? mesh.shadow_lods[item.primitive_index] : 0);
+        return (static_cast<u64>(mesh.model->get_first_index(primitive, lod)) << 32) | mesh.model->get_first_index(primitive, shadow_lod);
+    };
+
+    // keyed in item order where the camera list can be walked along, the instances are written in key order
+    sort_keys.clear();
+    sort_values.clear();
+    std::unordered_map<u64, u32> geometry_ids = {};
+    const glm::vec3 camera_position = *reinterpret_cast<const glm::vec3*>(&context->shader_global_block.globals.camera_position);
+    auto camera_it = camera_visible.begin();
+    for(u32 index : uploaded) {
+        while(camera_it != camera_visible.end() && *camera_it < index) { camera_it++; }
+        bool is_camera_visible = camera_it != camera_visible.end() && *camera_it == index;
+
+        const auto& item = items[index];
+        auto& mesh = item.entity.get_component<MeshComponent>();
+        const auto& primitive = mesh.model->primitives[item.primitive_index];
+        if(primitive.lod_count == 0) { continue; }
+
+        u32 geometry = geometry_ids.try_emplace(get_batch_key(item), static_cast<u32>(geometry_ids.size())).first->second;
+        glm::vec3 center = glm::vec3{ bounds.min_x[index] + bounds.max_x[index], bounds.min_y[index] + bounds.max_y[index], bounds.min_z[index] + bounds.max_z[index] } * 0.5f;
+        sort_keys.push_back(make_draw_key(primitive.index_type_size == 2 ? 0 : 1, mesh.model->get_material_index(primitive), geometry, glm::distance(center, camera_position)));
+        sort_values.push_back(index | (is_camera_visible ? CAMERA_VISIBLE_BIT : 0));
+    }
+    radix_sort(sort_keys, sort_values, key_scratch, value_scratch);
+
+    // a batch ends where the stream or the indices change, the geometry field of the key can wrap around so the
+    // neighbours are compared instead of the keys
+    instance_count = 0;
+    batch_count = 0;
+    stream_batch_counts = {};
+    u64 previous_batch_key = {};
+    for(usize i = 0; i < sort_keys.size(); i++) {
+        u32 index = sort_values[i] & ~CAMERA_VISIBLE_BIT;
+        const auto& item = items[index];
+        auto& mesh = item.entity.get_component<MeshComponent>();
+        auto& transform = item.entity.get_component<TransformComponent>();
+        const auto& primitive = mesh.model->primitives[item.primitive_index];
+        u32 stream = get_draw_key_stream(sort_keys[i]);
+        u64 batch_key = get_batch_key(item);
+
+        if(batch_count == 0 || batch_key != previous_batch_key || stream != get_draw_key_stream(sort_keys[i - 1])) {
+            const auto& lod = mesh.model->get_lod(primitive, item.primitive_index < mesh.lods.size() ? mesh.lods[item.primitive_index] : 0);
+            const auto& shadow_lod = mesh.model->get_lod(primitive, item.primitive_index < mesh.shadow_lods.size() ? mesh.shadow_lods[item.primitive_index] : 0);
+            i32 vertex_offset = static_cast<i32>(mesh.model->get_first_vertex(primitive));
+            camera_batches[batch_count] = DrawIndexedIndirect { lod.index_count, 0, mesh.model->get_first_index(primitive, lod), vertex_offset, instance_count };
+            sun_batches[batch_count] = DrawIndexedIndirect { shadow_lod.index_count, 0, mesh.model->get_first_index(primitive, shadow_lod), vertex_offset, instance_count };
+            stream_batch_counts[stream]++;
+            batch_count++;
+            previous_batch_key = batch_key;
+        }
+
+        DrawInstance& instance = instances[instance_count++];
+        instance.model_matrix = *reinterpret_cast<const f32mat4x4*>(&transform.model_matrix);
+        instance.normal_matrix = *reinterpret_cast<const f32mat4x4*>(&transform.normal_matrix);
+        instance.aabb_min = { bounds.min_x[index], bounds.min_y[index], bounds.min_z[index] };
+        instance.aabb_max = { bounds.max_x[index], bounds.max_y[index], bounds.max_z[index] };
+        instance.position_min = primitive.position_min;
+        instance.position_scale = primitive.position_scale;
+        instance.material_index = mesh.model->get_material_index(primitive);
+        instance.batch_index = batch_count - 1;
+        instance.item_index = index;
+        instance.camera_visible = (sort_values[i] & CAMERA_VISIBLE_BIT) ? 1 : 0;
+    }
+}
+
+auto DrawList::get_instance_indices_address(daxa::Device& device, daxa::BufferId draw_buffer) const -> daxa::BufferDeviceAddress {
+    return device.get_device_address(draw_buffer) + static_cast<usize>(capacity) * sizeof(DrawIndexedIndirect);
+}
+
+void DrawList::draw(daxa::CommandList& cmd, daxa::BufferId index_buffer, daxa::BufferId draw_buffer) const {
+    // the streams follow each other in the batches, a stream without batches records nothing
+    u32 first_batch = 0;
+    for(u32 stream = 0; stream < DRAW_STREAM_COUNT; stream++) {
+        if(stream_batch_counts[stream] == 0) { continue; }
+        cmd.set_index_buffer(index_buffer, 0, stream == 0 ? sizeof(u16) : sizeof(u32));
+        cmd.draw_indirect({
+            .draw_command_buffer = draw_buffer,
+            .draw_command_buffer_read_offset = static_cast<usize>(first_batch) * sizeof(DrawIndexedIndirect),
+            .draw_count = stream_batch_counts[stream],
+            .draw_command_stride = sizeof(DrawIndexedIndirect),
+            .is_indexed = true,
+        });
+        first_batch += stream_batch_counts[stream];
+    }
+}
+
+void DrawList::destroy(daxa::Device& device) {
+    for(auto& job : occlusion_jobs) { job.wait(); }
+    occlusion_jobs.clear();
+    if(!instance_buffer.is_empty()) { device.destroy_buffer(instance_buffer); }
+    if(!batch_buffer.is_empty()) { device.destroy_buffer(batch_buffer); }
+    for(auto* task_buffer : { &camera_draws, &late_draws, &visibility }) {
+        for(auto buffer : task_buffer->get_state().buffers) { device.destroy_buffer(buffer); }
+    }
+    for(auto& task_buffer : sun_draws) {
+        for(auto buffer : task_buffer.get_state().buffers) { device.destroy_buffer(buffer); }
+    }
+}
+
+void DrawList::reserve(Context* context, u32 count) {
+    if(count <= capacity && !instance_buffer.is_empty()) { return; }
+    capacity = std::max({count, capacity * 2, MIN_DRAW_CAPACITY});
+
+    // buffers still used by frames in flight are only released once the gpu is done with them
+    auto& device = context->device;
+    if(!instance_buffer.is_empty()) { device.destroy_buffer(instance_buffer); }
+    instance_buffer = device.create_buffer(daxa::BufferInfo {
+        .size = static_cast<u32>(sizeof(DrawInstance) * capacity * context->frames_in_flight),
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE | daxa::MemoryFlagBits::DEDICATED_MEMORY,
+        .name = "draw instances",
+    });
+    if(!batch_buffer.is_empty()) { device.destroy_buffer(batch_buffer); }
+    batch_buffer = device.create_buffer(daxa::BufferInfo {
+        .size = static_cast<u32>(sizeof(DrawIndexedIndirect) * 2 * capacity * context->frames_in_flight),
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE | daxa::MemoryFlagBits::DEDICATED_MEMORY,
+        .name = "draw batches",
+    });
+
+    std::vector<daxa::TaskBuffer*> draw_buffers = { &camera_draws, &late_draws };
+    for(auto& task_buffer : sun_draws) { draw_buffers.push_back(&task_buffer); }
+    for(auto* task_buffer : draw_buffers) {
+        for(auto buffer : task_buffer->get_state().buffers) { device.destroy_buffer(buffer); }
+        task_buffer->set_buffers({ .buffers = std::array{
+            device.create_buffer(daxa::BufferInfo {
+                .size = static_cast<u32>((sizeof(DrawIndexedIndirect) + sizeof(u32)) * capacity),
+                .allocate_info = daxa::AutoAllocInfo{daxa::MemoryFlagBits::DEDICATED_MEMORY},
+                .name = task_buffer->info().name,
+            })
+        }});
+    }
+
+    for(auto buffer : visibility.get_state().buffers) { device.destroy_buffer(buffer); }
+    visibility.set_buffers({ .buffers = std::array{
+        device.create_buffer(daxa::BufferInfo {
+            .size = static_cast<u32>(sizeof(u32) * capacity),
+            .allocate_info = daxa::AutoAllocInfo{daxa::MemoryFlagBits::DEDICATED_MEMORY},
+            .name = "draw visibility",
+        })
+    }});
+    clear_visibility = true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "occlusion_culling.hpp"
+#include "ecs/entity.hpp"
+
+#include <future>
+
+struct Context;
+class ThreadPool;
+
+struct DrawItem {
+    Entity entity = {};
+    u32 primitive_index = {};
+};
+
+// every primitive of the scene with its world space bounds, gathered and culled by the renderer once per frame right
+// before the task graph runs. the visible lists index items in order, so the primitives of an entity stay together
+struct DrawList {
+    std::vector<DrawItem> items = {};
+    CullingBounds bounds = {};
+    std::vector<u32> camera_visible = {};
+    // visible to any of the sun cascades
+    std::vector<u32> sun_visible = {};
+    std::vector<u32> cascade_visible = {};
+    std::vector<u32> merged_visible = {};
+
+    // cpu occlusion culling of the camera view, begin_occlusion rasterizes the occluders on a pool while the scene
+    // updates and cull waits for them. only frames that began it are occlusion culled
+    OcclusionBuffer occlusion_buffer = {};
+    glm::mat4 occlusion_projection_view = {};
+    std::vector<OccluderTriangle> occluder_triangles = {};
+    std::vector<std::future<void>> occlusion_jobs = {};
+
+    // gpu side, the primitives visible to any frustum are uploaded as DrawInstances and CullDrawsTask splits them
+    // into the indirect draws of every view. the instance buffer is host visible with a region per frame in flight
+    daxa::BufferId instance_buffer = {};
+    // camera draws hold what was visible last frame, late draws what the hiz test found newly visible this frame
+    daxa::TaskBuffer camera_draws = {};
+    daxa::TaskBuffer late_draws = {};
+    // one per cascade, so every cascade only draws its own casters
+    std::array<daxa::TaskBuffer, SUN_CASCADE_COUNT> sun_draws = {};
+    // one u32 per item, whether it passed the hiz test last frame. only lives on the gpu and is cleared once it is
+    // recreated, which sends everything through the late draws for a frame
+    daxa::TaskBuffer visibility = {};
+    bool clear_visibility = true;
+    // visible to any view, the items behind the uploaded instances
+    std::vector<u32> uploaded = {};
+    // the instances are uploaded sorted by make_draw_key, so the ones sharing a primitive and its lods end up next to
+    // each other and form a batch. the gpu cull keeps the order inside a batch
+    std::vector<u64> sort_keys = {};
+    std::vector<u32> sort_values = {};
+    std::vector<u64> key_scratch = {};
+    std::vector<u32> value_scratch = {};
+    // host visible with a region per frame in flight, the command of every batch for the camera and after capacity of
+    // them for the sun cascades, without instances. CullDrawsTask copies them into the draw buffers before it culls
+    daxa::BufferId batch_buffer = {};
+    usize batch_region_offset = {};
+    u32 batch_count = {};
+    std::array<u32, DRAW_STREAM_COUNT> stream_batch_counts = {};
+    u32 capacity = {};
+    u32 instance_count = {};
+    daxa::BufferDeviceAddress instances_address = {};
+
+    // snapshots the occluders biggest on screen on the calling thread, so the scene is free to change once it returns
+    void begin_occlusion(Scene* scene, const glm::mat4& camera_projection_view, const glm::vec3& camera_position, f32 aspect, ThreadPool& pool);
+    void gather(Scene* scene);
+    void cull(const glm::mat4& camera_projection_view, std::span<const glm::mat4> sun_projection_views);
+    void upload(Context* context);
+    // a draw buffer holds capacity indexed draw commands, one per batch, followed by capacity u32 instance indices.
+    // CullDrawsTask fills both and the first_instance of a command points at the indices of its batch, so the vertex
+    // shaders look up their DrawInstance through the index at gl_InstanceIndex. this is the address of those indices
+    auto get_instance_indices_address(daxa::Device& device, daxa::BufferId draw_buffer) const -> daxa::BufferDeviceAddress;
+    // one instanced draw per batch out of a draw buffer, binds the index buffer of each stream. every model lives in
+    // the geometry arena, so the index buffer is the one of the arena
+    void draw(daxa::CommandList& cmd, daxa::BufferId index_buffer, daxa::BufferId draw_buffer) const;
+    void destroy(daxa::Device& device);
+
+private:
+    void reserve(Context* context, u32 item_count);
+};
@@ -0,0 +1,50 @@
+#include "draw_sort.hpp"
+
+#include <bit>
+
+namespace {
+    constexpr u32 RADIX_BITS = 8;
+    constexpr u32 RADIX_SIZE = 1u << RADIX_BITS;
+    constexpr u32 RADIX_PASS_COUNT = 64 / RADIX_BITS;
+}
+
+auto make_draw_key(u32 stream, u32 material, u32 geometry, f32 distance) -> u64 {
+    // the bits of a non negative float sort like the float itself
+    u32 distance_bits = std::bit_cast<u32>(std::max(distance, 0.0f));
+    return (static_cast<u64>(stream & 0x1u) << 63) | (static_cast<u64>(std::min(material, 0xFFFFu)) << 47) | (static_cast<u64>(geometry & 0x7FFFu) << 32) | distance_bits;
+}
+
+auto get_draw_key_stream(u64 key) -> u32 {
+    return static_cast<u32>(key >> 63);
+}
+
+void radix_sort(std::vector<u64>& keys, std::vector<u32>& values, std::vector<u64>& key_scratch, std::vector<u32>& value_scratch) {
+    key_scratch.resize(keys.size());
+    value_scratch.resize(values.size());
+
+    // every histogram in one read of the keys
+    std::array<std::array<u32, RADIX_SIZE>, RADIX_PASS_COUNT> histograms = {};
+    for(u64 key : keys) {
+        for(u32 pass = 0; pass < RADIX_PASS_COUNT; pass++) { histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++; }
+    }
+
+    for(u32 pass = 0; pass < RADIX_PASS_COUNT; pass++) {
+        auto& histogram = histograms[pass];
+        if(std::find(histogram.begin(), histogram.end(), static_cast<u32>(keys.size())) != histogram.end()) { continue; }
+
+        u32 offset = 0;
+        for(auto& count : histogram) {
+            u32 bucket_count = count;
+            count = offset;
+            offset += bucket_count;
+        }
+
+        for(usize i = 0; i < keys.size(); i++) {
+            u32 destination = histogram[(keys[i] >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+            key_scratch[destination] = keys[i];
+            value_scratch[destination] = values[i];
+        }
+        keys.swap(key_scratch);
+        values.swap(value_scratch);
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "pch.hpp"
+
+// most significant first: index stream 1 bit, material 16 bits, geometry 15 bits, view distance 32 bits. the stream
+// is the only state the draws change, the rest keeps the materials and the batches of equal geometry together and then
+// goes front to back, which the depth test of the prepass rejects the most with
+auto make_draw_key(u32 stream, u32 material, u32 geometry, f32 distance) -> u64;
+auto get_draw_key_stream(u64 key) -> u32;
+
+// stable least significant digit radix sort of the keys and the values along them, 8 bits per pass. passes where
+// every key has the same digit are skipped, so keys that only differ in a few fields take a few passes. the scratch
+// vectors are resized as needed and can be kept between calls
+void radix_sort(std::vector<u64>& keys, std::vector<u32>& values, std::vector<u64>& key_scratch, std::vector<u32>& value_scratch);
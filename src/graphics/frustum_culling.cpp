@@ -0,0 +1,160 @@
+#include "frustum_culling.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE2
+#endif
+
+namespace {
+    // the components of the corner furthest along every plane normal, if that corner is behind a plane the whole box is
+    struct PlaneCorner {
+        glm::vec4 plane = {};
+        std::array<const f32*, 3> components = {};
+    };
+
+    auto get_plane_corners(const CullingBounds& bounds, const Frustum& frustum) -> std::array<PlaneCorner, 6> {
+        std::array<PlaneCorner, 6> corners = {};
+        for(usize p = 0; p < frustum.planes.size(); p++) {
+            const glm::vec4& plane = frustum.planes[p];
+            corners[p].plane = plane;
+            corners[p].components = {
+                plane.x > 0.0f ? bounds.max_x.data() : bounds.min_x.data(),
+                plane.y > 0.0f ? bounds.max_y.data() : bounds.min_y.data(),
+                plane.z > 0.0f ? bounds.max_z.data() : bounds.min_z.data(),
+            };
+        }
+        return corners;
+    }
+
+    // writes every lane index and only advances past the visible ones, which avoids a branch per box that is as
+    // unpredictable as the scene. lanes past the end of the bounds hold padding and are dropped
+    template<u32 LANE_COUNT>
+    auto append_visible(u32 mask, usize first, usize count, std::vector<u32>& visible, usize visible_count) -> usize {
+        usize remaining = count - first;
+        if(remaining < LANE_COUNT) { mask &= (1u << remaining) - 1u; }
+        for(u32 lane = 0; lane < LANE_COUNT; lane++) {
+            visible[visible_count] = static_cast<u32>(first) + lane;
+            visible_count += (mask >> lane) & 1u;
+        }
+        return visible_count;
+    }
+}
+
+void CullingBounds::clear() {
+    min_x.clear();
+    min_y.clear();
+    min_z.clear();
+    max_x.clear();
+    max_y.clear();
+    max_z.clear();
+    count = 0;
+}
+
+void CullingBounds::reserve(usize box_count) {
+    usize padded_count = (box_count + CULLING_BATCH_SIZE - 1) / CULLING_BATCH_SIZE * CULLING_BATCH_SIZE;
+    for(auto* components : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z }) { components->reserve(padded_count); }
+}
+
+void CullingBounds::push(const glm::vec3& min, const glm::vec3& max) {
+    if(count % CULLING_BATCH_SIZE == 0) {
+        for(auto* components : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z }) { components->resize(count + CULLING_BATCH_SIZE, 0.0f); }
+    }
+
+    min_x[count] = min.x;
+    min_y[count] = min.y;
+    min_z[count] = min.z;
+    max_x[count] = max.x;
+    max_y[count] = max.y;
+    max_z[count] = max.z;
+    count++;
+}
+
+auto extract_frustum(const glm::mat4& projection_view) -> Frustum {
+    glm::vec4 row_x = { projection_view[0][0], projection_view[1][0], projection_view[2][0], projection_view[3][0] };
+    glm::vec4 row_y = { projection_view[0][1], projection_view[1][1], projection_view[2][1], projection_view[3][1] };
+    glm::vec4 row_z = { projection_view[0][2], projection_view[1][2], projection_view[2][2], projection_view[3][2] };
+    glm::vec4 row_w = { projection_view[0][3], projection_view[1][3], projection_view[2][3], projection_view[3][3] };
+
+    Frustum frustum = {};
+    frustum.planes = { row_w + row_x, row_w - row_x, row_w + row_y, row_w - row_y, row_w + row_z, row_w - row_z };
+    for(auto& plane : frustum.planes) {
+        f32 length = glm::length(glm::vec3{plane});
+        if(length > 0.0f) { plane /= length; }
+    }
+    return frustum;
+}
+
+auto transform_bounds(const glm::mat4& matrix, const glm::vec3& min, const glm::vec3& max) -> std::pair<glm::vec3, glm::vec3> {
+    // Arvo's method, the extent along every world axis is the extent of the box projected onto it
+    glm::vec3 center = glm::vec3{matrix * glm::vec4{(min + max) * 0.5f, 1.0f}};
+    glm::vec3 half_extent = (max - min) * 0.5f;
+    glm::vec3 world_half_extent = glm::abs(glm::vec3{matrix[0]}) * half_extent.x + glm::abs(glm::vec3{matrix[1]}) * half_extent.y + glm::abs(glm::vec3{matrix[2]}) * half_extent.z;
+    return { center - world_half_extent, center + world_half_extent };
+}
+
+void cull_boxes(const CullingBounds& bounds, const Frustum& frustum, std::vector<u32>& visible) {
+#if defined(FRUSTUM_CULLING_AVX2)
+    auto corners = get_plane_corners(bounds, frustum);
+    usize visible_count = visible.size();
+    visible.resize(visible_count + bounds.count + CULLING_BATCH_SIZE);
+    for(usize i = 0; i < bounds.count; i += 8) {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(const auto& corner : corners) {
+            __m256 distance = _mm256_set1_ps(corner.plane.w);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_loadu_ps(corner.components[0] + i), _mm256_set1_ps(corner.plane.x)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_loadu_ps(corner.components[1] + i), _mm256_set1_ps(corner.plane.y)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_loadu_ps(corner.components[2] + i), _mm256_set1_ps(corner.plane.z)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        visible_count = append_visible<8>(static_cast<u32>(_mm256_movemask_ps(inside)), i, bounds.count, visible, visible_count);
+    }
+    visible.resize(visible_count);
+#elif defined(FRUSTUM_CULLING_SSE2)
+    auto corners = get_plane_corners(bounds, frustum);
+    usize visible_count = visible.size();
+    visible.resize(visible_count + bounds.count + CULLING_BATCH_SIZE);
+    for(usize i = 0; i < bounds.count; i += 4) {
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(const auto& corner : corners) {
+            __m128 distance = _mm_set1_ps(corner.plane.w);
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(corner.components[0] + i), _mm_set1_ps(corner.plane.x)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(corner.components[1] + i), _mm_set1_ps(corner.plane.y)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(corner.components[2] + i), _mm_set1_ps(corner.plane.z)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+        }
+        visible_count = append_visible<4>(static_cast<u32>(_mm_movemask_ps(inside)), i, bounds.count, visible, visible_count);
+    }
+    visible.resize(visible_count);
+#else
+    cull_boxes_scalar(bounds, frustum, visible);
+#endif
+}
+
+void cull_boxes_scalar(const CullingBounds& bounds, const Frustum& frustum, std::vector<u32>& visible) {
+    auto corners = get_plane_corners(bounds, frustum);
+    for(usize i = 0; i < bounds.count; i++) {
+        bool inside = true;
+        for(const auto& corner : corners) {
+            // same operation order as the simd kernels so both agree on boxes touching a plane
+            f32 distance = corner.plane.w;
+            distance += corner.components[0][i] * corner.plane.x;
+            distance += corner.components[1][i] * corner.plane.y;
+            distance += corner.components[2][i] * corner.plane.z;
+            inside = inside && distance >= 0.0f;
+        }
+        if(inside) { visible.push_back(static_cast<u32>(i)); }
+    }
+}
+
+auto get_culling_instruction_set() -> std::string_view {
+#if defined(FRUSTUM_CULLING_AVX2)
+    return "avx2";
+#elif defined(FRUSTUM_CULLING_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
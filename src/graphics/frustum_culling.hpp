@@ -0,0 +1,43 @@
+#pragma once
+
+#include "pch.hpp"
+
+// boxes tested per iteration of the culling kernel, the bounds arrays are padded to a multiple of it
+constexpr usize CULLING_BATCH_SIZE = 8;
+
+// world space axis aligned boxes stored one component per array, so the kernel loads the same component of a whole
+// batch of boxes at once
+struct CullingBounds {
+    std::vector<f32> min_x = {};
+    std::vector<f32> min_y = {};
+    std::vector<f32> min_z = {};
+    std::vector<f32> max_x = {};
+    std::vector<f32> max_y = {};
+    std::vector<f32> max_z = {};
+    usize count = {};
+
+    void clear();
+    void reserve(usize box_count);
+    void push(const glm::vec3& min, const glm::vec3& max);
+};
+
+// planes point inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum {
+    std::array<glm::vec4, 6> planes = {};
+};
+
+// Gribb and Hartmann plane extraction. the near plane assumes a -1 to 1 depth range, which also holds every point of a
+// 0 to 1 projection, so the test stays conservative for both
+auto extract_frustum(const glm::mat4& projection_view) -> Frustum;
+
+// bounds of the box after transforming it, for Primitive bounds pass position_min and position_min + position_scale
+auto transform_bounds(const glm::mat4& matrix, const glm::vec3& min, const glm::vec3& max) -> std::pair<glm::vec3, glm::vec3>;
+
+// appends the index of every box that intersects the frustum, in increasing order. uses AVX2 or SSE when the
+// compiler targets them and falls back to cull_boxes_scalar otherwise
+void cull_boxes(const CullingBounds& bounds, const Frustum& frustum, std::vector<u32>& visible);
+// reference implementation with the same results
+void cull_boxes_scalar(const CullingBounds& bounds, const Frustum& frustum, std::vector<u32>& visible);
+
+// instruction set cull_boxes was compiled for
+auto get_culling_instruction_set() -> std::string_view;
@@ -0,0 +1,294 @@
+#include "geometry_arena.hpp"
+
+#include "utils/profiler.hpp"
+
+namespace {
+    auto align_index_size(u64 size) -> u64 {
+        return (size + GeometryArena::INDEX_ALIGNMENT - 1) / GeometryArena::INDEX_ALIGNMENT * GeometryArena::INDEX_ALIGNMENT;
+    }
+
+    auto align_meshlet_size(u64 size) -> u64 {
+        return (size + GeometryArena::MESHLET_ALIGNMENT - 1) / GeometryArena::MESHLET_ALIGNMENT * GeometryArena::MESHLET_ALIGNMENT;
+    }
+
+    auto create_arena_buffer(daxa::Device& device, u64 size, const std::string& name) -> daxa::BufferId {
+        return device.create_buffer({
+            .size = static_cast<u32>(std::max<u64>(size, 1)),
+            .allocate_info = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+            .name = name,
+        });
+    }
+}
+
+GeometryArena::GeometryArena(daxa::Device _device)
+    : device{_device},
+        vertex_allocator{INITIAL_VERTEX_CAPACITY},
+        index_allocator{INITIAL_INDEX_CAPACITY},
+        material_allocator{INITIAL_MATERIAL_CAPACITY},
+        meshlet_allocator{INITIAL_MESHLET_CAPACITY} {
+    vertex_buffer = create_arena_buffer(device, INITIAL_VERTEX_CAPACITY * sizeof(PackedVertex), "arena vertex buffer");
+    position_buffer = create_arena_buffer(device, INITIAL_VERTEX_CAPACITY * sizeof(PackedPosition), "arena position buffer");
+    index_buffer = create_arena_buffer(device, INITIAL_INDEX_CAPACITY, "arena index buffer");
+    material_buffer = create_arena_buffer(device, INITIAL_MATERIAL_CAPACITY * sizeof(Material), "arena material buffer");
+    meshlet_buffer = create_arena_buffer(device, INITIAL_MESHLET_CAPACITY, "arena meshlet buffer");
+}
+
+GeometryArena::~GeometryArena() {
+    device.destroy_buffer(vertex_buffer);
+    device.destroy_buffer(position_buffer);
+    device.destroy_buffer(index_buffer);
+    device.destroy_buffer(material_buffer);
+    device.destroy_buffer(meshlet_buffer);
+}
+
+auto GeometryArena::allocate(daxa::CommandList& cmd_list, u64 vertex_count, u64 index_size, u64 material_count, u64 meshlet_size) -> GeometryHandle {
+    PROFILE_SCOPE("GeometryArena::allocate");
+    u64 aligned_index_size = align_index_size(std::max<u64>(index_size, 1));
+    u64 aligned_meshlet_size = align_meshlet_size(std::max<u64>(meshlet_size, 1));
+
+    auto vertex_offset = vertex_allocator.allocate(vertex_count);
+    auto index_offset = index_allocator.allocate(aligned_index_size, INDEX_ALIGNMENT);
+    auto material_offset = material_allocator.allocate(material_count);
+    auto meshlet_offset = meshlet_allocator.allocate(aligned_meshlet_size, MESHLET_ALIGNMENT);
+
+    if(!vertex_offset || !index_offset || !material_offset || !meshlet_offset) {
+        if(vertex_offset) { vertex_allocator.free(*vertex_offset, vertex_count); }
+        if(index_offset) { index_allocator.free(*index_offset, aligned_index_size); }
+        if(material_offset) { material_allocator.free(*material_offset, material_count); }
+        if(meshlet_offset) { meshlet_allocator.free(*meshlet_offset, aligned_meshlet_size); }
+
+        // relocating packs everything, so the new allocation always fits at the end
+        auto grow = [](const RangeAllocator& allocator, u64 size) -> u64 {
+            return std::max(allocator.get_capacity(), allocator.get_used_size() + std::max<u64>(size, 1)) * 2;
+        };
+
+        relocate(cmd_list,
+            vertex_offset ? vertex_allocator.get_capacity() : grow(vertex_allocator, vertex_count),
+            index_offset ? index_allocator.get_capacity() : grow(index_allocator, aligned_index_size),
+            material_offset ? material_allocator.get_capacity() : grow(material_allocator, material_count),
+            meshlet_offset ? meshlet_allocator.get_capacity() : grow(meshlet_allocator, aligned_meshlet_size));
+
+        vertex_offset = vertex_allocator.allocate(vertex_count);
+        index_offset = index_allocator.allocate(aligned_index_size, INDEX_ALIGNMENT);
+        material_offset = material_allocator.allocate(material_count);
+        meshlet_offset = meshlet_allocator.allocate(aligned_meshlet_size, MESHLET_ALIGNMENT);
+    }
+
+    GeometryHandle handle = {};
+    if(!free_slots.empty()) {
+        handle.index = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        handle.index = static_cast<u32>(slots.size());
+        slots.emplace_back();
+    }
+
+    slots[handle.index] = GeometrySlot {
+        .vertex_offset = vertex_offset.value(),
+        .vertex_count = vertex_count,
+        .index_offset = index_offset.value(),
+        .index_size = index_size,
+        .material_offset = material_offset.value(),
+        .material_count = material_count,
+        .meshlet_offset = meshlet_offset.value(),
+        .meshlet_size = meshlet_size,
+        .alive = true,
+    };
+
+    return handle;
+}
+
+void GeometryArena::free(GeometryHandle handle) {
+    auto& slot = slots[handle.index];
+    vertex_allocator.free(slot.vertex_offset, slot.vertex_count);
+    index_allocator.free(slot.index_offset, align_index_size(std::max<u64>(slot.index_size, 1)));
+    material_allocator.free(slot.material_offset, slot.material_count);
+    meshlet_allocator.free(slot.meshlet_offset, align_meshlet_size(std::max<u64>(slot.meshlet_size, 1)));
+
+    slot = {};
+    free_slots.push_back(handle.index);
+    freed_since_compaction = true;
+}
+
+void GeometryArena::record_geometry_copy(daxa::CommandList& cmd_list, GeometryHandle handle, daxa::BufferId staging_buffer, u64 staging_offset) {
+    const auto& slot = slots[handle.index];
+    if(slot.vertex_count > 0) {
+        cmd_list.copy_buffer_to_buffer({
+            .src_buffer = staging_buffer,
+            .src_offset = static_cast<usize>(staging_offset),
+            .dst_buffer = vertex_buffer,
+            .dst_offset = static_cast<usize>(slot.vertex_offset * sizeof(PackedVertex)),
+            .size = static_cast<usize>(slot.vertex_count * sizeof(PackedVertex)),
+        });
+
+        cmd_list.copy_buffer_to_buffer({
+            .src_buffer = staging_buffer,
+            .src_offset = static_cast<usize>(staging_offset + slot.vertex_count * sizeof(PackedVertex)),
+            .dst_buffer = position_buffer,
+            .dst_offset = static_cast<usize>(slot.vertex_offset * sizeof(PackedPosition)),
+            .size = static_cast<usize>(slot.vertex_count * sizeof(PackedPosition)),
+        });
+    }
+
+    if(slot.index_size > 0) {
+        cmd_list.copy_buffer_to_buffer({
+            .src_buffer = staging_buffer,
+            .src_offset = static_cast<usize>(staging_offset + slot.vertex_count * (sizeof(PackedVertex) + sizeof(PackedPosition))),
+            .dst_buffer = index_buffer,
+            .dst_offset = static_cast<usize>(slot.index_offset),
+            .size = static_cast<usize>(slot.index_size),
+        });
+    }
+}
+
+void GeometryArena::record_material_copy(daxa::CommandList& cmd_list, GeometryHandle handle, daxa::BufferId staging_buffer, u64 staging_offset) {
+    const auto& slot = slots[handle.index];
+    if(slot.material_count == 0) { return; }
+
+    cmd_list.copy_buffer_to_buffer({
+        .src_buffer = staging_buffer,
+        .src_offset = static_cast<usize>(staging_offset),
+        .dst_buffer = material_buffer,
+        .dst_offset = static_cast<usize>(slot.material_offset * sizeof(Material)),
+        .size = static_cast<usize>(slot.material_count * sizeof(Material)),
+    });
+}
+
+void GeometryArena::record_meshlet_copy(daxa::CommandList& cmd_list, GeometryHandle handle, daxa::BufferId staging_buffer, u64 staging_offset) {
+    const auto& slot = slots[handle.index];
+    if(slot.meshlet_size == 0) { return; }
+
+    cmd_list.copy_buffer_to_buffer({
+        .src_buffer = staging_buffer,
+        .src_offset = static_cast<usize>(staging_offset),
+        .dst_buffer = meshlet_buffer,
+        .dst_offset = static_cast<usize>(slot.meshlet_offset),
+        .size = static_cast<usize>(slot.meshlet_size),
+    });
+}
+
+void GeometryArena::defragment_if_needed() {
+    if(!freed_since_compaction) { return; }
+    freed_since_compaction = false;
+
+    // only worth a full copy when the free space is split up so much that a big model might not fit anymore
+    auto is_fragmented = [](const RangeAllocator& allocator) -> bool {
+        return allocator.get_free_size() > allocator.get_capacity() / 4 && allocator.get_largest_free_range() < allocator.get_free_size() / 2;
+    };
+
+    if(is_fragmented(vertex_allocator) || is_fragmented(index_allocator) || is_fragmented(material_allocator) || is_fragmented(meshlet_allocator)) {
+        auto cmd_list = device.create_command_list({
+            .name = "geometry arena compaction",
+        });
+
+        relocate(cmd_list, vertex_allocator.get_capacity(), index_allocator.get_capacity(), material_allocator.get_capacity(), meshlet_allocator.get_capacity());
+        cmd_list.complete();
+
+        device.submit_commands({
+            .command_lists = {std::move(cmd_list)},
+        });
+    }
+}
+
+void GeometryArena::relocate(daxa::CommandList& cmd_list, u64 vertex_capacity, u64 index_capacity, u64 material_capacity, u64 meshlet_capacity) {
+    PROFILE_SCOPE("GeometryArena::relocate");
+    daxa::BufferId new_vertex_buffer = create_arena_buffer(device, vertex_capacity * sizeof(PackedVertex), "arena vertex buffer");
+    daxa::BufferId new_position_buffer = create_arena_buffer(device, vertex_capacity * sizeof(PackedPosition), "arena position buffer");
+    daxa::BufferId new_index_buffer = create_arena_buffer(device, index_capacity, "arena index buffer");
+    daxa::BufferId new_material_buffer = create_arena_buffer(device, material_capacity * sizeof(Material), "arena material buffer");
+    daxa::BufferId new_meshlet_buffer = create_arena_buffer(device, meshlet_capacity, "arena meshlet buffer");
+
+    // earlier frames and copies on the queue have to be done with the old buffers before they are read
+    cmd_list.pipeline_barrier({
+        .src_access = daxa::AccessConsts::READ_WRITE,
+        .dst_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
+    });
+
+    u64 vertex_end = 0;
+    u64 index_end = 0;
+    u64 material_end = 0;
+    u64 meshlet_end = 0;
+    for(auto& slot : slots) {
+        if(!slot.alive) { continue; }
+
+        if(slot.vertex_count > 0) {
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = vertex_buffer,
+                .src_offset = static_cast<usize>(slot.vertex_offset * sizeof(PackedVertex)),
+                .dst_buffer = new_vertex_buffer,
+                .dst_offset = static_cast<usize>(vertex_end * sizeof(PackedVertex)),
+                .size = static_cast<usize>(slot.vertex_count * sizeof(PackedVertex)),
+            });
+
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = position_buffer,
+                .src_offset = static_cast<usize>(slot.vertex_offset * sizeof(PackedPosition)),
+                .dst_buffer = new_position_buffer,
+                .dst_offset = static_cast<usize>(vertex_end * sizeof(PackedPosition)),
+                .size = static_cast<usize>(slot.vertex_count * sizeof(PackedPosition)),
+            });
+        }
+
+        if(slot.index_size > 0) {
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = index_buffer,
+                .src_offset = static_cast<usize>(slot.index_offset),
+                .dst_buffer = new_index_buffer,
+                .dst_offset = static_cast<usize>(index_end),
+                .size = static_cast<usize>(slot.index_size),
+            });
+        }
+
+        if(slot.material_count > 0) {
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = material_buffer,
+                .src_offset = static_cast<usize>(slot.material_offset * sizeof(Material)),
+                .dst_buffer = new_material_buffer,
+                .dst_offset = static_cast<usize>(material_end * sizeof(Material)),
+                .size = static_cast<usize>(slot.material_count * sizeof(Material)),
+            });
+        }
+
+        if(slot.meshlet_size > 0) {
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = meshlet_buffer,
+                .src_offset = static_cast<usize>(slot.meshlet_offset),
+                .dst_buffer = new_meshlet_buffer,
+                .dst_offset = static_cast<usize>(meshlet_end),
+                .size = static_cast<usize>(slot.meshlet_size),
+            });
+        }
+
+        slot.vertex_offset = vertex_end;
+        slot.index_offset = index_end;
+        slot.material_offset = material_end;
+        slot.meshlet_offset = meshlet_end;
+        vertex_end += std::max<u64>(slot.vertex_count, 1);
+        index_end += align_index_size(std::max<u64>(slot.index_size, 1));
+        material_end += std::max<u64>(slot.material_count, 1);
+        meshlet_end += align_meshlet_size(std::max<u64>(slot.meshlet_size, 1));
+    }
+
+    cmd_list.pipeline_barrier({
+        .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+        .dst_access = daxa::AccessConsts::READ,
+    });
+
+    // frames already submitted still read the old buffers, they are only destroyed once this list retires
+    cmd_list.destroy_buffer_deferred(vertex_buffer);
+    cmd_list.destroy_buffer_deferred(position_buffer);
+    cmd_list.destroy_buffer_deferred(index_buffer);
+    cmd_list.destroy_buffer_deferred(material_buffer);
+    cmd_list.destroy_buffer_deferred(meshlet_buffer);
+
+    vertex_buffer = new_vertex_buffer;
+    position_buffer = new_position_buffer;
+    index_buffer = new_index_buffer;
+    material_buffer = new_material_buffer;
+    meshlet_buffer = new_meshlet_buffer;
+
+    vertex_allocator.reset(vertex_capacity, vertex_end);
+    index_allocator.reset(index_capacity, index_end);
+    material_allocator.reset(material_capacity, material_end);
+    meshlet_allocator.reset(meshlet_capacity, meshlet_end);
+}
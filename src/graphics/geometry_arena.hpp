@@ -0,0 +1,73 @@
+#pragma once
+
+#include "pch.hpp"
+#include "utils/range_allocator.hpp"
+
+struct GeometryHandle {
+    u32 index = std::numeric_limits<u32>::max();
+
+    [[nodiscard]] auto is_valid() const -> bool { return index != std::numeric_limits<u32>::max(); }
+};
+
+// where one model lives inside the arena, vertices and materials are counted in elements, indices and meshlets in bytes
+struct GeometrySlot {
+    u64 vertex_offset = {};
+    u64 vertex_count = {};
+    u64 index_offset = {};
+    u64 index_size = {};
+    u64 material_offset = {};
+    u64 material_count = {};
+    u64 meshlet_offset = {};
+    u64 meshlet_size = {};
+    bool alive = false;
+};
+
+// one vertex, index and material buffer shared by every model, so a pass binds its index buffer once and every
+// primitive is addressed by offsets into the same buffers. space is handed out by first fit free lists, the buffers
+// grow when they run out and are compacted once unloading left them fragmented. main thread only, offsets of a slot
+// change whenever the arena relocates, so they have to be read again every frame
+struct GeometryArena {
+    static constexpr u64 INITIAL_VERTEX_CAPACITY = 1 << 20;
+    static constexpr u64 INITIAL_INDEX_CAPACITY = 16 << 20;
+    static constexpr u64 INITIAL_MATERIAL_CAPACITY = 1024;
+    static constexpr u64 INITIAL_MESHLET_CAPACITY = 4 << 20;
+    static constexpr u64 INDEX_ALIGNMENT = sizeof(u32);
+    static constexpr u64 MESHLET_ALIGNMENT = 16;
+
+    GeometryArena(daxa::Device _device);
+    ~GeometryArena();
+
+    // a relocation needed to make room is recorded into cmd_list, ahead of whatever the caller records next
+    auto allocate(daxa::CommandList& cmd_list, u64 vertex_count, u64 index_size, u64 material_count, u64 meshlet_size) -> GeometryHandle;
+    void free(GeometryHandle handle);
+    [[nodiscard]] auto get_slot(GeometryHandle handle) const -> const GeometrySlot& { return slots[handle.index]; }
+
+    // copies from staging memory laid out as vertices, positions and then indices
+    void record_geometry_copy(daxa::CommandList& cmd_list, GeometryHandle handle, daxa::BufferId staging_buffer, u64 staging_offset);
+    void record_material_copy(daxa::CommandList& cmd_list, GeometryHandle handle, daxa::BufferId staging_buffer, u64 staging_offset);
+    void record_meshlet_copy(daxa::CommandList& cmd_list, GeometryHandle handle, daxa::BufferId staging_buffer, u64 staging_offset);
+
+    // compacts the live geometry once freed space is scattered enough to matter, call between frames
+    void defragment_if_needed();
+
+    daxa::BufferId vertex_buffer = {};
+    // position only stream for depth passes, shares vertex offsets with vertex_buffer
+    daxa::BufferId position_buffer = {};
+    daxa::BufferId index_buffer = {};
+    daxa::BufferId material_buffer = {};
+    // meshlets, meshlet vertices and meshlet triangles of a model back to back, see Model::get_meshlet_layout
+    daxa::BufferId meshlet_buffer = {};
+
+private:
+    // moves every live slot into fresh buffers of the given capacities, packed from the start
+    void relocate(daxa::CommandList& cmd_list, u64 vertex_capacity, u64 index_capacity, u64 material_capacity, u64 meshlet_capacity);
+
+    daxa::Device device = {};
+    RangeAllocator vertex_allocator = {};
+    RangeAllocator index_allocator = {};
+    RangeAllocator material_allocator = {};
+    RangeAllocator meshlet_allocator = {};
+    std::vector<GeometrySlot> slots = {};
+    std::vector<u32> free_slots = {};
+    bool freed_since_compaction = false;
+};
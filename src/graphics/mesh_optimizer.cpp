@@ -0,0 +1,302 @@
+#include "mesh_optimizer.hpp"
+#include "model_importer.hpp"
+
+#include "utils/threadpool.hpp"
+#include "utils/profiler.hpp"
+
+namespace {
+    constexpr u32 INVALID_VERTEX = std::numeric_limits<u32>::max();
+
+    // triangles around every vertex in one flat array, triangles of vertex v are at offsets[v] .. offsets[v + 1]
+    struct Adjacency {
+        std::vector<u32> offsets = {};
+        std::vector<u32> triangles = {};
+    };
+
+    auto build_adjacency(std::span<const u32> indices, u32 vertex_count) -> Adjacency {
+        Adjacency adjacency = {};
+        adjacency.offsets.resize(vertex_count + 1, 0);
+        for(u32 index : indices) { adjacency.offsets[index + 1]++; }
+        for(u32 v = 0; v < vertex_count; v++) { adjacency.offsets[v + 1] += adjacency.offsets[v]; }
+
+        adjacency.triangles.resize(indices.size());
+        std::vector<u32> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for(usize i = 0; i < indices.size(); i++) {
+            adjacency.triangles[fill[indices[i]]++] = static_cast<u32>(i / 3);
+        }
+
+        return adjacency;
+    }
+
+    // a vertex is in the cache while fewer than cache_size misses happened since it was loaded, which is exactly a fifo
+    struct CacheSimulation {
+        std::vector<u32> cache_time = {};
+        u32 timestamp = {};
+        u32 cache_size = {};
+
+        CacheSimulation(u32 vertex_count, u32 _cache_size) : cache_time(vertex_count, 0), timestamp{_cache_size + 1}, cache_size{_cache_size} {}
+
+        auto access(u32 vertex) -> u32 {
+            if(timestamp - cache_time[vertex] > cache_size) {
+                cache_time[vertex] = timestamp++;
+                return 1;
+            }
+            return 0;
+        }
+
+        void flush() { timestamp += cache_size + 1; }
+    };
+
+    auto triangle_normal(std::span<const Vertex> vertices, const u32* triangle) -> glm::vec3 {
+        glm::vec3 p0 = {vertices[triangle[0]].position.x, vertices[triangle[0]].position.y, vertices[triangle[0]].position.z};
+        glm::vec3 p1 = {vertices[triangle[1]].position.x, vertices[triangle[1]].position.y, vertices[triangle[1]].position.z};
+        glm::vec3 p2 = {vertices[triangle[2]].position.x, vertices[triangle[2]].position.y, vertices[triangle[2]].position.z};
+        // length is twice the area, so summing these weights every triangle by its size
+        return glm::cross(p1 - p0, p2 - p0);
+    }
+
+    auto triangle_centroid(std::span<const Vertex> vertices, const u32* triangle) -> glm::vec3 {
+        glm::vec3 sum = {};
+        for(u32 i = 0; i < 3; i++) {
+            sum += glm::vec3{vertices[triangle[i]].position.x, vertices[triangle[i]].position.y, vertices[triangle[i]].position.z};
+        }
+        return sum / 3.0f;
+    }
+}
+
+auto analyze_vertex_cache(std::span<const u32> indices, u32 vertex_count, u32 cache_size) -> VertexCacheStats {
+    VertexCacheStats stats = { .vertex_count = vertex_count, .triangle_count = indices.size() / 3 };
+    CacheSimulation cache{vertex_count, cache_size};
+    for(u32 index : indices) {
+        stats.transformed_vertex_count += cache.access(index);
+    }
+    return stats;
+}
+
+void optimize_vertex_cache(std::span<u32> indices, u32 vertex_count, u32 cache_size) {
+    PROFILE_SCOPE("optimize_vertex_cache");
+    if(indices.size() < 3 || vertex_count == 0) { return; }
+
+    u32 triangle_count = static_cast<u32>(indices.size() / 3);
+    Adjacency adjacency = build_adjacency(indices, vertex_count);
+
+    std::vector<u32> live_triangles(vertex_count);
+    for(u32 v = 0; v < vertex_count; v++) { live_triangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v]; }
+
+    std::vector<u32> output = {};
+    output.reserve(indices.size());
+    std::vector<u32> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<u32> dead_end_stack = {};
+    std::vector<u32> candidates = {};
+    u32 timestamp = cache_size + 1;
+    u32 cursor = 0;
+
+    u32 fanning_vertex = indices[0];
+    while(fanning_vertex != INVALID_VERTEX) {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for(u32 i = adjacency.offsets[fanning_vertex]; i < adjacency.offsets[fanning_vertex + 1]; i++) {
+            u32 triangle = adjacency.triangles[i];
+            if(emitted[triangle]) { continue; }
+            emitted[triangle] = true;
+
+            for(u32 corner = 0; corner < 3; corner++) {
+                u32 vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                dead_end_stack.push_back(vertex);
+                candidates.push_back(vertex);
+                live_triangles[vertex]--;
+                if(timestamp - cache_time[vertex] > cache_size) { cache_time[vertex] = timestamp++; }
+            }
+        }
+
+        // the next fan is around the candidate that stays in the cache the longest, as long as fanning it doesnt
+        // push it out halfway through
+        u32 best_vertex = INVALID_VERTEX;
+        u32 best_priority = 0;
+        for(u32 vertex : candidates) {
+            if(live_triangles[vertex] == 0) { continue; }
+            u32 priority = 0;
+            if(timestamp - cache_time[vertex] + 2 * live_triangles[vertex] <= cache_size) { priority = timestamp - cache_time[vertex]; }
+            if(best_vertex == INVALID_VERTEX || priority > best_priority) {
+                best_vertex = vertex;
+                best_priority = priority;
+            }
+        }
+
+        // dead end, go back to the most recently used vertex that still has triangles left and then to the cursor
+        while(best_vertex == INVALID_VERTEX && !dead_end_stack.empty()) {
+            u32 vertex = dead_end_stack.back();
+            dead_end_stack.pop_back();
+            if(live_triangles[vertex] > 0) { best_vertex = vertex; }
+        }
+
+        while(best_vertex == INVALID_VERTEX && cursor < vertex_count) {
+            if(live_triangles[cursor] > 0) { best_vertex = cursor; }
+            cursor++;
+        }
+
+        fanning_vertex = best_vertex;
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void optimize_overdraw(std::span<u32> indices, std::span<const Vertex> vertices, f32 threshold, u32 cache_size) {
+    PROFILE_SCOPE("optimize_overdraw");
+    u32 vertex_count = static_cast<u32>(vertices.size());
+    usize triangle_count = indices.size() / 3;
+    if(triangle_count < 2) { return; }
+
+    std::vector<u32> misses(triangle_count);
+    CacheSimulation cache{vertex_count, cache_size};
+    u64 total_misses = 0;
+    for(usize t = 0; t < triangle_count; t++) {
+        misses[t] = cache.access(indices[t * 3 + 0]) + cache.access(indices[t * 3 + 1]) + cache.access(indices[t * 3 + 2]);
+        total_misses += misses[t];
+    }
+
+    // a triangle where every vertex misses starts from a cold cache anyway, so splitting there is free
+    std::vector<usize> hard_boundaries = {};
+    for(usize t = 0; t < triangle_count; t++) {
+        if(t == 0 || misses[t] == 3) { hard_boundaries.push_back(t); }
+    }
+    hard_boundaries.push_back(triangle_count);
+
+    // inside a hard cluster a new one starts as soon as the current one alone is already as cache friendly as the
+    // whole mesh, the cache is flushed at every split so the estimate stays pessimistic
+    f64 cluster_threshold = static_cast<f64>(threshold) * static_cast<f64>(total_misses) / static_cast<f64>(triangle_count);
+    std::vector<usize> clusters = {};
+    for(usize h = 0; h + 1 < hard_boundaries.size(); h++) {
+        cache.flush();
+        usize cluster_start = hard_boundaries[h];
+        u64 cluster_misses = 0;
+        clusters.push_back(cluster_start);
+
+        for(usize t = hard_boundaries[h]; t < hard_boundaries[h + 1]; t++) {
+            cluster_misses += cache.access(indices[t * 3 + 0]) + cache.access(indices[t * 3 + 1]) + cache.access(indices[t * 3 + 2]);
+            if(t + 1 < hard_boundaries[h + 1] && static_cast<f64>(cluster_misses) <= cluster_threshold * static_cast<f64>(t + 1 - cluster_start)) {
+                cache.flush();
+                cluster_start = t + 1;
+                cluster_misses = 0;
+                clusters.push_back(cluster_start);
+            }
+        }
+    }
+    clusters.push_back(triangle_count);
+
+    glm::vec3 mesh_centroid = {};
+    f32 mesh_area = 0.0f;
+    for(usize t = 0; t < triangle_count; t++) {
+        f32 area = glm::length(triangle_normal(vertices, &indices[t * 3]));
+        mesh_centroid += triangle_centroid(vertices, &indices[t * 3]) * area;
+        mesh_area += area;
+    }
+    if(mesh_area > 0.0f) { mesh_centroid /= mesh_area; }
+
+    // clusters that face away from the center of the mesh are likely in front of the rest, drawing them first
+    // fills depth early
+    struct ClusterOrder {
+        usize cluster = {};
+        f32 sort_key = {};
+    };
+
+    std::vector<ClusterOrder> order(clusters.size() - 1);
+    for(usize c = 0; c + 1 < clusters.size(); c++) {
+        glm::vec3 normal = {};
+        glm::vec3 centroid = {};
+        f32 area = 0.0f;
+        for(usize t = clusters[c]; t < clusters[c + 1]; t++) {
+            glm::vec3 triangle = triangle_normal(vertices, &indices[t * 3]);
+            f32 triangle_area = glm::length(triangle);
+            normal += triangle;
+            centroid += triangle_centroid(vertices, &indices[t * 3]) * triangle_area;
+            area += triangle_area;
+        }
+
+        f32 normal_length = glm::length(normal);
+        if(area > 0.0f) { centroid /= area; }
+        order[c] = ClusterOrder {
+            .cluster = c,
+            .sort_key = normal_length > 0.0f ? glm::dot(centroid - mesh_centroid, normal / normal_length) : 0.0f,
+        };
+    }
+
+    std::stable_sort(order.begin(), order.end(), [](const ClusterOrder& a, const ClusterOrder& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<u32> output = {};
+    output.reserve(indices.size());
+    for(const auto& cluster : order) {
+        output.insert(output.end(), indices.begin() + static_cast<std::ptrdiff_t>(clusters[cluster.cluster] * 3), indices.begin() + static_cast<std::ptrdiff_t>(clusters[cluster.cluster + 1] * 3));
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void optimize_vertex_fetch(std::span<u32> indices, std::span<Vertex> vertices) {
+    PROFILE_SCOPE("optimize_vertex_fetch");
+    std::vector<u32> remap(vertices.size(), INVALID_VERTEX);
+    std::vector<Vertex> output = {};
+    output.reserve(vertices.size());
+
+    for(u32& index : indices) {
+        if(remap[index] == INVALID_VERTEX) {
+            remap[index] = static_cast<u32>(output.size());
+            output.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    for(usize v = 0; v < vertices.size(); v++) {
+        if(remap[v] == INVALID_VERTEX) { output.push_back(vertices[v]); }
+    }
+
+    std::copy(output.begin(), output.end(), vertices.begin());
+}
+
+auto is_triangle_list(std::span<const u32> indices, u32 vertex_count) -> bool {
+    if(indices.size() % 3 != 0) { return false; }
+    return std::all_of(indices.begin(), indices.end(), [&](u32 index) { return index < vertex_count; });
+}
+
+auto optimize_model(ModelData& model, ThreadPool* pool) -> MeshOptimizationStats {
+    PROFILE_SCOPE("optimize_model");
+    std::vector<MeshOptimizationStats> primitive_stats(model.primitives.size());
+
+    auto process_primitive = [&](usize i) {
+        const auto& primitive = model.primitives[i];
+        std::span<u32> indices = std::span{model.indices}.subspan(primitive.first_index, primitive.index_count);
+        std::span<Vertex> vertices = std::span{model.vertices}.subspan(primitive.first_vertex, primitive.vertex_count);
+
+        primitive_stats[i].before = analyze_vertex_cache(indices, primitive.vertex_count);
+        optimize_vertex_cache(indices, primitive.vertex_count);
+        optimize_overdraw(indices, vertices);
+        optimize_vertex_fetch(indices, vertices);
+        primitive_stats[i].after = analyze_vertex_cache(indices, primitive.vertex_count);
+    };
+
+    // primitives own disjoint ranges of the vertex and index arrays, so they can be processed side by side.
+    // the adjacency and cache passes index per vertex arrays with every index, so malformed primitives are left as they are
+    std::vector<std::future<void>> jobs = {};
+    for(usize i = 0; i < model.primitives.size(); i++) {
+        const auto& primitive = model.primitives[i];
+        if(primitive.index_count < 3) { continue; }
+        if(!is_triangle_list(std::span{model.indices}.subspan(primitive.first_index, primitive.index_count), primitive.vertex_count)) { continue; }
+        if(pool != nullptr) { jobs.push_back(pool->submit(process_primitive, i)); } else { process_primitive(i); }
+    }
+
+    ThreadPool::wait_for_futures(jobs);
+
+    MeshOptimizationStats stats = {};
+    for(const auto& primitive : primitive_stats) {
+        stats.before.vertex_count += primitive.before.vertex_count;
+        stats.before.triangle_count += primitive.before.triangle_count;
+        stats.before.transformed_vertex_count += primitive.before.transformed_vertex_count;
+        stats.after.vertex_count += primitive.after.vertex_count;
+        stats.after.triangle_count += primitive.after.triangle_count;
+        stats.after.transformed_vertex_count += primitive.after.transformed_vertex_count;
+    }
+
+    return stats;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "pch.hpp"
+
+class ThreadPool;
+struct ModelData;
+
+// post transform cache behaviour of an index buffer, simulated with a fifo cache
+struct VertexCacheStats {
+    u64 vertex_count = {};
+    u64 triangle_count = {};
+    u64 transformed_vertex_count = {};
+
+    // average cache miss ratio, transformed vertices per triangle. 0.5 is the best a regular grid can do, 3 means no reuse at all
+    [[nodiscard]] auto get_acmr() const -> f64 { return triangle_count > 0 ? static_cast<f64>(transformed_vertex_count) / static_cast<f64>(triangle_count) : 0.0; }
+    // average transform to vertex ratio, 1 means every vertex is shaded exactly once
+    [[nodiscard]] auto get_atvr() const -> f64 { return vertex_count > 0 ? static_cast<f64>(transformed_vertex_count) / static_cast<f64>(vertex_count) : 0.0; }
+};
+
+struct MeshOptimizationStats {
+    VertexCacheStats before = {};
+    VertexCacheStats after = {};
+};
+
+// fifo size used by the simulation and the reordering, close to what current gpus reuse in practice
+constexpr u32 VERTEX_CACHE_SIZE = 16;
+// how much worse than the cache optimized order a cluster may be before overdraw ordering stops splitting it further
+constexpr f32 OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+auto analyze_vertex_cache(std::span<const u32> indices, u32 vertex_count, u32 cache_size = VERTEX_CACHE_SIZE) -> VertexCacheStats;
+
+// tipsify (Sander et al. 2007), reorders triangles so consecutive ones share vertices while they are still in the cache
+void optimize_vertex_cache(std::span<u32> indices, u32 vertex_count, u32 cache_size = VERTEX_CACHE_SIZE);
+// splits the cache optimized order into clusters and sorts them so outward facing ones are drawn first, which lets
+// early depth reject more of what lies behind them. the clusters keep their order inside, so the cache hit rate stays
+// within threshold of the input
+void optimize_overdraw(std::span<u32> indices, std::span<const Vertex> vertices, f32 threshold = OVERDRAW_ACMR_THRESHOLD, u32 cache_size = VERTEX_CACHE_SIZE);
+// renumbers vertices in the order they are first referenced so fetches walk through memory linearly, unreferenced
+// vertices end up at the back
+void optimize_vertex_fetch(std::span<u32> indices, std::span<Vertex> vertices);
+
+// whole triangles only and every index inside the vertex range, the passes below assume both
+auto is_triangle_list(std::span<const u32> indices, u32 vertex_count) -> bool;
+
+// runs all three passes over every indexed primitive, one task per primitive or one after another on the calling
+// thread without a pool. indices have to be relative to the first vertex of their primitive and the packed vertices
+// have to be rebuilt afterwards
+auto optimize_model(ModelData& model, ThreadPool* pool) -> MeshOptimizationStats;
@@ -0,0 +1,319 @@
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+#include "model_importer.hpp"
+
+#include <numeric>
+
+#include "utils/threadpool.hpp"
+#include "utils/profiler.hpp"
+
+namespace {
+    // symmetric 4x4 matrix of the summed squared plane distances, weight is the area the planes came from
+    struct Quadric {
+        f64 a2 = {}, ab = {}, ac = {}, ad = {};
+        f64 b2 = {}, bc = {}, bd = {};
+        f64 c2 = {}, cd = {};
+        f64 d2 = {};
+        f64 weight = {};
+
+        static auto from_plane(const glm::dvec3& normal, f64 distance, f64 _weight) -> Quadric {
+            return Quadric {
+                .a2 = normal.x * normal.x * _weight, .ab = normal.x * normal.y * _weight, .ac = normal.x * normal.z * _weight, .ad = normal.x * distance * _weight,
+                .b2 = normal.y * normal.y * _weight, .bc = normal.y * normal.z * _weight, .bd = normal.y * distance * _weight,
+                .c2 = normal.z * normal.z * _weight, .cd = normal.z * distance * _weight,
+                .d2 = distance * distance * _weight,
+                .weight = _weight,
+            };
+        }
+
+        auto operator+=(const Quadric& other) -> Quadric& {
+            a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+            b2 += other.b2; bc += other.bc; bd += other.bd;
+            c2 += other.c2; cd += other.cd;
+            d2 += other.d2;
+            weight += other.weight;
+            return *this;
+        }
+
+        // mean squared distance of p to the planes
+        [[nodiscard]] auto evaluate(const glm::dvec3& p) const -> f64 {
+            f64 error = a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x
+                      + b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y
+                      + c2 * p.z * p.z + 2.0 * cd * p.z
+                      + d2;
+            return weight > 0.0 ? std::abs(error) / weight : 0.0;
+        }
+    };
+
+    struct Collapse {
+        u32 from = {};
+        u32 to = {};
+        f64 cost = {};
+    };
+
+    auto get_position(std::span<const Vertex> vertices, u32 index) -> glm::dvec3 {
+        return {vertices[index].position.x, vertices[index].position.y, vertices[index].position.z};
+    }
+
+    auto edge_key(u32 a, u32 b) -> u64 {
+        return (static_cast<u64>(std::min(a, b)) << 32) | std::max(a, b);
+    }
+
+    // how close the attributes of two vertices at the same position are, used to pick the replacement for a corner
+    auto attribute_distance(const Vertex& a, const Vertex& b) -> f32 {
+        f32 du = a.uv.x - b.uv.x;
+        f32 dv = a.uv.y - b.uv.y;
+        f32 dx = a.normal.x - b.normal.x;
+        f32 dy = a.normal.y - b.normal.y;
+        f32 dz = a.normal.z - b.normal.z;
+        return du * du + dv * dv + dx * dx + dy * dy + dz * dz;
+    }
+}
+
+auto simplify_mesh(std::span<const u32> indices, std::span<const Vertex> vertices, usize target_index_count, f32 max_error) -> SimplifiedMesh {
+    PROFILE_SCOPE("simplify_mesh");
+    u32 vertex_count = static_cast<u32>(vertices.size());
+    SimplifiedMesh result = { .indices = {indices.begin(), indices.end()}, .error = 0.0f };
+    if(indices.size() <= target_index_count || vertex_count == 0) { return result; }
+
+    // vertices at the same position are welded into the first of them, wedges of a welded vertex are contiguous in sorted_vertices
+    std::vector<u32> sorted_vertices(vertex_count);
+    std::iota(sorted_vertices.begin(), sorted_vertices.end(), 0u);
+    auto position_less = [&](u32 a, u32 b) {
+        const auto& pa = vertices[a].position;
+        const auto& pb = vertices[b].position;
+        return std::tie(pa.x, pa.y, pa.z, a) < std::tie(pb.x, pb.y, pb.z, b);
+    };
+    std::sort(sorted_vertices.begin(), sorted_vertices.end(), position_less);
+
+    std::vector<u32> weld(vertex_count);
+    std::vector<u32> wedge_start(vertex_count, 0);
+    std::vector<u32> wedge_count(vertex_count, 0);
+    for(u32 i = 0; i < vertex_count;) {
+        u32 j = i;
+        const auto& p = vertices[sorted_vertices[i]].position;
+        while(j < vertex_count && vertices[sorted_vertices[j]].position.x == p.x && vertices[sorted_vertices[j]].position.y == p.y && vertices[sorted_vertices[j]].position.z == p.z) {
+            weld[sorted_vertices[j]] = sorted_vertices[i];
+            j++;
+        }
+        wedge_start[sorted_vertices[i]] = i;
+        wedge_count[sorted_vertices[i]] = j - i;
+        i = j;
+    }
+
+    std::vector<Quadric> quadrics(vertex_count);
+    std::unordered_map<u64, u32> edge_counts = {};
+    for(usize t = 0; t < indices.size() / 3; t++) {
+        u32 a = weld[indices[t * 3 + 0]];
+        u32 b = weld[indices[t * 3 + 1]];
+        u32 c = weld[indices[t * 3 + 2]];
+        glm::dvec3 p0 = get_position(vertices, a);
+        glm::dvec3 normal = glm::cross(get_position(vertices, b) - p0, get_position(vertices, c) - p0);
+        f64 length = glm::length(normal);
+        if(length > 0.0) {
+            normal /= length;
+            // area weighted so small slivers dont dominate the error
+            Quadric quadric = Quadric::from_plane(normal, -glm::dot(normal, p0), length * 0.5);
+            quadrics[a] += quadric;
+            quadrics[b] += quadric;
+            quadrics[c] += quadric;
+        }
+
+        edge_counts[edge_key(a, b)]++;
+        edge_counts[edge_key(b, c)]++;
+        edge_counts[edge_key(c, a)]++;
+    }
+
+    // an edge with a single triangle is an open border, moving its vertices would open holes
+    std::vector<bool> locked(vertex_count, false);
+    for(const auto& [key, count] : edge_counts) {
+        if(count == 1) {
+            locked[static_cast<u32>(key >> 32)] = true;
+            locked[static_cast<u32>(key & 0xFFFFFFFFu)] = true;
+        }
+    }
+
+    // the quadrics only rank the collapses, they average over the planes and understate how far the surface moved.
+    // a mean above the budget rules a collapse out early, the distance it really moves the surface is checked when
+    // it is applied and adds up per vertex over the collapses that ended in it
+    f64 max_cost = static_cast<f64>(max_error) * static_cast<f64>(max_error);
+    std::vector<f64> vertex_errors(vertex_count, 0.0);
+    std::vector<u32> collapse_target(vertex_count);
+    std::vector<bool> touched(vertex_count);
+    std::vector<Collapse> collapses = {};
+    std::vector<u32> adjacency_offsets(vertex_count + 1);
+    std::vector<u32> adjacency = {};
+
+    while(result.indices.size() > target_index_count) {
+        usize triangle_count = result.indices.size() / 3;
+
+        collapses.clear();
+        for(usize i = 0; i < result.indices.size(); i++) {
+            u32 from = weld[result.indices[i]];
+            u32 to = weld[result.indices[i - i % 3 + (i % 3 + 1) % 3]];
+            if(from == to || locked[from]) { continue; }
+            Quadric quadric = quadrics[from];
+            quadric += quadrics[to];
+            f64 cost = quadric.evaluate(get_position(vertices, to));
+            if(cost <= max_cost) { collapses.push_back(Collapse { .from = from, .to = to, .cost = cost }); }
+        }
+        if(collapses.empty()) { break; }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+        for(u32 index : result.indices) { adjacency_offsets[weld[index] + 1]++; }
+        for(u32 v = 0; v < vertex_count; v++) { adjacency_offsets[v + 1] += adjacency_offsets[v]; }
+        adjacency.resize(result.indices.size());
+        std::vector<u32> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for(usize i = 0; i < result.indices.size(); i++) {
+            adjacency[fill[weld[result.indices[i]]]++] = static_cast<u32>(i / 3);
+        }
+
+        std::iota(collapse_target.begin(), collapse_target.end(), 0u);
+        std::fill(touched.begin(), touched.end(), false);
+
+        // cheapest collapses first, every vertex whose triangles changed sits out the rest of the pass so the costs
+        // and the flip test stay valid
+        usize removed_triangles = 0;
+        usize triangles_to_remove = triangle_count - target_index_count / 3;
+        for(const auto& collapse : collapses) {
+            if(removed_triangles >= triangles_to_remove) { break; }
+            if(touched[collapse.from] || touched[collapse.to]) { continue; }
+
+            glm::dvec3 source = get_position(vertices, collapse.from);
+            glm::dvec3 target = get_position(vertices, collapse.to);
+            bool flips = false;
+            f64 distance = 0.0;
+            usize collapsed_triangles = 0;
+            for(u32 i = adjacency_offsets[collapse.from]; i < adjacency_offsets[collapse.from + 1]; i++) {
+                u32 t = adjacency[i];
+                std::array<u32, 3> corners = { weld[result.indices[t * 3 + 0]], weld[result.indices[t * 3 + 1]], weld[result.indices[t * 3 + 2]] };
+                if(corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+                    collapsed_triangles++;
+                    continue;
+                }
+
+                std::array<glm::dvec3, 3> before = { get_position(vertices, corners[0]), get_position(vertices, corners[1]), get_position(vertices, corners[2]) };
+                std::array<glm::dvec3, 3> after = before;
+                for(u32 c = 0; c < 3; c++) { if(corners[c] == collapse.from) { after[c] = target; } }
+
+                glm::dvec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::dvec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+                // rejects flipped triangles and ones that turn by more than about 75 degrees
+                f64 length_before = glm::length(normal_before);
+                f64 length_after = glm::length(normal_after);
+                if(glm::dot(normal_before, normal_after) <= 0.25 * length_before * length_after) {
+                    flips = true;
+                    break;
+                }
+
+                // how far the new vertex is off the old surface and the old vertex off the new one
+                if(length_before > 0.0) { distance = std::max(distance, std::abs(glm::dot(target - before[0], normal_before)) / length_before); }
+                if(length_after > 0.0) { distance = std::max(distance, std::abs(glm::dot(source - after[0], normal_after)) / length_after); }
+            }
+            if(flips || collapsed_triangles == 0) { continue; }
+
+            f64 error = std::max(vertex_errors[collapse.from], vertex_errors[collapse.to]) + distance;
+            if(error > static_cast<f64>(max_error)) { continue; }
+
+            collapse_target[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            vertex_errors[collapse.to] = error;
+            result.error = std::max(result.error, static_cast<f32>(error));
+            removed_triangles += collapsed_triangles;
+
+            for(u32 i = adjacency_offsets[collapse.from]; i < adjacency_offsets[collapse.from + 1]; i++) {
+                for(u32 c = 0; c < 3; c++) { touched[weld[result.indices[adjacency[i] * 3 + c]]] = true; }
+            }
+        }
+
+        if(removed_triangles == 0) { break; }
+
+        // a corner that moved takes the wedge of its new position whose attributes are closest to its own
+        std::vector<u32> output = {};
+        output.reserve(result.indices.size());
+        for(usize t = 0; t < triangle_count; t++) {
+            std::array<u32, 3> corners = {};
+            for(u32 c = 0; c < 3; c++) {
+                u32 vertex = result.indices[t * 3 + c];
+                u32 target = collapse_target[weld[vertex]];
+                if(target != weld[vertex]) {
+                    u32 best = sorted_vertices[wedge_start[target]];
+                    for(u32 w = wedge_start[target]; w < wedge_start[target] + wedge_count[target]; w++) {
+                        if(attribute_distance(vertices[sorted_vertices[w]], vertices[vertex]) < attribute_distance(vertices[best], vertices[vertex])) { best = sorted_vertices[w]; }
+                    }
+                    vertex = best;
+                }
+                corners[c] = vertex;
+            }
+
+            if(weld[corners[0]] == weld[corners[1]] || weld[corners[1]] == weld[corners[2]] || weld[corners[2]] == weld[corners[0]]) { continue; }
+            output.insert(output.end(), corners.begin(), corners.end());
+        }
+
+        result.indices = std::move(output);
+    }
+
+    return result;
+}
+
+void generate_model_lods(ModelData& model, ThreadPool* pool) {
+    PROFILE_SCOPE("generate_model_lods");
+    std::vector<std::vector<SimplifiedMesh>> primitive_lods(model.primitives.size());
+
+    auto process_primitive = [&](usize i) {
+        const auto& primitive = model.primitives[i];
+        std::span<const u32> indices = std::span{model.indices}.subspan(primitive.first_index, primitive.index_count);
+        std::span<const Vertex> vertices = std::span{model.vertices}.subspan(primitive.first_vertex, primitive.vertex_count);
+
+        glm::vec3 min = glm::vec3{std::numeric_limits<f32>::max()};
+        glm::vec3 max = glm::vec3{std::numeric_limits<f32>::lowest()};
+        for(const auto& vertex : vertices) {
+            min = glm::min(min, glm::vec3{vertex.position.x, vertex.position.y, vertex.position.z});
+            max = glm::max(max, glm::vec3{vertex.position.x, vertex.position.y, vertex.position.z});
+        }
+        f32 max_error = glm::length(max - min) * LOD_MAX_RELATIVE_ERROR;
+
+        // every level starts from the one before it, which is much faster than going back to full detail each time
+        std::span<const u32> previous = indices;
+        f32 previous_error = 0.0f;
+        for(u32 level = 1; level < MAX_LOD_COUNT; level++) {
+            usize target_index_count = static_cast<usize>(static_cast<f32>(previous.size() / 3) * LOD_TRIANGLE_RATIO) * 3;
+            // every level moves the surface on top of the level it started from, so the errors add up along the chain
+            SimplifiedMesh lod = simplify_mesh(previous, vertices, target_index_count, max_error - previous_error);
+
+            // not worth a level once the simplifier gets stuck on locked borders or the error budget
+            if(lod.indices.empty() || static_cast<f32>(lod.indices.size()) > static_cast<f32>(previous.size()) * 0.85f) { break; }
+
+            optimize_vertex_cache(lod.indices, primitive.vertex_count);
+            lod.error += previous_error;
+            previous_error = lod.error;
+            primitive_lods[i].push_back(std::move(lod));
+            previous = primitive_lods[i].back().indices;
+        }
+    };
+
+    // waits on its own primitives only, the pool can be busy with other work
+    std::vector<std::future<void>> jobs = {};
+    for(usize i = 0; i < model.primitives.size(); i++) {
+        if(model.primitives[i].index_count < 3) { continue; }
+        if(pool != nullptr) { jobs.push_back(pool->submit(process_primitive, i)); } else { process_primitive(i); }
+    }
+
+    ThreadPool::wait_for_futures(jobs);
+
+    model.lods.clear();
+    for(usize i = 0; i < model.primitives.size(); i++) {
+        auto& primitive = model.primitives[i];
+        primitive.first_lod = static_cast<u32>(model.lods.size());
+        primitive.lod_count = 0;
+        if(primitive.index_count == 0) { continue; }
+
+        model.lods.push_back(PrimitiveLod { .first_index = primitive.first_index, .index_count = primitive.index_count, .index_offset = 0, .error = 0.0f });
+        for(const auto& lod : primitive_lods[i]) {
+            model.lods.push_back(PrimitiveLod { .first_index = static_cast<u32>(model.indices.size()), .index_count = static_cast<u32>(lod.indices.size()), .index_offset = 0, .error = lod.error });
+            model.indices.insert(model.indices.end(), lod.indices.begin(), lod.indices.end());
+        }
+        primitive.lod_count = static_cast<u32>(model.lods.size()) - primitive.first_lod;
+    }
+}
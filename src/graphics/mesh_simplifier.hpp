@@ -0,0 +1,30 @@
+#pragma once
+
+#include "pch.hpp"
+
+class ThreadPool;
+struct ModelData;
+
+// full detail included
+constexpr u32 MAX_LOD_COUNT = 5;
+// every level aims for this fraction of the triangles of the level before it
+constexpr f32 LOD_TRIANGLE_RATIO = 0.5f;
+// collapses stop once they would move the surface by more than this fraction of the primitive extent
+constexpr f32 LOD_MAX_RELATIVE_ERROR = 0.1f;
+
+struct SimplifiedMesh {
+    std::vector<u32> indices = {};
+    // largest distance the surface moved, in the units of the vertex positions. a conservative estimate from the
+    // vertex to plane distances of every collapse, summed along the chains of collapses
+    f32 error = {};
+};
+
+// quadric error metric edge collapse (Garland and Heckbert 1997) that only ever collapses a vertex onto one of its
+// neighbours, so the result indexes the same vertices. vertices sharing a position are welded for the topology and
+// open borders are locked, so uv and normal seams dont tear open
+auto simplify_mesh(std::span<const u32> indices, std::span<const Vertex> vertices, usize target_index_count, f32 max_error) -> SimplifiedMesh;
+
+// builds the lod chain of every indexed primitive, one task per primitive or one after another on the calling thread
+// without a pool. lod 0 is the primitive itself, coarser levels are appended to ModelData::indices and every level
+// records its error for screen space selection
+void generate_model_lods(ModelData& model, ThreadPool* pool);
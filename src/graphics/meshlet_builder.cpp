@@ -0,0 +1,170 @@
+#include "meshlet_builder.hpp"
+#include "model_importer.hpp"
+
+#include "utils/threadpool.hpp"
+#include "utils/profiler.hpp"
+
+namespace {
+    constexpr u8 INVALID_LOCAL_INDEX = std::numeric_limits<u8>::max();
+
+    auto get_position(std::span<const Vertex> vertices, u32 index) -> glm::vec3 {
+        return {vertices[index].position.x, vertices[index].position.y, vertices[index].position.z};
+    }
+
+    auto to_f32vec3(const glm::vec3& v) -> f32vec3 {
+        return {v.x, v.y, v.z};
+    }
+
+    void compute_bounds(Meshlet& meshlet, const MeshletData& data, std::span<const Vertex> vertices) {
+        glm::vec3 min = glm::vec3{std::numeric_limits<f32>::max()};
+        glm::vec3 max = glm::vec3{std::numeric_limits<f32>::lowest()};
+        for(u32 v = 0; v < meshlet.vertex_count; v++) {
+            glm::vec3 position = get_position(vertices, data.vertices[meshlet.vertex_offset + v]);
+            min = glm::min(min, position);
+            max = glm::max(max, position);
+        }
+
+        glm::vec3 center = (min + max) * 0.5f;
+        f32 radius = 0.0f;
+        for(u32 v = 0; v < meshlet.vertex_count; v++) {
+            radius = std::max(radius, glm::distance(center, get_position(vertices, data.vertices[meshlet.vertex_offset + v])));
+        }
+
+        std::vector<glm::vec3> normals(meshlet.triangle_count);
+        glm::vec3 axis = {};
+        for(u32 t = 0; t < meshlet.triangle_count; t++) {
+            const u8* triangle = &data.triangles[meshlet.triangle_offset + t * 3];
+            glm::vec3 p0 = get_position(vertices, data.vertices[meshlet.vertex_offset + triangle[0]]);
+            glm::vec3 p1 = get_position(vertices, data.vertices[meshlet.vertex_offset + triangle[1]]);
+            glm::vec3 p2 = get_position(vertices, data.vertices[meshlet.vertex_offset + triangle[2]]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            f32 length = glm::length(normal);
+            normals[t] = length > 0.0f ? normal / length : glm::vec3{0.0f};
+            axis += normals[t];
+        }
+
+        meshlet.center = to_f32vec3(center);
+        meshlet.radius = radius;
+        meshlet.aabb_min = to_f32vec3(min);
+        meshlet.aabb_max = to_f32vec3(max);
+
+        // the cone covers every triangle normal, once they spread over a hemisphere or more there is no direction
+        // the whole meshlet faces away from and the cone never culls
+        f32 axis_length = glm::length(axis);
+        axis = axis_length > 0.0f ? axis / axis_length : glm::vec3{0.0f, 0.0f, 1.0f};
+        f32 min_dot = 1.0f;
+        for(const auto& normal : normals) { min_dot = std::min(min_dot, glm::dot(axis, normal)); }
+
+        meshlet.cone_axis = to_f32vec3(axis);
+        if(axis_length == 0.0f || min_dot <= 0.0f) {
+            meshlet.cone_apex = to_f32vec3(center);
+            meshlet.cone_cutoff = 1.0f;
+            return;
+        }
+
+        // the apex is moved back along the axis until it lies behind every triangle plane, from there a camera inside
+        // the cone sees the back of all of them
+        f32 max_t = 0.0f;
+        for(u32 t = 0; t < meshlet.triangle_count; t++) {
+            const u8* triangle = &data.triangles[meshlet.triangle_offset + t * 3];
+            glm::vec3 p0 = get_position(vertices, data.vertices[meshlet.vertex_offset + triangle[0]]);
+            f32 denominator = glm::dot(axis, normals[t]);
+            if(denominator > 0.0f) { max_t = std::max(max_t, glm::dot(center - p0, normals[t]) / denominator); }
+        }
+
+        meshlet.cone_apex = to_f32vec3(center - axis * max_t);
+        meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    }
+}
+
+auto build_meshlets(std::span<const u32> indices, std::span<const Vertex> vertices) -> MeshletData {
+    PROFILE_SCOPE("build_meshlets");
+    MeshletData data = {};
+    usize triangle_count = indices.size() / 3;
+    if(triangle_count == 0) { return data; }
+
+    data.meshlets.reserve(triangle_count / MESHLET_MAX_TRIANGLES + 1);
+    data.vertices.reserve(indices.size() / 2);
+    data.triangles.reserve(indices.size() + data.meshlets.capacity() * 3);
+
+    // local index of every vertex inside the meshlet being built, only the entries of that meshlet are reset
+    std::vector<u8> local_indices(vertices.size(), INVALID_LOCAL_INDEX);
+    Meshlet meshlet = {};
+
+    auto finish_meshlet = [&]() {
+        if(meshlet.triangle_count == 0) { return; }
+        for(u32 v = 0; v < meshlet.vertex_count; v++) { local_indices[data.vertices[meshlet.vertex_offset + v]] = INVALID_LOCAL_INDEX; }
+        compute_bounds(meshlet, data, vertices);
+        data.meshlets.push_back(meshlet);
+
+        data.triangles.resize((data.triangles.size() + 3) / 4 * 4, 0);
+        meshlet = {};
+        meshlet.vertex_offset = static_cast<u32>(data.vertices.size());
+        meshlet.triangle_offset = static_cast<u32>(data.triangles.size());
+    };
+
+    for(usize t = 0; t < triangle_count; t++) {
+        const u32* triangle = &indices[t * 3];
+        u32 new_vertex_count = 0;
+        for(u32 corner = 0; corner < 3; corner++) {
+            // repeated vertices inside a degenerate triangle only count once
+            bool repeated = (corner > 0 && triangle[corner] == triangle[0]) || (corner > 1 && triangle[corner] == triangle[1]);
+            if(local_indices[triangle[corner]] == INVALID_LOCAL_INDEX && !repeated) { new_vertex_count++; }
+        }
+
+        if(meshlet.vertex_count + new_vertex_count > MESHLET_MAX_VERTICES || meshlet.triangle_count + 1 > MESHLET_MAX_TRIANGLES) {
+            finish_meshlet();
+        }
+
+        for(u32 corner = 0; corner < 3; corner++) {
+            u32 vertex = triangle[corner];
+            if(local_indices[vertex] == INVALID_LOCAL_INDEX) {
+                local_indices[vertex] = static_cast<u8>(meshlet.vertex_count++);
+                data.vertices.push_back(vertex);
+            }
+            data.triangles.push_back(local_indices[vertex]);
+        }
+        meshlet.triangle_count++;
+    }
+
+    finish_meshlet();
+    return data;
+}
+
+void build_model_meshlets(ModelData& model, ThreadPool& pool) {
+    PROFILE_SCOPE("build_model_meshlets");
+    std::vector<MeshletData> primitive_meshlets(model.primitives.size());
+
+    auto process_primitive = [&](usize i) {
+        const auto& primitive = model.primitives[i];
+        primitive_meshlets[i] = build_meshlets(
+            std::span{model.indices}.subspan(primitive.first_index, primitive.index_count),
+            std::span{model.vertices}.subspan(primitive.first_vertex, primitive.vertex_count));
+    };
+
+    // waits on its own primitives only, the pool can be busy with other work
+    std::vector<std::future<void>> jobs = {};
+    for(usize i = 0; i < model.primitives.size(); i++) {
+        if(model.primitives[i].index_count >= 3) { jobs.push_back(pool.submit(process_primitive, i)); }
+    }
+
+    ThreadPool::wait_for_futures(jobs);
+
+    model.meshlets.clear();
+    model.meshlet_vertices.clear();
+    model.meshlet_triangles.clear();
+    for(usize i = 0; i < model.primitives.size(); i++) {
+        auto& data = primitive_meshlets[i];
+        model.primitives[i].first_meshlet = static_cast<u32>(model.meshlets.size());
+        model.primitives[i].meshlet_count = static_cast<u32>(data.meshlets.size());
+
+        for(auto& meshlet : data.meshlets) {
+            meshlet.vertex_offset += static_cast<u32>(model.meshlet_vertices.size());
+            meshlet.triangle_offset += static_cast<u32>(model.meshlet_triangles.size());
+        }
+
+        model.meshlets.insert(model.meshlets.end(), data.meshlets.begin(), data.meshlets.end());
+        model.meshlet_vertices.insert(model.meshlet_vertices.end(), data.vertices.begin(), data.vertices.end());
+        model.meshlet_triangles.insert(model.meshlet_triangles.end(), data.triangles.begin(), data.triangles.end());
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "pch.hpp"
+
+class ThreadPool;
+struct ModelData;
+
+// small enough that a cluster fits the output limits of mesh shaders on every vendor
+constexpr u32 MESHLET_MAX_VERTICES = 64;
+constexpr u32 MESHLET_MAX_TRIANGLES = 124;
+
+// meshlets of one primitive. Meshlet::vertex_offset indexes vertices, which are relative to the first vertex of the
+// primitive, Meshlet::triangle_offset is a byte offset into triangles where every triangle is three local u8 indices
+// and every meshlet starts 4 byte aligned
+struct MeshletData {
+    std::vector<Meshlet> meshlets = {};
+    std::vector<u32> vertices = {};
+    std::vector<u8> triangles = {};
+};
+
+// walks the triangles in index order and starts a new meshlet whenever the next one would overflow the limits, so the
+// clusters are only as coherent as the index order. run it after optimize_vertex_cache
+auto build_meshlets(std::span<const u32> indices, std::span<const Vertex> vertices) -> MeshletData;
+
+// builds the meshlets of every indexed primitive, one task per primitive, and appends them to the model
+void build_model_meshlets(ModelData& model, ThreadPool& pool);
@@ -1,472 +1,259 @@
 #include "model.hpp"
+#include "cooked_model.hpp"
 
-#include <fastgltf/parser.hpp>
-#include <fastgltf/tools.hpp>
-#include <fastgltf/types.hpp>
-#include <fastgltf/util.hpp>
-
-#include <glm/glm.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include <stb_image.h>
+#include <glm/gtc/packing.hpp>
 
 #include "utils/threadpool.hpp"
-
-Model::Model(daxa::Device _device, const std::string_view& file_path) : device{_device} {
-    std::filesystem::path path(file_path.data());
-
-    if(!std::filesystem::exists(path)) {
-        throw std::runtime_error("couldnt not find model: " + path.string());
-    }
-
-    std::unique_ptr<fastgltf::GltfDataBuffer> gltf;
-    fastgltf::GltfDataBuffer data_buffer;
-    fastgltf::Asset asset;
-
-    {
-        fastgltf::Parser parser(fastgltf::Extensions::KHR_mesh_quantization);
-
-        constexpr auto gltfOptions = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble | fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers;
-        fastgltf::GltfDataBuffer data;
-        data.loadFromFile(path);
-
-        auto type = fastgltf::determineGltfFileType(&data);
-		fastgltf::Expected<fastgltf::Asset> asset_(fastgltf::Error::None);
-        if (type == fastgltf::GltfType::glTF) {
-	        asset_ = parser.loadGLTF(&data, path.parent_path(), gltfOptions);
-        } else if (type == fastgltf::GltfType::GLB) {
-	        asset_ = parser.loadBinaryGLTF(&data, path.parent_path(), gltfOptions);
-        } else {
-            std::cerr << "Failed to determine glTF container" << '\n';
-            //return false;
+#include "utils/profiler.hpp"
+
+ModelSource::ModelSource(const std::filesystem::path& path, ThreadPool* pool) {
+    PROFILE_SCOPE("ModelSource::ModelSource");
+
+    // a cooked model next to the source asset is used as long as it isnt older than the source or any buffer and
+    // image the source reads
+    std::filesystem::path cooked_path = path;
+    cooked_path.replace_extension(CookedModel::EXTENSION);
+    bool is_cooked = path.extension() == CookedModel::EXTENSION;
+    bool has_fresh_cooked = !is_cooked && std::filesystem::exists(cooked_path);
+    if(has_fresh_cooked && std::filesystem::exists(path)) {
+        auto cooked_time = std::filesystem::last_write_time(cooked_path);
+        has_fresh_cooked = cooked_time >= std::filesystem::last_write_time(path);
+        if(has_fresh_cooked) {
+            for(const auto& dependency : get_gltf_dependencies(path)) {
+                if(std::filesystem::exists(dependency) && std::filesystem::last_write_time(dependency) > cooked_time) { has_fresh_cooked = false; }
+            }
         }
-
-        // if (asset.error() != fastgltf::Error::None) {
-        //     std::cerr << "Failed to load glTF: " << fastgltf::getErrorMessage(asset.error()) << '\n';
-        //     //return false;
-        // }
-
-        asset = std::move(asset_.get());
     }
 
-    auto get_image_type = [&](usize image_index) -> daxa::Format {
-        for(auto& material : asset.materials) {
-            if(material.pbrData.baseColorTexture.has_value()) {
-                u32 diffuseTextureIndex = static_cast<u32>(material.pbrData.baseColorTexture.value().textureIndex);
-                auto& diffuseTexture = asset.textures[diffuseTextureIndex];
-                if (image_index == diffuseTexture.imageIndex.value()) {
-                    return daxa::Format::R8G8B8A8_SRGB;
-                }
-            }
+    if(is_cooked || has_fresh_cooked) {
+        cooked_model = std::make_unique<CookedModel>(cooked_path);
 
-            if(material.emissiveTexture.has_value()) {
-                u32 emissiveTextureIndex = static_cast<u32>(material.emissiveTexture.value().textureIndex);
-                auto& emissiveTexture = asset.textures[emissiveTextureIndex];
-                if (image_index == emissiveTexture.imageIndex.value()) {
-                    return daxa::Format::R8G8B8A8_SRGB;
-                }
+        images.reserve(cooked_model->get_images().size());
+        for(const auto& image : cooked_model->get_images()) {
+            if(image.embedded) {
+                images.push_back(ModelImageSource { .bytes = cooked_model->get_image_bytes(image), .format = static_cast<daxa::Format>(image.format) });
+            } else {
+                images.push_back(ModelImageSource { .path = cooked_model->get_image_path(image), .format = static_cast<daxa::Format>(image.format) });
             }
         }
-        
-        return daxa::Format::R8G8B8A8_UNORM;
-    };
-
-    images.resize(asset.images.size());
-    std::vector<std::pair<Texture::PayLoad, u32>> textures;
-    textures.resize(asset.images.size());
-    ThreadPool pool(std::thread::hardware_concurrency());
-
-    auto process_image = [&](fastgltf::Image& image, u32 index) {
-        Texture::PayLoad tex;
-        std::visit(fastgltf::visitor {
-            [](auto&) {},
-            [&](fastgltf::sources::URI& image_path) {
-               tex = Texture::load_texture(device, path.parent_path().string() + '/' + std::string(image_path.uri.path().begin(), image_path.uri.path().end()), get_image_type(index));
-            },
-
-            [&](fastgltf::sources::Vector& vector) {
-                tex = Texture::load_texture(device, vector.bytes.data(), static_cast<u32>(vector.bytes.size()), get_image_type(index));
-                // i32 width = 0, height = 0, nrChannels = 0;
-                // unsigned char *data = nullptr;
-                // data = stbi_load_from_memory(vector.bytes.data(), static_cast<i32>(vector.bytes.size()), &width, &height, &nrChannels, 0);
-                // if(!data) {
-                //     throw std::runtime_error("wtf");
-                // }
-
-                // // utter garbage thanks to RGB formats are not supported
-                // unsigned char* buffer = nullptr;
-                // u64 buffer_size = {};
-
-                // if (nrChannels == 3) {
-                //     buffer_size = static_cast<u64>(width * height) * 4;
-                //     std::vector<unsigned char> image_data(buffer_size, 255);
-
-                //     buffer = image_data.data();
-                //     unsigned char* rgba = buffer;
-                //     unsigned char* rgb = data;
-                //     for (i32 i = 0; i < width * height; ++i) {
-                //         std::memcpy(rgba, rgb, sizeof(unsigned char) * 3);
-                //         rgba += 4;
-                //         rgb += 3;
-                //     }
-
-                //     tex = Texture::load_texture(device, static_cast<u32>(width), static_cast<u32>(height), buffer, get_image_type(index));
-                // }
-                // else {
-                //     buffer = data;
-                //     buffer_size = static_cast<u64>(width * height) * 4;
-                //     tex = Texture::load_texture(device, static_cast<u32>(width), static_cast<u32>(height), buffer, get_image_type(index));
-                // }
-
-                // stbi_image_free(data);
-            },
-
-            [&](fastgltf::sources::BufferView& view) {
-                auto& buffer_view = asset.bufferViews[view.bufferViewIndex];
-                auto& gltf_buffer = asset.buffers[buffer_view.bufferIndex];
-
-                std::visit(fastgltf::visitor {
-                    [](auto&) {},
-                    [&](fastgltf::sources::Vector& vector) {
-                        tex = Texture::load_texture(device, vector.bytes.data(), static_cast<u32>(vector.bytes.size()), get_image_type(index));
-                        // i32 width = 0, height = 0, nrChannels = 0;
-                        // unsigned char *data = nullptr;
-                        // data = stbi_load_from_memory(vector.bytes.data(), static_cast<i32>(vector.bytes.size()), &width, &height, &nrChannels, 0);
-                        // if(!data) {
-                        //     throw std::runtime_error("wtf");
-                        // }
-
-                        // // utter garbage thanks to RGB formats are no supported
-                        // unsigned char* buffer = {};
-                        // u64 buffer_size = {};
-
-                        // if (nrChannels == 3) {
-                        //     buffer_size = static_cast<u64>(width * height) * 4;
-                        //     std::vector<unsigned char> image_data(buffer_size, 255);
-
-                        //     buffer = image_data.data();
-                        //     unsigned char* rgba = buffer;
-                        //     unsigned char* rgb = data;
-                        //     for (i32 i = 0; i < width * height; ++i) {
-                        //         std::memcpy(rgba, rgb, sizeof(unsigned char) * 3);
-                        //         rgba += 4;
-                        //         rgb += 3;
-                        //     }
-                        // }
-                        // else {
-                        //     buffer = data;
-                        //     buffer_size = static_cast<u64>(width * height) * 4;
-                        // }
-
-                        // tex = Texture::load_texture(device, static_cast<u32>(width), static_cast<u32>(height), buffer, get_image_type(index));
-                        // stbi_image_free(data);
-                    }
-                }, gltf_buffer.data);
-            },
-        }, image.data);
-   
-        textures[index] = std::pair{std::move(tex), index};
-    };
 
-    for (u32 i = 0; i < asset.images.size(); i++) {
-        auto& image = asset.images[i];
-        pool.push_task(process_image, image, i);
-    }
-
-    pool.wait_for_tasks();
-
-    for(auto& tex : textures) {
-        device.submit_commands({
-            .command_lists = {std::move(tex.first.command_list)},
-        });
+        vertices = cooked_model->get_vertices();
+        positions = cooked_model->get_positions();
+        index_data = cooked_model->get_index_data();
+        primitives = cooked_model->get_primitives();
+        lods = cooked_model->get_lods();
+        meshlets = cooked_model->get_meshlets();
+        meshlet_vertices = cooked_model->get_meshlet_vertices();
+        meshlet_triangles = cooked_model->get_meshlet_triangles();
+        materials = cooked_model->get_materials();
+    } else {
+        model_data = import_gltf_model(path, pool);
+
+        images.reserve(model_data.images.size());
+        for(auto& image : model_data.images) {
+            images.push_back(ModelImageSource { .path = image.path, .bytes = image.bytes, .format = image.format });
+        }
 
-        images[tex.second] = std::move(tex.first.texture);
+        vertices = model_data.packed_vertices;
+        positions = model_data.packed_positions;
+        index_data = model_data.index_data;
+        primitives = model_data.primitives;
+        lods = model_data.lods;
+        meshlets = model_data.meshlets;
+        meshlet_vertices = model_data.meshlet_vertices;
+        meshlet_triangles = model_data.meshlet_triangles;
+        materials = model_data.materials;
     }
+}
 
-    device.wait_idle();
-
-    null_texture = std::make_unique<Texture>(device, "assets/white.png", daxa::Format::R8G8B8A8_SRGB);
-
-    std::vector<Material> materials = {};
-    materials.reserve(asset.materials.size());
+ModelSource::~ModelSource() = default;
 
-    for(auto& material : asset.materials) {
-        Material mat = {};
+Model::Model(UploadService* _upload_service, GeometryArena* _arena, TextureRegistry* _texture_registry, const std::string_view& file_path, ThreadPool& pool)
+    : device{_upload_service->device}, upload_service{_upload_service}, arena{_arena}, texture_registry{_texture_registry}, null_texture{_texture_registry->get_null_texture()} {
+    PROFILE_SCOPE("Model::Model");
+    ModelSource source{std::filesystem::path{file_path.data()}, &pool};
 
-        if(material.pbrData.baseColorTexture.has_value()) {
-            u32 texture_index = static_cast<u32>(material.pbrData.baseColorTexture.value().textureIndex);
-            u32 image_index = static_cast<u32>(asset.textures[texture_index].imageIndex.value());
-            mat.albedo_image = images[image_index]->get_texture_id();
-            mat.has_albedo_image = 1;
-        } else {
-            mat.albedo_image = null_texture->get_texture_id();
-            mat.has_albedo_image = 0;
-        }
+    u64 images_upload_value = load_images(source.images, pool);
+    u64 geometry_upload_value = upload_geometry(source);
 
-        if(material.pbrData.metallicRoughnessTexture.has_value()) {
-            u32 texture_index = static_cast<u32>(material.pbrData.metallicRoughnessTexture.value().textureIndex);
-            u32 image_index = static_cast<u32>(asset.textures[texture_index].imageIndex.value());
-            mat.metallic_roughness_image = images[image_index]->get_texture_id();
-            mat.has_metallic_roughness_image = 1;
-        } else {
-            mat.metallic_roughness_image = null_texture->get_texture_id();
-            mat.has_metallic_roughness_image = 0;
-        }
+    upload_service->wait(std::max(images_upload_value, geometry_upload_value));
+    ready = true;
+}
 
-        if(material.normalTexture.has_value()) {
-            u32 texture_index = static_cast<u32>(material.normalTexture.value().textureIndex);
-            u32 image_index = static_cast<u32>(asset.textures[texture_index].imageIndex.value());
-            mat.normal_image = images[image_index]->get_texture_id();
-            mat.has_normal_image = 1;
-        } else {
-            mat.normal_image = null_texture->get_texture_id();
-            mat.has_normal_image = 0;
-        }
+Model::Model(UploadService* _upload_service, GeometryArena* _arena, TextureRegistry* _texture_registry)
+    : device{_upload_service->device}, upload_service{_upload_service}, arena{_arena}, texture_registry{_texture_registry}, null_texture{_texture_registry->get_null_texture()} {}
 
-        if(material.occlusionTexture.has_value()) {
-            u32 texture_index = static_cast<u32>(material.occlusionTexture.value().textureIndex);
-            u32 image_index = static_cast<u32>(asset.textures[texture_index].imageIndex.value());
-            mat.occlusion_image = images[image_index]->get_texture_id();
-            mat.has_occlusion_image = 1;
-        } else {
-            mat.occlusion_image = null_texture->get_texture_id();
-            mat.has_occlusion_image = 0;
-        }
-
-        if(material.emissiveTexture.has_value()) {
-            u32 texture_index = static_cast<u32>(material.emissiveTexture.value().textureIndex);
-            u32 image_index = static_cast<u32>(asset.textures[texture_index].imageIndex.value());
-            mat.emissive_image = images[image_index]->get_texture_id();
-            mat.has_emissive_image = 1;
-        } else {
-            mat.emissive_image = null_texture->get_texture_id();
-            mat.has_emissive_image = 0;
-        }
+Model::~Model() {
+    if(geometry.is_valid()) { arena->free(geometry); }
+}
 
-        materials.push_back(mat);
+auto Model::load_image(TextureRegistry& texture_registry, const ModelImageSource& source) -> SharedTexture {
+    if(!source.path.empty()) {
+        return texture_registry.acquire(source.path, source.format);
     }
 
-    {
-        daxa::BufferId staging_material_buffer = device.create_buffer({
-            .size = static_cast<u32>(materials.size() * sizeof(Material)),
-            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-        });
+    return texture_registry.acquire(source.bytes, source.format);
+}
 
-        material_buffer = device.create_buffer({
-            .size = static_cast<u32>(materials.size() * sizeof(Material)),
-            .allocate_info = daxa::MemoryFlagBits::DEDICATED_MEMORY,
-        });
+auto Model::load_images(const std::vector<ModelImageSource>& sources, ThreadPool& pool) -> u64 {
+    images.resize(sources.size());
+    std::vector<SharedTexture> textures;
+    textures.resize(sources.size());
 
-        auto cmd_list = device.create_command_list({
-            .name = "cmd_list",
-        });
+    auto process_image = [&](const ModelImageSource& source, u32 index) {
+        textures[index] = load_image(*texture_registry, source);
+    };
 
-        auto buffer_ptr = device.get_host_address_as<Material>(staging_material_buffer);
-        std::memcpy(buffer_ptr, materials.data(), materials.size() * sizeof(Material));
+    // waits on its own images only, the pool can be busy with other loads
+    std::vector<std::future<void>> jobs = {};
+    jobs.reserve(sources.size());
+    for (u32 i = 0; i < sources.size(); i++) {
+        jobs.push_back(pool.submit(process_image, sources[i], i));
+    }
 
-        cmd_list.pipeline_barrier({
-            .src_access = daxa::AccessConsts::HOST_WRITE,
-            .dst_access = daxa::AccessConsts::TRANSFER_READ,
-        });
+    ThreadPool::wait_for_futures(jobs);
 
-        cmd_list.copy_buffer_to_buffer({
-            .src_buffer = staging_material_buffer,
-            .dst_buffer = material_buffer,
-            .size = static_cast<u32>(materials.size() * sizeof(Material)),
-        });
+    u64 upload_value = 0;
+    for(u32 i = 0; i < textures.size(); i++) {
+        upload_value = std::max(upload_value, textures[i].upload_value);
+        images[i] = std::move(textures[i].texture);
+    }
 
-        cmd_list.complete();
-        device.submit_commands({
-            .command_lists = {std::move(cmd_list)}
-        });
+    return upload_value;
+}
 
-        device.wait_idle();
-        device.destroy_buffer(staging_material_buffer);
-    }
+auto Model::upload_geometry(const ModelSource& source) -> u64 {
+    PROFILE_SCOPE("Model::upload_geometry");
+    primitives.assign(source.primitives.begin(), source.primitives.end());
+    lods.assign(source.lods.begin(), source.lods.end());
+    materials.assign(source.materials.begin(), source.materials.end());
+    meshlet_count = static_cast<u32>(source.meshlets.size());
+    meshlet_vertex_count = static_cast<u32>(source.meshlet_vertices.size());
+    images.resize(source.images.size());
+    build_occluders(source);
+
+    std::vector<Material> gpu_materials = build_gpu_materials();
+    u64 vertex_count = source.vertices.size();
+    u64 index_size = source.index_data.size_bytes();
+    u64 material_count = gpu_materials.size();
+    u64 meshlet_size = source.meshlets.size_bytes() + source.meshlet_vertices.size_bytes() + source.meshlet_triangles.size_bytes();
+
+    // staged as vertices, positions, indices, materials and meshlets back to back
+    return upload_service->upload({
+        std::span{reinterpret_cast<const u8*>(source.vertices.data()), source.vertices.size_bytes()},
+        std::span{reinterpret_cast<const u8*>(source.positions.data()), source.positions.size_bytes()},
+        source.index_data,
+        std::span{reinterpret_cast<const u8*>(gpu_materials.data()), gpu_materials.size() * sizeof(Material)},
+        std::span{reinterpret_cast<const u8*>(source.meshlets.data()), source.meshlets.size_bytes()},
+        std::span{reinterpret_cast<const u8*>(source.meshlet_vertices.data()), source.meshlet_vertices.size_bytes()},
+        source.meshlet_triangles,
+    }, [this, vertex_count, index_size, material_count, meshlet_size](daxa::CommandList& cmd_list, daxa::BufferId staging_buffer, u64 staging_offset) {
+        u64 material_staging_offset = staging_offset + vertex_count * (sizeof(PackedVertex) + sizeof(PackedPosition)) + index_size;
+        geometry = arena->allocate(cmd_list, vertex_count, index_size, material_count, meshlet_size);
+        arena->record_geometry_copy(cmd_list, geometry, staging_buffer, staging_offset);
+        arena->record_material_copy(cmd_list, geometry, staging_buffer, material_staging_offset);
+        arena->record_meshlet_copy(cmd_list, geometry, staging_buffer, material_staging_offset + material_count * sizeof(Material));
+    });
+}
 
-    std::vector<Vertex> vertices = {};
-    std::vector<u32> indices = {};
-
-    for (auto & scene : asset.scenes) {
-        for (usize i = 0; i < scene.nodeIndices.size(); i++) {
-            auto& node = asset.nodes[i];
-            u32 vertex_offset = 0;
-            u32 index_offset = 0;
-
-            for (auto& primitive : asset.meshes[node.meshIndex.value()].primitives) {
-                u32 vertex_count = 0;
-                u32 index_count = 0;
-
-                const f32* positionBuffer = nullptr;
-                const f32* normalBuffer = nullptr;
-                const f32* texCoordsBuffer = nullptr;
-                const f32* tangentsBuffer = nullptr;
-
-                if (primitive.findAttribute("POSITION") != primitive.attributes.end()) {
-                    auto& accessor = asset.accessors[primitive.findAttribute("POSITION")->second];
-                    auto& view = asset.bufferViews[accessor.bufferViewIndex.value()];
-                    positionBuffer = reinterpret_cast<const f32*>(&(std::get<fastgltf::sources::Vector>(asset.buffers[view.bufferIndex].data).bytes[accessor.byteOffset + view.byteOffset]));
-                    vertex_count = static_cast<u32>(accessor.count);
-                }
-
-                if (primitive.findAttribute("NORMAL") != primitive.attributes.end()) {
-                    auto& accessor = asset.accessors[primitive.findAttribute("NORMAL")->second];
-                    auto& view = asset.bufferViews[accessor.bufferViewIndex.value()];
-                    normalBuffer = reinterpret_cast<const f32*>(&(std::get<fastgltf::sources::Vector>(asset.buffers[view.bufferIndex].data).bytes[accessor.byteOffset + view.byteOffset]));
-                }
-
-                if (primitive.findAttribute("TEXCOORD_0") != primitive.attributes.end()) {
-                    auto& accessor = asset.accessors[primitive.findAttribute("TEXCOORD_0")->second];
-                    auto& view = asset.bufferViews[accessor.bufferViewIndex.value()];
-                    texCoordsBuffer = reinterpret_cast<const f32*>(&(std::get<fastgltf::sources::Vector>(asset.buffers[view.bufferIndex].data).bytes[accessor.byteOffset + view.byteOffset]));
-                }
-
-                if (primitive.findAttribute("TANGENT") != primitive.attributes.end()) {
-                    auto& accessor = asset.accessors[primitive.findAttribute("TANGENT")->second];
-                    auto& view = asset.bufferViews[accessor.bufferViewIndex.value()];
-                    tangentsBuffer = reinterpret_cast<const f32*>(&(std::get<fastgltf::sources::Vector>(asset.buffers[view.bufferIndex].data).bytes[accessor.byteOffset + view.byteOffset]));
-                }
-
-                for (size_t v = 0; v < vertex_count; v++) {
-                    glm::vec3 temp_position = glm::make_vec3(&positionBuffer[v * 3]);
-                    glm::vec3 temp_normal = glm::make_vec3(&normalBuffer[v * 3]);
-                    glm::vec2 temp_uv = texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[v * 2]) : glm::vec2(0.0f);
-                    glm::vec4 temp_tangent = tangentsBuffer ? glm::make_vec4(&tangentsBuffer[v * 4]) : glm::vec4(0.0f);
-                    Vertex vertex{
-                        .position = {temp_position.x, temp_position.y, temp_position.z},
-                        .normal = {temp_normal.x, temp_normal.y, temp_normal.z},
-                        .uv = {temp_uv.x, temp_uv.y},
-                        .tangent = {temp_tangent.x, temp_tangent.y, temp_tangent.z, temp_tangent.w}
-                    };
-
-                    vertices.push_back(vertex);
-                }
-
-                {
-                    auto& accessor = asset.accessors[primitive.indicesAccessor.value()];
-                    auto& bufferView = asset.bufferViews[accessor.bufferViewIndex.value()];
-                    auto& buffer = asset.buffers[bufferView.bufferIndex];
-
-                    index_count = static_cast<u32>(accessor.count);
-
-                    switch(accessor.componentType) {
-                        case fastgltf::ComponentType::UnsignedInt: {
-                            const uint32_t * buf = reinterpret_cast<const uint32_t *>(&std::get<fastgltf::sources::Vector>(buffer.data).bytes[accessor.byteOffset + bufferView.byteOffset]);
-                            indices.reserve((indices.size() + accessor.count) * sizeof(uint32_t));
-                            for (size_t index = 0; index < accessor.count; index++) {
-                                indices.push_back(buf[index]);
-                            }
-                            break;
-                        }
-                        case fastgltf::ComponentType::UnsignedShort: {
-                            const uint16_t * buf = reinterpret_cast<const uint16_t *>(&std::get<fastgltf::sources::Vector>(buffer.data).bytes[accessor.byteOffset + bufferView.byteOffset]);
-                            indices.reserve((indices.size() + accessor.count) * sizeof(uint16_t));
-                            for (size_t index = 0; index < accessor.count; index++) {
-                                indices.push_back(buf[index]);
-                            }
-                            break;
-                        }
-                        case fastgltf::ComponentType::UnsignedByte: {
-                            const uint8_t * buf = reinterpret_cast<const uint8_t *>(&std::get<fastgltf::sources::Vector>(buffer.data).bytes[accessor.byteOffset + bufferView.byteOffset]);
-                            indices.reserve((indices.size() + accessor.count) * sizeof(uint8_t));
-                            for (size_t index = 0; index < accessor.count; index++) {
-                                indices.push_back(buf[index]);
-                            }
-                            break;
-                        }
-                        default: { throw std::runtime_error("unhandled index buffer type"); }
-                    }
-                }
-
-                Primitive temp_primitive {
-                    .first_index = index_offset,
-                    .first_vertex = vertex_offset,
-                    .index_count = index_count,
-                    .vertex_count = vertex_count,
-                    .material_index = static_cast<u32>(primitive.materialIndex.value()) 
-                };
-
-                primitives.push_back(temp_primitive);
-
-                vertex_offset += vertex_count;
-                index_offset += index_count;
+void Model::build_occluders(const ModelSource& source) {
+    occluders.clear();
+    occluders.resize(primitives.size());
+    for(usize p = 0; p < primitives.size(); p++) {
+        const auto& primitive = primitives[p];
+        if(primitive.lod_count == 0) { continue; }
+
+        glm::vec3 position_min = *reinterpret_cast<const glm::vec3*>(&primitive.position_min);
+        glm::vec3 position_scale = *reinterpret_cast<const glm::vec3*>(&primitive.position_scale);
+        const auto& lod = get_lod(primitive, select_lod(primitive, OCCLUDER_MAX_RELATIVE_ERROR * glm::length(position_scale)));
+        if(lod.index_count / 3 > MAX_OCCLUDER_TRIANGLES) { continue; }
+
+        // only the vertices the level uses, numbered in the order it first uses them
+        auto& occluder = occluders[p];
+        std::unordered_map<u32, u32> remap = {};
+        occluder.indices.reserve(lod.index_count);
+        for(u32 i = 0; i < lod.index_count; i++) {
+            u32 index = 0;
+            std::memcpy(&index, source.index_data.data() + lod.index_offset + static_cast<usize>(i) * primitive.index_type_size, primitive.index_type_size);
+            auto [it, inserted] = remap.try_emplace(index, static_cast<u32>(occluder.positions.size()));
+            if(inserted) {
+                const PackedPosition& packed = source.positions[primitive.first_vertex + index];
+                glm::vec3 fraction = { glm::unpackUnorm2x16(packed.xy), glm::unpackUnorm2x16(packed.z).x };
+                occluder.positions.push_back(position_min + fraction * position_scale);
             }
+            occluder.indices.push_back(it->second);
         }
     }
+}
 
-    vertex_buffer = device.create_buffer(daxa::BufferInfo{
-        .size = static_cast<u32>(sizeof(Vertex) * vertices.size()),
-        .allocate_info = daxa::MemoryFlagBits::DEDICATED_MEMORY,
-        .name = "vertex buffer",
-    });
+auto Model::upload_materials() -> u64 {
+    std::vector<Material> gpu_materials = build_gpu_materials();
+    if(gpu_materials.empty()) { return 0; }
 
-    index_buffer = device.create_buffer(daxa::BufferInfo{
-        .size = static_cast<u32>(sizeof(u32) * indices.size()),
-        .allocate_info = daxa::MemoryFlagBits::DEDICATED_MEMORY,
-        .name = "index buffer",
+    return upload_service->upload({
+        std::span{reinterpret_cast<const u8*>(gpu_materials.data()), gpu_materials.size() * sizeof(Material)},
+    }, [this](daxa::CommandList& cmd_list, daxa::BufferId staging_buffer, u64 staging_offset) {
+        arena->record_material_copy(cmd_list, geometry, staging_buffer, staging_offset);
     });
+}
 
-    {
-        auto cmd_list = device.create_command_list({
-            .name = "cmd_list",
-        });
-
-        auto vertex_staging_buffer = device.create_buffer({
-            .size = static_cast<u32>(sizeof(Vertex) * vertices.size()),
-            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-            .name = "staging vertex buffer",
-        });
+auto Model::build_gpu_materials() const -> std::vector<Material> {
+    std::vector<Material> gpu_materials = {};
+    gpu_materials.reserve(materials.size());
 
-        cmd_list.destroy_buffer_deferred(vertex_staging_buffer);
+    // textures that arent loaded yet use null_texture
+    auto texture_of = [&](i32 image_index) -> TextureId {
+        if(image_index < 0 || static_cast<usize>(image_index) >= images.size() || images[static_cast<usize>(image_index)] == nullptr) { return null_texture->get_texture_id(); }
+        return images[static_cast<usize>(image_index)]->get_texture_id();
+    };
 
-        auto index_staging_buffer = device.create_buffer({
-            .size = static_cast<u32>(sizeof(u32) * indices.size()),
-            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-            .name = "staging index buffer",
+    for(const auto& material : materials) {
+        gpu_materials.push_back(Material {
+            .albedo_image = texture_of(material.albedo_image),
+            .has_albedo_image = material.albedo_image >= 0 ? 1 : 0,
+            .metallic_roughness_image = texture_of(material.metallic_roughness_image),
+            .has_metallic_roughness_image = material.metallic_roughness_image >= 0 ? 1 : 0,
+            .normal_image = texture_of(material.normal_image),
+            .has_normal_image = material.normal_image >= 0 ? 1 : 0,
+            .occlusion_image = texture_of(material.occlusion_image),
+            .has_occlusion_image = material.occlusion_image >= 0 ? 1 : 0,
+            .emissive_image = texture_of(material.emissive_image),
+            .has_emissive_image = material.emissive_image >= 0 ? 1 : 0,
         });
-        
-        cmd_list.destroy_buffer_deferred(index_staging_buffer);
+    }
 
-        {
-            auto buffer_ptr = device.get_host_address_as<Vertex>(vertex_staging_buffer);
-            std::memcpy(buffer_ptr, vertices.data(), vertices.size() * sizeof(Vertex));
-        }
+    return gpu_materials;
+}
 
-        {
-            auto buffer_ptr = device.get_host_address_as<Vertex>(index_staging_buffer);
-            std::memcpy(buffer_ptr, indices.data(), indices.size() * sizeof(u32));
-        }
+auto Model::get_first_index(const Primitive& primitive, const PrimitiveLod& lod) const -> u32 {
+    return static_cast<u32>((arena->get_slot(geometry).index_offset + lod.index_offset) / primitive.index_type_size);
+}
 
-        cmd_list.pipeline_barrier({
-            .src_access = daxa::AccessConsts::HOST_WRITE,
-            .dst_access = daxa::AccessConsts::TRANSFER_READ,
-        });
+auto Model::get_first_vertex(const Primitive& primitive) const -> u32 {
+    return static_cast<u32>(arena->get_slot(geometry).vertex_offset) + primitive.first_vertex;
+}
 
-        cmd_list.copy_buffer_to_buffer({
-            .src_buffer = vertex_staging_buffer,
-            .dst_buffer = vertex_buffer,
-            .size = static_cast<u32>(sizeof(Vertex) * vertices.size()),
-        });
+auto Model::get_material_index(const Primitive& primitive) const -> u32 {
+    return static_cast<u32>(arena->get_slot(geometry).material_offset) + primitive.material_index;
+}
 
-        cmd_list.copy_buffer_to_buffer({
-            .src_buffer = index_staging_buffer,
-            .dst_buffer = index_buffer,
-            .size = static_cast<u32>(sizeof(u32) * indices.size()),
-        });
+auto Model::select_lod(const Primitive& primitive, f32 max_error) const -> u32 {
+    u32 level = 0;
+    // errors only grow with the level
+    while(level + 1 < primitive.lod_count && lods[primitive.first_lod + level + 1].error <= max_error) { level++; }
+    return level;
+}
 
-        cmd_list.pipeline_barrier({
-            .src_access = daxa::AccessConsts::TRANSFER_WRITE,
-            .dst_access = daxa::AccessConsts::VERTEX_SHADER_READ,
-        });
-        cmd_list.complete();
-        device.submit_commands({
-            .command_lists = {std::move(cmd_list)},
-        });
-    }
+auto Model::get_lod(const Primitive& primitive, u32 level) const -> const PrimitiveLod& {
+    return lods[primitive.first_lod + std::min(level, primitive.lod_count - 1)];
 }
 
-Model::~Model() {
-    this->device.destroy_buffer(vertex_buffer);
-    this->device.destroy_buffer(index_buffer);
-    this->device.destroy_buffer(material_buffer);
-}
\ No newline at end of file
+auto Model::get_meshlet_layout() const -> MeshletLayout {
+    u64 meshlets_offset = arena->get_slot(geometry).meshlet_offset;
+    u64 vertices_offset = meshlets_offset + meshlet_count * sizeof(Meshlet);
+    return MeshletLayout {
+        .meshlets_offset = meshlets_offset,
+        .vertices_offset = vertices_offset,
+        .triangles_offset = vertices_offset + meshlet_vertex_count * sizeof(u32),
+    };
+}
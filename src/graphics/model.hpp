@@ -1,17 +1,100 @@
 #pragma once
 
 #include "texture.hpp"
+#include "model_importer.hpp"
+#include "geometry_arena.hpp"
+#include "upload_service.hpp"
+#include "texture_registry.hpp"
+#include "occlusion_culling.hpp"
+
+struct CookedModel;
+
+struct ModelImageSource {
+    std::filesystem::path path = {};
+    std::span<const u8> bytes = {};
+    daxa::Format format = {};
+};
+
+// cpu side of a model, imported from gltf or mapped from an up to date cooked file next to it. the pool is only used
+// by the import, see import_gltf_model
+struct ModelSource {
+    ModelSource(const std::filesystem::path& path, ThreadPool* pool);
+    ~ModelSource();
+
+    ModelSource(const ModelSource&) = delete;
+    auto operator=(const ModelSource&) -> ModelSource& = delete;
+
+    std::span<const PackedVertex> vertices = {};
+    std::span<const PackedPosition> positions = {};
+    std::span<const u8> index_data = {};
+    std::span<const Primitive> primitives = {};
+    std::span<const PrimitiveLod> lods = {};
+    std::span<const Meshlet> meshlets = {};
+    std::span<const u32> meshlet_vertices = {};
+    std::span<const u8> meshlet_triangles = {};
+    std::span<const ModelMaterial> materials = {};
+    std::vector<ModelImageSource> images = {};
+
+private:
+    ModelData model_data = {};
+    std::unique_ptr<CookedModel> cooked_model = {};
+};
+
+// byte offsets of the meshlet arrays of a model inside GeometryArena::meshlet_buffer
+struct MeshletLayout {
+    u64 meshlets_offset = {};
+    u64 vertices_offset = {};
+    u64 triangles_offset = {};
+};
 
 struct Model {
-    Model(daxa::Device _device, const std::string_view& file_path);
+    // loads and uploads everything before returning, the import and the textures run on the pool. never call it from
+    // a worker of that pool
+    Model(UploadService* _upload_service, GeometryArena* _arena, TextureRegistry* _texture_registry, const std::string_view& file_path, ThreadPool& pool);
+    // empty model that ModelLoader fills in the background, it isnt drawn until its geometry is uploaded
+    Model(UploadService* _upload_service, GeometryArena* _arena, TextureRegistry* _texture_registry);
     ~Model();
 
+    [[nodiscard]] auto is_ready() const -> bool { return ready; }
+
+    static auto load_image(TextureRegistry& texture_registry, const ModelImageSource& source) -> SharedTexture;
+
+    // stages vertices, positions, indices, materials and meshlets and takes over primitives, safe to call on a worker. the arena range is
+    // allocated when the upload is flushed, so the model has to stay alive until then. returns the upload value
+    auto upload_geometry(const ModelSource& source) -> u64;
+    // rewrites the materials with the textures loaded so far, main thread only
+    auto upload_materials() -> u64;
+
+    // where a primitive lives inside the arena buffers, the arena can move models so these are read every frame
+    [[nodiscard]] auto get_first_index(const Primitive& primitive, const PrimitiveLod& lod) const -> u32;
+    [[nodiscard]] auto get_first_vertex(const Primitive& primitive) const -> u32;
+    [[nodiscard]] auto get_material_index(const Primitive& primitive) const -> u32;
+    [[nodiscard]] auto get_meshlet_layout() const -> MeshletLayout;
+
+    // coarsest level whose error stays below max_error, in model space
+    [[nodiscard]] auto select_lod(const Primitive& primitive, f32 max_error) const -> u32;
+    // clamps the level to the ones the primitive has, the primitive needs indices
+    [[nodiscard]] auto get_lod(const Primitive& primitive, u32 level) const -> const PrimitiveLod&;
+
     daxa::Device device = {};
-    daxa::BufferId vertex_buffer = {};
-    daxa::BufferId index_buffer = {};
-    daxa::BufferId material_buffer = {};
+    UploadService* upload_service = {};
+    GeometryArena* arena = {};
+    TextureRegistry* texture_registry = {};
+    GeometryHandle geometry = {};
+    bool ready = false;
 
-    std::unique_ptr<Texture> null_texture = {};
-    std::vector<std::unique_ptr<Texture>> images = {};
+    std::shared_ptr<Texture> null_texture = {};
+    std::vector<std::shared_ptr<Texture>> images = {};
     std::vector<Primitive> primitives = {};
-};
\ No newline at end of file
+    std::vector<PrimitiveLod> lods = {};
+    std::vector<ModelMaterial> materials = {};
+    // one per primitive for the cpu occlusion culling, empty for the ones too detailed to be occluders
+    std::vector<OccluderMesh> occluders = {};
+    u32 meshlet_count = 0;
+    u32 meshlet_vertex_count = 0;
+
+private:
+    auto load_images(const std::vector<ModelImageSource>& sources, ThreadPool& pool) -> u64;
+    void build_occluders(const ModelSource& source);
+    auto build_gpu_materials() const -> std::vector<Material>;
+};
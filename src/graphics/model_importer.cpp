@@ -0,0 +1,309 @@
+#include "model_importer.hpp"
+
+#include <fastgltf/parser.hpp>
+#include <fastgltf/tools.hpp>
+#include <fastgltf/types.hpp>
+#include <fastgltf/util.hpp>
+#include <numeric>
+
+#include "vertex_quantization.hpp"
+#include "mesh_simplifier.hpp"
+#include "utils/threadpool.hpp"
+#include "utils/profiler.hpp"
+
+namespace {
+    struct AccessorView {
+        const u8* data = nullptr;
+        usize stride = 0;
+        usize count = 0;
+        fastgltf::ComponentType component_type = fastgltf::ComponentType::Float;
+        bool normalized = false;
+    };
+
+    auto get_component_size(fastgltf::ComponentType component_type) -> usize {
+        switch(component_type) {
+            case fastgltf::ComponentType::Byte:
+            case fastgltf::ComponentType::UnsignedByte: return 1;
+            case fastgltf::ComponentType::Short:
+            case fastgltf::ComponentType::UnsignedShort: return 2;
+            case fastgltf::ComponentType::UnsignedInt:
+            case fastgltf::ComponentType::Float: return 4;
+            case fastgltf::ComponentType::Double: return 8;
+            default: throw std::runtime_error("unhandled accessor component type");
+        }
+    }
+
+    auto get_accessor_view(const fastgltf::Asset& asset, usize accessor_index, usize component_count) -> AccessorView {
+        auto& accessor = asset.accessors[accessor_index];
+        auto& view = asset.bufferViews[accessor.bufferViewIndex.value()];
+        auto& bytes = std::get<fastgltf::sources::Vector>(asset.buffers[view.bufferIndex].data).bytes;
+        return AccessorView {
+            .data = &bytes[accessor.byteOffset + view.byteOffset],
+            .stride = view.byteStride.has_value() ? view.byteStride.value() : component_count * get_component_size(accessor.componentType),
+            .count = accessor.count,
+            .component_type = accessor.componentType,
+            .normalized = accessor.normalized,
+        };
+    }
+
+    auto find_attribute(const fastgltf::Asset& asset, const fastgltf::Primitive& primitive, std::string_view name, usize component_count) -> AccessorView {
+        auto it = primitive.findAttribute(name);
+        if(it == primitive.attributes.end()) { return {}; }
+        return get_accessor_view(asset, it->second, component_count);
+    }
+
+    // KHR_mesh_quantization lets attributes be stored as (normalized) 8 and 16 bit integers instead of floats
+    template<typename T>
+    auto read_integer_component(const u8* data, bool normalized) -> f32 {
+        T value = {};
+        std::memcpy(&value, data, sizeof(T));
+        if(!normalized) { return static_cast<f32>(value); }
+        return std::max(static_cast<f32>(value) / static_cast<f32>(std::numeric_limits<T>::max()), -1.0f);
+    }
+
+    template<usize N>
+    auto read_attribute(const AccessorView& view, usize index) -> std::array<f32, N> {
+        std::array<f32, N> result = {};
+        const u8* element = view.data + index * view.stride;
+        usize component_size = get_component_size(view.component_type);
+
+        for(usize c = 0; c < N; c++) {
+            const u8* component = element + c * component_size;
+            switch(view.component_type) {
+                case fastgltf::ComponentType::Float: { std::memcpy(&result[c], component, sizeof(f32)); break; }
+                case fastgltf::ComponentType::Byte: { result[c] = read_integer_component<i8>(component, view.normalized); break; }
+                case fastgltf::ComponentType::UnsignedByte: { result[c] = read_integer_component<u8>(component, view.normalized); break; }
+                case fastgltf::ComponentType::Short: { result[c] = read_integer_component<i16>(component, view.normalized); break; }
+                case fastgltf::ComponentType::UnsignedShort: { result[c] = read_integer_component<u16>(component, view.normalized); break; }
+                default: throw std::runtime_error("unhandled vertex attribute component type");
+            }
+        }
+
+        return result;
+    }
+
+    auto load_gltf_asset(const std::filesystem::path& path, fastgltf::Options options) -> fastgltf::Asset {
+        fastgltf::Parser parser(fastgltf::Extensions::KHR_mesh_quantization);
+
+        auto gltf_options = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble | options;
+        fastgltf::GltfDataBuffer data;
+        data.loadFromFile(path);
+
+        auto type = fastgltf::determineGltfFileType(&data);
+        fastgltf::Expected<fastgltf::Asset> asset(fastgltf::Error::None);
+        if (type == fastgltf::GltfType::glTF) {
+            asset = parser.loadGLTF(&data, path.parent_path(), gltf_options);
+        } else if (type == fastgltf::GltfType::GLB) {
+            asset = parser.loadBinaryGLTF(&data, path.parent_path(), gltf_options);
+        } else {
+            throw std::runtime_error("failed to determine gltf container: " + path.string());
+        }
+
+        if (asset.error() != fastgltf::Error::None) {
+            throw std::runtime_error("failed to load gltf: " + path.string());
+        }
+
+        return std::move(asset.get());
+    }
+}
+
+auto import_gltf_model(const std::filesystem::path& path, ThreadPool* pool) -> ModelData {
+    PROFILE_SCOPE("import_gltf_model");
+    if(!std::filesystem::exists(path)) {
+        throw std::runtime_error("couldnt not find model: " + path.string());
+    }
+
+    fastgltf::Asset asset = load_gltf_asset(path, fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers);
+
+    ModelData model = {};
+
+    auto image_index_of = [&](const auto& info) -> i32 {
+        if(!info.has_value()) { return -1; }
+        return static_cast<i32>(asset.textures[info.value().textureIndex].imageIndex.value());
+    };
+
+    model.materials.reserve(asset.materials.size());
+    for(auto& material : asset.materials) {
+        model.materials.push_back(ModelMaterial {
+            .albedo_image = image_index_of(material.pbrData.baseColorTexture),
+            .metallic_roughness_image = image_index_of(material.pbrData.metallicRoughnessTexture),
+            .normal_image = image_index_of(material.normalTexture),
+            .occlusion_image = image_index_of(material.occlusionTexture),
+            .emissive_image = image_index_of(material.emissiveTexture),
+        });
+    }
+
+    model.images.resize(asset.images.size());
+    for(usize i = 0; i < asset.images.size(); i++) {
+        auto& image = model.images[i];
+
+        // colors are authored in srgb, everything else is linear data
+        bool used_as_albedo = false;
+        bool used_as_emissive = false;
+        bool used_as_normal = false;
+        bool used_as_occlusion = false;
+        bool used_as_metallic_roughness = false;
+        for(auto& material : model.materials) {
+            used_as_albedo |= material.albedo_image == static_cast<i32>(i);
+            used_as_emissive |= material.emissive_image == static_cast<i32>(i);
+            used_as_normal |= material.normal_image == static_cast<i32>(i);
+            used_as_occlusion |= material.occlusion_image == static_cast<i32>(i);
+            used_as_metallic_roughness |= material.metallic_roughness_image == static_cast<i32>(i);
+        }
+
+        if(used_as_albedo || used_as_emissive) { image.format = daxa::Format::R8G8B8A8_SRGB; }
+
+        // albedo keeps alpha for cutouts, emissive only needs rgb, normals only xy and occlusion a single channel
+        if(used_as_albedo) { image.compressed_format = daxa::Format::BC7_SRGB_BLOCK; }
+        else if(used_as_emissive) { image.compressed_format = daxa::Format::BC1_RGB_SRGB_BLOCK; }
+        else if(used_as_normal) { image.compressed_format = daxa::Format::BC5_UNORM_BLOCK; }
+        else if(used_as_occlusion && !used_as_metallic_roughness) { image.compressed_format = daxa::Format::BC4_UNORM_BLOCK; }
+        else { image.compressed_format = daxa::Format::BC7_UNORM_BLOCK; }
+
+        std::visit(fastgltf::visitor {
+            [](auto&) {},
+            [&](fastgltf::sources::URI& image_path) {
+                image.path = path.parent_path() / std::string(image_path.uri.path().begin(), image_path.uri.path().end());
+            },
+            [&](fastgltf::sources::Vector& vector) {
+                image.bytes = vector.bytes;
+            },
+            [&](fastgltf::sources::BufferView& view) {
+                auto& buffer_view = asset.bufferViews[view.bufferViewIndex];
+                auto& gltf_buffer = asset.buffers[buffer_view.bufferIndex];
+                std::visit(fastgltf::visitor {
+                    [](auto&) {},
+                    [&](fastgltf::sources::Vector& vector) {
+                        auto begin = vector.bytes.begin() + static_cast<std::ptrdiff_t>(buffer_view.byteOffset);
+                        image.bytes.assign(begin, begin + static_cast<std::ptrdiff_t>(buffer_view.byteLength));
+                    },
+                }, gltf_buffer.data);
+            },
+        }, asset.images[i].data);
+    }
+
+    // size everything up front so the conversion below writes straight into place
+    usize total_vertex_count = 0;
+    usize total_index_count = 0;
+    for (auto& scene : asset.scenes) {
+        for (usize node_index : scene.nodeIndices) {
+            auto& node = asset.nodes[node_index];
+            if(!node.meshIndex.has_value()) { continue; }
+            for (auto& primitive : asset.meshes[node.meshIndex.value()].primitives) {
+                usize vertex_count = 0;
+                if(auto it = primitive.findAttribute("POSITION"); it != primitive.attributes.end()) {
+                    vertex_count = asset.accessors[it->second].count;
+                }
+                total_vertex_count += vertex_count;
+                // primitives without indices get a sequential list, so every draw goes through the indexed path
+                total_index_count += primitive.indicesAccessor.has_value() ? asset.accessors[primitive.indicesAccessor.value()].count : vertex_count;
+            }
+        }
+    }
+
+    model.vertices.resize(total_vertex_count);
+    model.indices.resize(total_index_count);
+
+    u32 vertex_offset = 0;
+    u32 index_offset = 0;
+    for (auto& scene : asset.scenes) {
+        for (usize node_index : scene.nodeIndices) {
+            auto& node = asset.nodes[node_index];
+            if(!node.meshIndex.has_value()) { continue; }
+
+            for (auto& primitive : asset.meshes[node.meshIndex.value()].primitives) {
+                AccessorView positions = find_attribute(asset, primitive, "POSITION", 3);
+                AccessorView normals = find_attribute(asset, primitive, "NORMAL", 3);
+                AccessorView uvs = find_attribute(asset, primitive, "TEXCOORD_0", 2);
+                AccessorView tangents = find_attribute(asset, primitive, "TANGENT", 4);
+
+                u32 vertex_count = static_cast<u32>(positions.count);
+                Vertex* vertices = model.vertices.data() + vertex_offset;
+                for (usize v = 0; v < vertex_count; v++) {
+                    Vertex& vertex = vertices[v];
+                    vertex = {};
+                    std::memcpy(&vertex.position, read_attribute<3>(positions, v).data(), sizeof(f32) * 3);
+                    if(normals.data != nullptr) { std::memcpy(&vertex.normal, read_attribute<3>(normals, v).data(), sizeof(f32) * 3); }
+                    if(uvs.data != nullptr) { std::memcpy(&vertex.uv, read_attribute<2>(uvs, v).data(), sizeof(f32) * 2); }
+                    if(tangents.data != nullptr) { std::memcpy(&vertex.tangent, read_attribute<4>(tangents, v).data(), sizeof(f32) * 4); }
+                }
+
+                u32 index_count = 0;
+                if(primitive.indicesAccessor.has_value()) {
+                    auto& accessor = asset.accessors[primitive.indicesAccessor.value()];
+                    index_count = static_cast<u32>(accessor.count);
+                    u32* indices = model.indices.data() + index_offset;
+
+                    switch(accessor.componentType) {
+                        case fastgltf::ComponentType::UnsignedInt: {
+                            AccessorView view = get_accessor_view(asset, primitive.indicesAccessor.value(), 1);
+                            std::memcpy(indices, view.data, index_count * sizeof(u32));
+                            break;
+                        }
+                        case fastgltf::ComponentType::UnsignedShort: {
+                            AccessorView view = get_accessor_view(asset, primitive.indicesAccessor.value(), 1);
+                            const u16* buf = reinterpret_cast<const u16*>(view.data);
+                            std::copy(buf, buf + index_count, indices);
+                            break;
+                        }
+                        case fastgltf::ComponentType::UnsignedByte: {
+                            AccessorView view = get_accessor_view(asset, primitive.indicesAccessor.value(), 1);
+                            std::copy(view.data, view.data + index_count, indices);
+                            break;
+                        }
+                        default: { throw std::runtime_error("unhandled index buffer type"); }
+                    }
+                } else {
+                    index_count = vertex_count;
+                    u32* indices = model.indices.data() + index_offset;
+                    std::iota(indices, indices + index_count, 0u);
+                }
+
+                if(!is_triangle_list(std::span{model.indices}.subspan(index_offset, index_count), vertex_count)) {
+                    throw std::runtime_error("couldnt import model, primitive is not a valid triangle list: " + path.string());
+                }
+
+                model.primitives.push_back(Primitive {
+                    .first_index = index_offset,
+                    .first_vertex = vertex_offset,
+                    .index_count = index_count,
+                    .vertex_count = vertex_count,
+                    .material_index = primitive.materialIndex.has_value() ? static_cast<u32>(primitive.materialIndex.value()) : 0,
+                    .index_offset = {},
+                    .index_type_size = sizeof(u32),
+                    .first_meshlet = 0,
+                    .meshlet_count = 0,
+                    .first_lod = 0,
+                    .lod_count = 0,
+                    .position_min = {},
+                    .position_scale = {},
+                });
+
+                vertex_offset += vertex_count;
+                index_offset += index_count;
+            }
+        }
+    }
+
+    model.optimization_stats = optimize_model(model, pool);
+    generate_model_lods(model, pool);
+
+    quantize_model(model);
+    return model;
+}
+
+auto get_gltf_dependencies(const std::filesystem::path& path) -> std::vector<std::filesystem::path> {
+    PROFILE_SCOPE("get_gltf_dependencies");
+    // only the json, the external buffers are what is being looked for
+    fastgltf::Asset asset = load_gltf_asset(path, fastgltf::Options::None);
+
+    std::vector<std::filesystem::path> dependencies = {};
+    auto add_uri = [&](const fastgltf::DataSource& source) {
+        if(const auto* uri = std::get_if<fastgltf::sources::URI>(&source); uri != nullptr && uri->uri.isLocalPath()) {
+            dependencies.push_back(path.parent_path() / std::string(uri->uri.path().begin(), uri->uri.path().end()));
+        }
+    };
+    for(const auto& buffer : asset.buffers) { add_uri(buffer.data); }
+    for(const auto& image : asset.images) { add_uri(image.data); }
+    return dependencies;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pch.hpp"
+#include "mesh_optimizer.hpp"
+
+struct ModelImage {
+    // an image either lives in its own file or is embedded as an encoded png/jpg in the model
+    std::filesystem::path path = {};
+    std::vector<u8> bytes = {};
+    daxa::Format format = daxa::Format::R8G8B8A8_UNORM;
+    // what asset_cooker encodes the image into, picked by how the materials use it
+    daxa::Format compressed_format = daxa::Format::BC7_UNORM_BLOCK;
+};
+
+// indices into ModelData::images, -1 when the material doesnt have the texture
+struct ModelMaterial {
+    i32 albedo_image = -1;
+    i32 metallic_roughness_image = -1;
+    i32 normal_image = -1;
+    i32 occlusion_image = -1;
+    i32 emissive_image = -1;
+};
+
+// one level of detail of a primitive, all levels index the same vertices and use the index type of the primitive
+struct PrimitiveLod {
+    // into ModelData::indices
+    u32 first_index = {};
+    u32 index_count = {};
+    // bytes into the packed index data, written by pack_indices
+    u32 index_offset = {};
+    // how far the surface is from full detail at most, in model space
+    f32 error = {};
+};
+
+// cpu side description of a model, independent of whether it came from gltf or a cooked file
+struct ModelData {
+    std::vector<Vertex> vertices = {};
+    // what goes to the gpu, kept in sync with vertices by quantize_model
+    std::vector<PackedVertex> packed_vertices = {};
+    std::vector<PackedPosition> packed_positions = {};
+    std::vector<u32> indices = {};
+    // what goes to the gpu, every primitive in the index type it picked, see pack_indices
+    std::vector<u8> index_data = {};
+    std::vector<Primitive> primitives = {};
+    std::vector<PrimitiveLod> lods = {};
+    // only filled by build_model_meshlets, asset_cooker runs it for cooked models
+    std::vector<Meshlet> meshlets = {};
+    std::vector<u32> meshlet_vertices = {};
+    std::vector<u8> meshlet_triangles = {};
+    std::vector<ModelMaterial> materials = {};
+    std::vector<ModelImage> images = {};
+    // vertex cache behaviour of the indices as authored and after import reordered them
+    MeshOptimizationStats optimization_stats = {};
+};
+
+// the primitives are optimized and simplified on the pool, or on the calling thread without one. a worker of the pool
+// itself has to pass none, waiting on the pool from inside it never returns
+auto import_gltf_model(const std::filesystem::path& path, ThreadPool* pool) -> ModelData;
+
+// the external buffers and images the model is read from, without loading them
+auto get_gltf_dependencies(const std::filesystem::path& path) -> std::vector<std::filesystem::path>;
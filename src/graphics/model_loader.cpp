@@ -0,0 +1,112 @@
+#include "model_loader.hpp"
+
+#include "utils/profiler.hpp"
+
+ModelLoader::ModelLoader(UploadService* _upload_service, GeometryArena* _arena, TextureRegistry* _texture_registry)
+    : upload_service{_upload_service},
+        arena{_arena},
+        texture_registry{_texture_registry},
+        pool{std::max(2u, std::thread::hardware_concurrency()) - 1} {}
+
+ModelLoader::~ModelLoader() {
+    stopping = true;
+    pool.wait_for_tasks();
+
+    // queued geometry uploads still point at their models
+    upload_service->flush();
+}
+
+auto ModelLoader::load(const std::string_view& file_path) -> std::shared_ptr<Model> {
+    auto model = std::make_shared<Model>(upload_service, arena, texture_registry);
+    uploads_in_flight++;
+
+    pool.push_task([this, model, path = std::filesystem::path{std::string{file_path}}] {
+        if(stopping) { uploads_in_flight--; return; }
+        PROFILE_SCOPE("ModelLoader geometry");
+
+        std::shared_ptr<ModelSource> source = {};
+        try {
+            // imports run serially on this worker, the other models and the textures keep the rest of the pool busy
+            source = std::make_shared<ModelSource>(path, nullptr);
+        } catch(const std::exception& e) {
+            std::cerr << "couldnt load model " << path.string() << ": " << e.what() << std::endl;
+            uploads_in_flight--;
+            return;
+        }
+
+        uploads_in_flight += static_cast<u32>(source->images.size());
+        push_upload(PendingUpload { .model = model, .upload_value = model->upload_geometry(*source) });
+
+        // every texture is its own job, the source stays alive until the last one is decoded
+        for(u32 i = 0; i < source->images.size(); i++) {
+            pool.push_task([this, model, source, i] {
+                if(stopping) { uploads_in_flight--; return; }
+                PROFILE_SCOPE("ModelLoader texture");
+
+                try {
+                    auto payload = Model::load_image(*texture_registry, source->images[i]);
+                    push_upload(PendingUpload {
+                        .model = model,
+                        .upload_value = payload.upload_value,
+                        .texture = std::move(payload.texture),
+                        .image_index = i,
+                    });
+                } catch(const std::exception& e) {
+                    std::cerr << "couldnt load texture " << source->images[i].path.string() << ": " << e.what() << std::endl;
+                    uploads_in_flight--;
+                }
+            });
+        }
+    });
+
+    return model;
+}
+
+void ModelLoader::push_upload(PendingUpload&& upload) {
+    std::lock_guard lock{pending_mutex};
+    pending_uploads.push_back(std::move(upload));
+}
+
+void ModelLoader::update() {
+    PROFILE_SCOPE("ModelLoader::update");
+    material_upload_models.clear();
+    {
+        std::lock_guard lock{pending_mutex};
+        for(auto& upload : pending_uploads) { queued_uploads.push_back(std::move(upload)); }
+        pending_uploads.clear();
+    }
+
+    if(queued_uploads.empty()) { return; }
+
+    // a texture shared through the registry can land long before the geometry of a model that uses it, so textures
+    // wait for their model to be ready. the geometry is queued before the textures of its model, so it marks the model
+    // ready earlier in the same loop
+    u64 completed_value = upload_service->get_completed_value();
+    std::vector<std::shared_ptr<Model>> updated_models = {};
+    auto is_landed = [&](const PendingUpload& upload) {
+        return upload.upload_value <= completed_value && (upload.texture == nullptr || upload.model->ready);
+    };
+    for(auto& upload : queued_uploads) {
+        if(!is_landed(upload)) { continue; }
+
+        if(upload.texture == nullptr) {
+            upload.model->ready = true;
+        } else {
+            upload.model->images[upload.image_index] = std::move(upload.texture);
+            if(std::find(updated_models.begin(), updated_models.end(), upload.model) == updated_models.end()) {
+                updated_models.push_back(upload.model);
+            }
+        }
+
+        uploads_in_flight--;
+    }
+
+    // one material rewrite per model no matter how many of its textures landed since the last update
+    for(auto& model : updated_models) {
+        model->upload_materials();
+    }
+
+    material_upload_models = std::move(updated_models);
+
+    std::erase_if(queued_uploads, is_landed);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "model.hpp"
+#include "utils/threadpool.hpp"
+
+#include <mutex>
+
+// loads models on a thread pool while the application keeps rendering. load returns an empty model right away,
+// workers decode and queue their uploads on the upload service and update hands the results to the models once
+// they are on the gpu. a model becomes visible once its geometry is there, its materials use null_texture until
+// their textures arrive one by one. textures are shared with every other model through the texture registry
+struct ModelLoader {
+    ModelLoader(UploadService* _upload_service, GeometryArena* _arena, TextureRegistry* _texture_registry);
+    ~ModelLoader();
+
+    auto load(const std::string_view& file_path) -> std::shared_ptr<Model>;
+
+    // called once per frame before the upload service is flushed, never waits on the gpu or on the workers
+    void update();
+
+    // for loads that have to finish before they return, see Model::Model
+    [[nodiscard]] auto get_pool() -> ThreadPool& { return pool; }
+
+    // geometry and texture uploads that were requested but havent landed on the gpu yet
+    [[nodiscard]] auto get_uploads_in_flight() const -> u32 { return uploads_in_flight; }
+
+private:
+    struct PendingUpload {
+        std::shared_ptr<Model> model = {};
+        u64 upload_value = {};
+        // empty for the geometry upload
+        std::shared_ptr<Texture> texture = {};
+        u32 image_index = {};
+    };
+
+    void push_upload(PendingUpload&& upload);
+
+    UploadService* upload_service = {};
+    GeometryArena* arena = {};
+    TextureRegistry* texture_registry = {};
+
+    std::mutex pending_mutex = {};
+    std::vector<PendingUpload> pending_uploads = {};
+    std::vector<PendingUpload> queued_uploads = {};
+    // material uploads record into their model when flushed, so the models are kept alive until the next update
+    std::vector<std::shared_ptr<Model>> material_upload_models = {};
+    std::atomic<u32> uploads_in_flight = 0;
+    std::atomic<bool> stopping = false;
+
+    // last so the workers are joined before anything they touch is destroyed
+    ThreadPool pool;
+};
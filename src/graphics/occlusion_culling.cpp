@@ -0,0 +1,256 @@
+#include "occlusion_culling.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OCCLUSION_CULLING_AVX2
+#endif
+
+namespace {
+    // edge function of the edge from a to b as a * x + b * y + c, positive on the inside of a counter clockwise triangle
+    struct Edge {
+        f32 a = {};
+        f32 b = {};
+        f32 c = {};
+    };
+
+    auto make_edge(const glm::vec3& from, const glm::vec3& to) -> Edge {
+        f32 a = from.y - to.y;
+        f32 b = to.x - from.x;
+        return Edge { .a = a, .b = b, .c = -(a * from.x + b * from.y) };
+    }
+
+    // everything a kernel needs per triangle, the depth is a plane over the screen like the edges
+    struct TriangleSetup {
+        std::array<Edge, 3> edges = {};
+        Edge depth = {};
+        u32 min_x = {};
+        u32 max_x = {};
+        u32 min_y = {};
+        u32 max_y = {};
+    };
+
+    // false when the triangle is degenerate or covers no pixel of the rows
+    auto setup_triangle(const OcclusionBuffer& buffer, const OccluderTriangle& triangle, u32 first_row, u32 last_row, TriangleSetup& setup) -> bool {
+        glm::vec3 v0 = triangle.vertices[0];
+        glm::vec3 v1 = triangle.vertices[1];
+        glm::vec3 v2 = triangle.vertices[2];
+        f32 area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if(area == 0.0f) { return false; }
+        // occluders block from both sides, the winding only decides the sign of the edges
+        if(area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        f32 min_x = std::max(std::floor(std::min({v0.x, v1.x, v2.x})), 0.0f);
+        f32 max_x = std::min(std::ceil(std::max({v0.x, v1.x, v2.x})), static_cast<f32>(buffer.width));
+        f32 min_y = std::max(std::floor(std::min({v0.y, v1.y, v2.y})), static_cast<f32>(first_row));
+        f32 max_y = std::min(std::ceil(std::max({v0.y, v1.y, v2.y})), static_cast<f32>(last_row));
+        if(min_x >= max_x || min_y >= max_y) { return false; }
+
+        setup.edges = { make_edge(v1, v2), make_edge(v2, v0), make_edge(v0, v1) };
+        // the edges opposite a vertex are its barycentric weight times the area
+        f32 dz1 = (v1.z - v0.z) / area;
+        f32 dz2 = (v2.z - v0.z) / area;
+        setup.depth.a = setup.edges[1].a * dz1 + setup.edges[2].a * dz2;
+        setup.depth.b = setup.edges[1].b * dz1 + setup.edges[2].b * dz2;
+        setup.depth.c = v0.z - setup.depth.a * v0.x - setup.depth.b * v0.y;
+
+        // a pixel stands for everything on screen behind it, so the kernels evaluate at its center what holds for the
+        // whole pixel. the edges move inwards to the corner of the pixel least inside the triangle and the depth to the
+        // farthest corner, a pixel is then only covered when all of it is and never nearer than any part of it
+        for(auto& edge : setup.edges) { edge.c -= 0.5f * (std::abs(edge.a) + std::abs(edge.b)); }
+        setup.depth.c += 0.5f * (std::abs(setup.depth.a) + std::abs(setup.depth.b));
+        setup.min_x = static_cast<u32>(min_x);
+        setup.max_x = static_cast<u32>(max_x);
+        setup.min_y = static_cast<u32>(min_y);
+        setup.max_y = static_cast<u32>(max_y);
+        return true;
+    }
+
+    // rows are whole tile rows
+    void update_tile_depths(OcclusionBuffer& buffer, u32 first_row, u32 last_row) {
+        for(u32 tile_y = first_row / OCCLUSION_TILE_HEIGHT; tile_y < last_row / OCCLUSION_TILE_HEIGHT; tile_y++) {
+            for(u32 tile_x = 0; tile_x < buffer.tiles_x; tile_x++) {
+                f32 farthest = -std::numeric_limits<f32>::max();
+                for(u32 y = tile_y * OCCLUSION_TILE_HEIGHT; y < (tile_y + 1) * OCCLUSION_TILE_HEIGHT; y++) {
+                    const f32* row = buffer.depth.data() + static_cast<usize>(y) * buffer.width + tile_x * OCCLUSION_TILE_WIDTH;
+                    farthest = std::max(farthest, *std::max_element(row, row + OCCLUSION_TILE_WIDTH));
+                }
+                buffer.tile_max_depth[static_cast<usize>(tile_y) * buffer.tiles_x + tile_x] = farthest;
+            }
+        }
+    }
+
+    auto get_band_rows(const OcclusionBuffer& buffer, u32 first_tile_row, u32 tile_row_count) -> std::pair<u32, u32> {
+        u32 last_tile_row = std::min(first_tile_row + tile_row_count, buffer.tiles_y);
+        return { std::min(first_tile_row, last_tile_row) * OCCLUSION_TILE_HEIGHT, last_tile_row * OCCLUSION_TILE_HEIGHT };
+    }
+}
+
+void OcclusionBuffer::resize(u32 _width, u32 _height) {
+    tiles_x = std::max((_width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH, 1u);
+    tiles_y = std::max((_height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT, 1u);
+    width = tiles_x * OCCLUSION_TILE_WIDTH;
+    height = tiles_y * OCCLUSION_TILE_HEIGHT;
+    depth.resize(static_cast<usize>(width) * height);
+    tile_max_depth.resize(static_cast<usize>(tiles_x) * tiles_y);
+    clear();
+}
+
+void OcclusionBuffer::clear() {
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    std::fill(tile_max_depth.begin(), tile_max_depth.end(), 1.0f);
+}
+
+void project_occluder(const OcclusionBuffer& buffer, const glm::mat4& projection_view_model, std::span<const glm::vec3> positions, std::span<const u32> indices, std::vector<OccluderTriangle>& triangles) {
+    glm::vec2 screen_scale = { static_cast<f32>(buffer.width) * 0.5f, static_cast<f32>(buffer.height) * 0.5f };
+    auto to_screen = [&](const glm::vec4& clip) -> glm::vec3 {
+        glm::vec3 ndc = glm::vec3{clip} / clip.w;
+        return { (ndc.x + 1.0f) * screen_scale.x, (ndc.y + 1.0f) * screen_scale.y, ndc.z };
+    };
+
+    for(usize i = 0; i + 2 < indices.size(); i += 3) {
+        std::array<glm::vec4, 3> clip = {};
+        for(usize v = 0; v < 3; v++) { clip[v] = projection_view_model * glm::vec4{positions[indices[i + v]], 1.0f}; }
+
+        // Sutherland Hodgman against the near plane z = 0 the gpu clips at, one plane turns the triangle into at most a quad
+        std::array<glm::vec4, 4> polygon = {};
+        usize vertex_count = 0;
+        for(usize v = 0; v < 3; v++) {
+            const glm::vec4& current = clip[v];
+            const glm::vec4& next = clip[(v + 1) % 3];
+            f32 current_distance = current.z;
+            f32 next_distance = next.z;
+            if(current_distance >= 0.0f) { polygon[vertex_count++] = current; }
+            if((current_distance >= 0.0f) != (next_distance >= 0.0f)) {
+                polygon[vertex_count++] = current + (next - current) * (current_distance / (current_distance - next_distance));
+            }
+        }
+        if(vertex_count < 3) { continue; }
+        if(std::any_of(polygon.begin(), polygon.begin() + static_cast<isize>(vertex_count), [](const glm::vec4& p){ return p.w <= 0.0f; })) { continue; }
+
+        for(usize v = 1; v + 1 < vertex_count; v++) {
+            triangles.push_back(OccluderTriangle { .vertices = { to_screen(polygon[0]), to_screen(polygon[v]), to_screen(polygon[v + 1]) } });
+        }
+    }
+}
+
+void rasterize_occluders(OcclusionBuffer& buffer, std::span<const OccluderTriangle> triangles, u32 first_tile_row, u32 tile_row_count) {
+#if defined(OCCLUSION_CULLING_AVX2)
+    auto [first_row, last_row] = get_band_rows(buffer, first_tile_row, tile_row_count);
+    const __m256 lane_centers = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    TriangleSetup setup = {};
+    for(const auto& triangle : triangles) {
+        if(!setup_triangle(buffer, triangle, first_row, last_row, setup)) { continue; }
+
+        // rows start on a tile column, the lanes outside the bounds are outside the triangle as well
+        u32 first_x = setup.min_x / OCCLUSION_TILE_WIDTH * OCCLUSION_TILE_WIDTH;
+        for(u32 y = setup.min_y; y < setup.max_y; y++) {
+            f32 center_y = static_cast<f32>(y) + 0.5f;
+            const __m256 row_0 = _mm256_set1_ps(setup.edges[0].b * center_y + setup.edges[0].c);
+            const __m256 row_1 = _mm256_set1_ps(setup.edges[1].b * center_y + setup.edges[1].c);
+            const __m256 row_2 = _mm256_set1_ps(setup.edges[2].b * center_y + setup.edges[2].c);
+            const __m256 row_depth = _mm256_set1_ps(setup.depth.b * center_y + setup.depth.c);
+            f32* row = buffer.depth.data() + static_cast<usize>(y) * buffer.width;
+
+            for(u32 x = first_x; x < setup.max_x; x += OCCLUSION_TILE_WIDTH) {
+                __m256 center_x = _mm256_add_ps(_mm256_set1_ps(static_cast<f32>(x)), lane_centers);
+                __m256 inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(setup.edges[0].a), center_x), row_0), _mm256_setzero_ps(), _CMP_GT_OQ);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(setup.edges[1].a), center_x), row_1), _mm256_setzero_ps(), _CMP_GT_OQ));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(setup.edges[2].a), center_x), row_2), _mm256_setzero_ps(), _CMP_GT_OQ));
+                if(_mm256_movemask_ps(inside) == 0) { continue; }
+
+                __m256 depth = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(setup.depth.a), center_x), row_depth);
+                __m256 current = _mm256_loadu_ps(row + x);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, depth), inside));
+            }
+        }
+    }
+    update_tile_depths(buffer, first_row, last_row);
+#else
+    rasterize_occluders_scalar(buffer, triangles, first_tile_row, tile_row_count);
+#endif
+}
+
+void rasterize_occluders_scalar(OcclusionBuffer& buffer, std::span<const OccluderTriangle> triangles, u32 first_tile_row, u32 tile_row_count) {
+    auto [first_row, last_row] = get_band_rows(buffer, first_tile_row, tile_row_count);
+    TriangleSetup setup = {};
+    for(const auto& triangle : triangles) {
+        if(!setup_triangle(buffer, triangle, first_row, last_row, setup)) { continue; }
+
+        for(u32 y = setup.min_y; y < setup.max_y; y++) {
+            // same operation order as the avx2 kernel so both cover the same pixels
+            f32 center_y = static_cast<f32>(y) + 0.5f;
+            std::array<f32, 3> rows = {};
+            for(usize e = 0; e < 3; e++) { rows[e] = setup.edges[e].b * center_y + setup.edges[e].c; }
+            f32 row_depth = setup.depth.b * center_y + setup.depth.c;
+            f32* row = buffer.depth.data() + static_cast<usize>(y) * buffer.width;
+
+            for(u32 x = setup.min_x; x < setup.max_x; x++) {
+                f32 center_x = static_cast<f32>(x) + 0.5f;
+                bool inside = true;
+                for(usize e = 0; e < 3; e++) { inside = inside && setup.edges[e].a * center_x + rows[e] > 0.0f; }
+                if(!inside) { continue; }
+                row[x] = std::min(row[x], setup.depth.a * center_x + row_depth);
+            }
+        }
+    }
+    update_tile_depths(buffer, first_row, last_row);
+}
+
+auto is_box_occluded(const OcclusionBuffer& buffer, const glm::mat4& projection_view, const glm::vec3& min, const glm::vec3& max) -> bool {
+    glm::vec2 screen_min = glm::vec2{std::numeric_limits<f32>::max()};
+    glm::vec2 screen_max = glm::vec2{-std::numeric_limits<f32>::max()};
+    f32 nearest_depth = std::numeric_limits<f32>::max();
+    for(u32 i = 0; i < 8; i++) {
+        glm::vec3 corner = { (i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z };
+        glm::vec4 clip = projection_view * glm::vec4{corner, 1.0f};
+        if(clip.w <= 0.0f || clip.z < 0.0f) { return false; }
+
+        glm::vec3 ndc = glm::vec3{clip} / clip.w;
+        glm::vec2 screen = { (ndc.x + 1.0f) * 0.5f * static_cast<f32>(buffer.width), (ndc.y + 1.0f) * 0.5f * static_cast<f32>(buffer.height) };
+        screen_min = glm::min(screen_min, screen);
+        screen_max = glm::max(screen_max, screen);
+        nearest_depth = std::min(nearest_depth, ndc.z);
+    }
+
+    // every pixel the box could overlap any part of
+    i32 min_x = static_cast<i32>(std::floor(std::max(screen_min.x, 0.0f)));
+    i32 min_y = static_cast<i32>(std::floor(std::max(screen_min.y, 0.0f)));
+    i32 max_x = static_cast<i32>(std::floor(std::min(screen_max.x, static_cast<f32>(buffer.width - 1))));
+    i32 max_y = static_cast<i32>(std::floor(std::min(screen_max.y, static_cast<f32>(buffer.height - 1))));
+    if(min_x > max_x || min_y > max_y) { return false; }
+
+    for(i32 tile_y = min_y / static_cast<i32>(OCCLUSION_TILE_HEIGHT); tile_y <= max_y / static_cast<i32>(OCCLUSION_TILE_HEIGHT); tile_y++) {
+        for(i32 tile_x = min_x / static_cast<i32>(OCCLUSION_TILE_WIDTH); tile_x <= max_x / static_cast<i32>(OCCLUSION_TILE_WIDTH); tile_x++) {
+            // the whole tile is in front of the box, only tiles the box could show through need their pixels read
+            if(buffer.tile_max_depth[static_cast<usize>(tile_y) * buffer.tiles_x + static_cast<usize>(tile_x)] < nearest_depth) { continue; }
+
+            i32 first_y = std::max(min_y, tile_y * static_cast<i32>(OCCLUSION_TILE_HEIGHT));
+            i32 last_y = std::min(max_y, (tile_y + 1) * static_cast<i32>(OCCLUSION_TILE_HEIGHT) - 1);
+            i32 first_x = std::max(min_x, tile_x * static_cast<i32>(OCCLUSION_TILE_WIDTH));
+            i32 last_x = std::min(max_x, (tile_x + 1) * static_cast<i32>(OCCLUSION_TILE_WIDTH) - 1);
+            for(i32 y = first_y; y <= last_y; y++) {
+                for(i32 x = first_x; x <= last_x; x++) {
+                    if(buffer.depth[static_cast<usize>(y) * buffer.width + static_cast<usize>(x)] >= nearest_depth) { return false; }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void cull_occluded(const OcclusionBuffer& buffer, const glm::mat4& projection_view, const CullingBounds& bounds, std::vector<u32>& visible) {
+    std::erase_if(visible, [&](u32 index) {
+        return is_box_occluded(buffer, projection_view, { bounds.min_x[index], bounds.min_y[index], bounds.min_z[index] }, { bounds.max_x[index], bounds.max_y[index], bounds.max_z[index] });
+    });
+}
+
+auto get_occlusion_instruction_set() -> std::string_view {
+#if defined(OCCLUSION_CULLING_AVX2)
+    return "avx2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "frustum_culling.hpp"
+
+// pixels per tile, a tile row is one avx2 register wide and the tiles keep the farthest depth of their pixels
+constexpr u32 OCCLUSION_TILE_WIDTH = 8;
+constexpr u32 OCCLUSION_TILE_HEIGHT = 4;
+
+// occluders are the coarsest lod that stays this close to the surface, relative to the primitive extent. planar walls
+// simplify without error and end up as a handful of triangles
+constexpr f32 OCCLUDER_MAX_RELATIVE_ERROR = 0.001f;
+// primitives still more detailed than this make poor occluders and get none
+constexpr u32 MAX_OCCLUDER_TRIANGLES = 4096;
+
+// low poly copy of a primitive kept on the cpu, in model space
+struct OccluderMesh {
+    std::vector<glm::vec3> positions = {};
+    std::vector<u32> indices = {};
+};
+
+// screen space triangle, x and y in pixels and z the depth after the perspective divide
+struct OccluderTriangle {
+    std::array<glm::vec3, 3> vertices = {};
+};
+
+// small depth buffer of the occluders with one hierarchical level above it. a pixel holds the farthest depth of the
+// occluders over all of it, depths are what the projection puts between the near plane the gpu clips at and 1 and
+// the buffer is cleared to 1
+struct OcclusionBuffer {
+    u32 width = {};
+    u32 height = {};
+    u32 tiles_x = {};
+    u32 tiles_y = {};
+    std::vector<f32> depth = {};
+    std::vector<f32> tile_max_depth = {};
+
+    // rounds the size up to whole tiles
+    void resize(u32 width, u32 height);
+    void clear();
+};
+
+// projects the triangles of an occluder into the screen space of the buffer and clips them against z = 0 like the
+// gpu, the indices point into positions and the matrix takes them to clip space
+void project_occluder(const OcclusionBuffer& buffer, const glm::mat4& projection_view_model, std::span<const glm::vec3> positions, std::span<const u32> indices, std::vector<OccluderTriangle>& triangles);
+
+// rasterizes into the tile rows [first_tile_row, first_tile_row + tile_row_count) and rebuilds their tile depths, bands
+// of different rows can run in parallel. only pixels entirely inside a triangle are covered and they get the farthest
+// depth of the triangle over the pixel, so silhouettes, cracks and slopes never hide more than the occluder itself.
+// uses AVX2 when the compiler targets it and falls back to rasterize_occluders_scalar otherwise
+void rasterize_occluders(OcclusionBuffer& buffer, std::span<const OccluderTriangle> triangles, u32 first_tile_row, u32 tile_row_count);
+// reference implementation with the same results
+void rasterize_occluders_scalar(OcclusionBuffer& buffer, std::span<const OccluderTriangle> triangles, u32 first_tile_row, u32 tile_row_count);
+
+// true when the box is behind the occluders at every pixel it overlaps, boxes crossing the near plane never are
+auto is_box_occluded(const OcclusionBuffer& buffer, const glm::mat4& projection_view, const glm::vec3& min, const glm::vec3& max) -> bool;
+// removes the occluded boxes out of visible and keeps the order of the rest
+void cull_occluded(const OcclusionBuffer& buffer, const glm::mat4& projection_view, const CullingBounds& bounds, std::vector<u32>& visible);
+
+// instruction set rasterize_occluders was compiled for
+auto get_occlusion_instruction_set() -> std::string_view;
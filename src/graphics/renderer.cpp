@@ -1,7 +1,10 @@
 #include "renderer.hpp"
 #include <imgui_impl_glfw.h>
 #include <implot.h>
+#include "utils/profiler.hpp"
+#include "shadow_cascades.hpp"
 
+#include "tasks/cull_draws.inl"
 #include "tasks/depth_prepass.inl"
 #include "tasks/g_buffer_generation.inl"
 #include "tasks/display_attachment.inl"
@@ -25,22 +28,30 @@
 #include "tasks/temporal_antialiasing.inl"
 
 Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<Scene>& scene) 
-    : window{_window}, context{_context}, scene_hiearchy_panel{std::make_shared<SceneHiearchyPanel>(scene)} {
-    ImGui::CreateContext();
-    ImPlot::CreateContext();
-    ImGui_ImplGlfw_InitForVulkan(window->glfw_handle, true);
-    imgui_renderer =  daxa::ImGuiRenderer({
-        .device = context->device,
-        .format = context->swapchain.get_format(),
-    });
-    ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    : Renderer{_window, _window->get_width(), _window->get_height(), _context, scene} {}
+
+Renderer::Renderer(u32 _size_x, u32 _size_y, Context* _context, const std::shared_ptr<Scene>& scene) 
+    : Renderer{nullptr, _size_x, _size_y, _context, scene} {}
+
+Renderer::Renderer(AppWindow* _window, u32 _size_x, u32 _size_y, Context* _context, const std::shared_ptr<Scene>& scene) 
+    : window{_window}, context{_context}, size_x{_size_x}, size_y{_size_y}, scene_hiearchy_panel{std::make_shared<SceneHiearchyPanel>(scene)} {
+    if(!context->headless) {
+        ImGui::CreateContext();
+        ImPlot::CreateContext();
+        ImGui_ImplGlfw_InitForVulkan(window->glfw_handle, true);
+        imgui_renderer =  daxa::ImGuiRenderer({
+            .device = context->device,
+            .format = context->output_format,
+        });
+        ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    }
 
     sun_shadow_image = daxa::TaskImage{daxa::TaskImageInfo {
         .initial_images = {
             .images = std::array{
                 context->device.create_image(daxa::ImageInfo {
                     .format = daxa::Format::D32_SFLOAT,
-                    .size = {4096, 4096, 1},
+                    .size = {sun_shadow_resolution, sun_shadow_resolution, 1},
                     .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_SAMPLED,
                     .name = "shadow image"
                 })
@@ -106,35 +117,15 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
     context->shader_global_block.globals.compression = 0.15f;
     context->shader_global_block.globals.frame_counter = 0;
 
-    glm::vec3 light_position(-3.2f, 40.0f, -4.0f);
-    f32 planes = 16.0f;
-    glm::mat4 light_projection = glm::ortho(-planes, planes, -planes, planes, -planes, planes);
-
-    glm::vec3 dir = { 0.0f, -1.0f, 0.0f };
-    dir = glm::rotateX(dir, glm::radians(angle_direction.x));
-    dir = glm::rotateY(dir, glm::radians(angle_direction.y));
-    dir = glm::rotateZ(dir, glm::radians(angle_direction.z));
-    //dir = glm::normalize(dir);
-
-    glm::mat4 light_view = glm::lookAt(light_position, light_position + dir, glm::vec3(0.0, -1.0, 0.0));
-
-    glm::mat4 projection_view_matrix = light_projection * light_view;
-    glm::vec4 terrain_y_clip_trick = projection_view_matrix * glm::vec4{0.0f, 1.0f, 0.0f, 0.0f};
-
-    block->globals.sun_info.position = *reinterpret_cast<f32vec3*>(&light_position);
-    block->globals.sun_info.direction = *reinterpret_cast<f32vec3*>(&dir);
-    block->globals.sun_info.projection_matrix = *reinterpret_cast<f32mat4x4*>(&light_projection);
-    block->globals.sun_info.view_matrix = *reinterpret_cast<f32mat4x4*>(&light_view);
-    block->globals.sun_info.projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&projection_view_matrix);
-    block->globals.sun_info.terrain_y_clip_trick = *reinterpret_cast<f32vec4*>(&terrain_y_clip_trick);
-    block->globals.sun_info.exponential_factor = -80.0f;
+    // per world unit of depth between the receiver and the caster
+    block->globals.sun_info.exponential_factor = -5.0f;
     block->globals.sun_info.darkening_factor = 1.0f;
     block->globals.sun_info.bias = 0.0001f;
     block->globals.sun_info.intensity = 1.0f;
 
-    block->globals.resolution = { static_cast<i32>(window->get_width()), static_cast<i32>(window->get_height()) };
+    block->globals.resolution = { static_cast<i32>(size_x), static_cast<i32>(size_y) };
 
-    context->frame_index = context->swapchain.get_cpu_timeline_value() % (context->swapchain.info().max_allowed_frames_in_flight);
+    context->frame_index = 0;
 
     char* mapped_ptr = reinterpret_cast<char*>(context->device.get_host_address(context->shader_globals_buffer));
     auto* ptr = reinterpret_cast<ShaderGlobalsBlock*>(mapped_ptr + ((static_cast<i32>(sizeof(ShaderGlobalsBlock)) + 256 - 1) / 256) * 256 * context->frame_index);
@@ -149,11 +140,11 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
 
     compile_pipelines();
 
-    noise_texture = std::make_unique<Texture>(context->device, "assets/Clouds/noise.png", daxa::Format::R8G8B8A8_UNORM, daxa::ImageUsageFlagBits::SHADER_STORAGE);
+    noise_texture = std::make_unique<Texture>(*context->upload_service, *context->sampler_cache, "assets/Clouds/noise.png", daxa::Format::R8G8B8A8_UNORM, daxa::ImageUsageFlagBits::SHADER_STORAGE);
 
     {
-        terrain_heightmap = std::make_unique<Texture>(context->device, "assets/Terrain/heightmap.exr", daxa::Format::R8G8B8A8_UNORM, daxa::ImageUsageFlagBits::SHADER_STORAGE);
-        terrain_albedomap = std::make_unique<Texture>(context->device, "assets/Terrain/albedo.exr", daxa::Format::R8G8B8A8_SRGB);
+        terrain_heightmap = std::make_unique<Texture>(*context->upload_service, *context->sampler_cache, "assets/Terrain/heightmap.exr", daxa::Format::R8G8B8A8_UNORM, daxa::ImageUsageFlagBits::SHADER_STORAGE);
+        terrain_albedomap = std::make_unique<Texture>(*context->upload_service, *context->sampler_cache, "assets/Terrain/albedo.exr", daxa::Format::R8G8B8A8_SRGB);
         
         daxa::TaskImage terrain_heightmap_image = daxa::TaskImage{daxa::TaskImageInfo{ .initial_images = { .images = std::array{terrain_heightmap->image_id}}, .name = "terrain heightmap"}};
         terrain_normalmap_task = daxa::TaskImage{daxa::TaskImageInfo{ 
@@ -307,6 +298,14 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
 
     buffers.push_back(auto_exposure_buffer);
 
+    // the draw buffers get their buffers on the first upload, sized to the scene
+    draw_list.camera_draws = daxa::TaskBuffer{{ .name = "camera draws" }};
+    draw_list.late_draws = daxa::TaskBuffer{{ .name = "camera late draws" }};
+    for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+        draw_list.sun_draws[i] = daxa::TaskBuffer{{ .name = "sun draws " + std::to_string(i) }};
+    }
+    draw_list.visibility = daxa::TaskBuffer{{ .name = "draw visibility" }};
+
     color_image = daxa::TaskImage{{ .name = "color image" }};
     albedo_image = daxa::TaskImage{{ .name = "albedo image" }};
     emissive_image = daxa::TaskImage{{ .name = "emissive image" }};
@@ -343,7 +342,7 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
         depth_of_field_image
     };
 
-    depth_of_field_mips = static_cast<u32>(std::floor(std::log2(std::max(window->get_width(), window->get_height())))) + 1;
+    depth_of_field_mips = static_cast<u32>(std::floor(std::log2(std::max(size_x, size_y)))) + 1;
 
     frame_buffer_images = {
         {
@@ -487,9 +486,22 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
         .name = "depth of field sampler"
     });
 
-    swapchain_image = daxa::TaskImage{{.swapchain_image = true, .name = "swapchain image"}};
+    if(context->headless) {
+        swapchain_image = daxa::TaskImage{{ .name = "output image" }};
+        images.push_back(swapchain_image);
+        frame_buffer_images.push_back({
+            {
+                .format = context->output_format,
+                .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::TRANSFER_SRC,
+                .name = swapchain_image.info().name,
+            },
+            swapchain_image,
+        });
+    } else {
+        swapchain_image = daxa::TaskImage{{.swapchain_image = true, .name = "swapchain image"}};
+    }
 
-    glm::uvec2 mip_size = { window->get_width(), window->get_height() };
+    glm::uvec2 mip_size = { size_x, size_y };
     for(usize i = 0; i < mip_chain_length; i++) {
         daxa::TaskImage mip = daxa::TaskImage{ daxa::TaskImageInfo {
                 .name = "bloom mip chain " + std::to_string(i)
@@ -516,14 +528,16 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
 
     {
         std::vector<std::string> name_tasks = {
+            std::string{CullDrawsTask::NAME},
+            std::string{CullDrawsTask::NAME} + " - late",
+            std::string{GenerateMaxHIZTask::NAME} + " - occlusion",
             std::string{DepthPrepassTask::NAME},
-            std::string{SunShadowDrawTask::NAME},
+            std::string{DepthPrepassTask::NAME} + " - late",
             std::string{GBufferGenerationTask::NAME},
             std::string{DrawTerrainTask::NAME},
             std::string{SSAOGenerationTask::NAME},
             std::string{SSAOBlurTask::NAME},
             std::string{CompositionTask::NAME},
-            std::string{SunShadowDrawTerrainTask::NAME},
             std::string{CloudRenderingTask::NAME},
             std::string{GenerateMinHIZTask::NAME},
             std::string{GenerateMaxHIZTask::NAME},
@@ -545,23 +559,32 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
             names[name_tasks.back()] = "Bloom";
         }
 
+        for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+            name_tasks.push_back(std::string{SunShadowDrawTask::NAME} + " - " + std::to_string(i));
+            names[name_tasks.back()] = "Shadows";
+            name_tasks.push_back(std::string{SunShadowDrawTerrainTask::NAME} + " - " + std::to_string(i));
+            names[name_tasks.back()] = "Shadows";
+        }
+
         for(u32 i = 0; i < depth_of_field_mips; i++) {
             name_tasks.push_back(std::string{MipMappingTask::NAME} + " - " + std::to_string(i));
             names[name_tasks.back()] = "Depth Of Field";
         }
 
         for(const auto& name : name_tasks) {
-            context->gpu_metrics[name] = std::make_shared<GPUMetric>(context->gpu_metric_pool.get());
+            context->gpu_metric_pool->create_metric(name);
         }
     }
 
+    names[std::string{CullDrawsTask::NAME}] = "Culling";
+    names[std::string{CullDrawsTask::NAME} + " - late"] = "Culling";
+    names[std::string{GenerateMaxHIZTask::NAME} + " - occlusion"] = "Culling";
     names[std::string{DepthPrepassTask::NAME}] = "Depth Prepass";
+    names[std::string{DepthPrepassTask::NAME} + " - late"] = "Depth Prepass";
     names[std::string{CompositionTask::NAME}] = "Composition";
     names[std::string{ToneMappingTask::NAME}] = "Tone Mapping";
     names[std::string{BlitImageToImageTask::NAME}] = "Depth Of Field";
     names[std::string{DepthOfFieldTask::NAME}] = "Depth Of Field";
-    names[std::string{SunShadowDrawTask::NAME}] = "Shadows";
-    names[std::string{SunShadowDrawTerrainTask::NAME}] = "Shadows";
     names[std::string{DrawTerrainTask::NAME}] = "Rendering G-Buffer";
     names[std::string{GBufferGenerationTask::NAME}] = "Rendering G-Buffer";
     names[std::string{ScreenSpaceReflectionTask::NAME}] = "Screen Space Reflections";
@@ -574,6 +597,7 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
     names[std::string{CopyImageTask::NAME} + " - velocity"] = "Temporal Anti-Aliasing";
     names[std::string{CopyImageTask::NAME} + " - color"] = "Temporal Anti-Aliasing";
 
+    metrics["Culling"] = {};
     metrics[names[std::string{DepthPrepassTask::NAME}]] = {};
     metrics[names[std::string{CompositionTask::NAME}]] = {};
     metrics[names[std::string{ToneMappingTask::NAME}]] = {};
@@ -605,6 +629,8 @@ Renderer::Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<
 }
 
 Renderer::~Renderer() {
+    this->context->device.wait_idle();
+
     for(auto& task_image : images) {
         for(auto image : task_image.get_state().images) {
             context->device.destroy_image(image);
@@ -617,9 +643,13 @@ Renderer::~Renderer() {
         }
     }
 
-    ImGui_ImplGlfw_Shutdown();
-    ImPlot::DestroyContext();
-    ImGui::DestroyContext();
+    draw_list.destroy(context->device);
+
+    if(!context->headless) {
+        ImGui_ImplGlfw_Shutdown();
+        ImPlot::DestroyContext();
+        ImGui::DestroyContext();
+    }
 
     context->device.destroy_sampler(context->shader_global_block.globals.nearest_sampler);
     context->device.destroy_sampler(context->shader_global_block.globals.linear_sampler);
@@ -630,7 +660,217 @@ Renderer::~Renderer() {
     this->context->device.collect_garbage();
 }
 
+auto Renderer::begin_frame() -> bool {
+    PROFILE_SCOPE("Renderer::begin_frame");
+    u64 cpu_timeline_value = {};
+    daxa::TimelineSemaphore gpu_timeline = {};
+    if(context->headless) {
+        cpu_timeline_value = ++headless_timeline_value;
+        headless_signals[0].second = cpu_timeline_value;
+        gpu_timeline = context->headless_timeline;
+    } else {
+        auto image = context->swapchain.acquire_next_image();
+        if(image.is_empty()) { return false; }
+        swapchain_image.set_images({.images = std::span{&image, 1}});
+        cpu_timeline_value = context->swapchain.get_cpu_timeline_value();
+        gpu_timeline = context->swapchain.get_gpu_timeline_semaphore();
+    }
+
+    // the per frame copies of globals, transforms and gpu queries are only safe to overwrite
+    // once the frame that used the same slot frames_in_flight frames ago has retired
+    u64 frames_in_flight = context->frames_in_flight;
+    if(cpu_timeline_value > frames_in_flight) {
+        PROFILE_SCOPE("wait for frame in flight");
+        gpu_timeline.wait_for_value(cpu_timeline_value - frames_in_flight);
+    }
+
+    context->frame_index = cpu_timeline_value % frames_in_flight;
+    context->gpu_metric_pool->begin_frame(static_cast<u32>(context->frame_index));
+    context->model_loader->update();
+    context->geometry_arena->defragment_if_needed();
+    context->upload_service->flush();
+
+    return true;
+}
+
+void Renderer::init_globals(const Camera3D& camera, const glm::vec3& camera_position) {
+    write_camera_globals(camera, camera_position, glm::vec2{0.0f, 0.0f});
+    reset_camera_history();
+    update_sun_cascades(camera);
+}
+
+void Renderer::update_globals(const Camera3D& camera, const glm::vec3& camera_position, f32 delta_time) {
+    auto* globals = &context->shader_global_block.globals;
+
+    glm::vec2 jitter_vec2 = [this]() -> glm::vec2 {
+        glm::vec2 jitter_scale = {1.0f/f32(size_x), 1.0f/f32(size_y)};
+        f32 g = 1.32471795724474602596f;
+        f32 a1 = 1.0f / g;
+        f32 a2 = 1.0f / (g * g);
+
+        glm::vec2 jitter = {
+            glm::mod(0.5f + a1 * (static_cast<f32>(jitter_index) + 1.0f), 1.0f) - 0.5f,
+            glm::mod(0.5f + a2 * (static_cast<f32>(jitter_index) + 1.0f), 1.0f) - 0.5f
+        };
+        jitter = jitter * jitter_scale;
+        jitter_index = (jitter_index + 1) % 32; 
+
+        return jitter;
+    }();
+
+    globals->camera_previous_projection_matrix = globals->camera_projection_matrix;
+    globals->camera_previous_inverse_projection_matrix = globals->camera_inverse_projection_matrix;
+    globals->camera_previous_view_matrix = globals->camera_view_matrix;
+    globals->camera_previous_inverse_view_matrix = globals->camera_inverse_view_matrix;
+    globals->camera_previous_projection_view_matrix = globals->camera_projection_view_matrix;
+    globals->camera_previous_inverse_projection_view_matrix = globals->camera_inverse_projection_view_matrix;
+    globals->terrain_previous_y_clip_trick = globals->terrain_y_clip_trick;
+    globals->previous_jitter = globals->jitter;
+
+    write_camera_globals(camera, camera_position, jitter_vec2);
+
+    // the very first frame has no history, it reprojects onto itself
+    if(globals->frame_counter == 0) {
+        reset_camera_history();
+    }
+
+    globals->delta_time = delta_time;
+    globals->elapsed_time += delta_time;
+    globals->frame_counter++;
+
+    update_sun_cascades(camera);
+    select_lods(camera, camera_position);
+}
+
+void Renderer::write_camera_globals(const Camera3D& camera, const glm::vec3& camera_position, const glm::vec2& jitter) {
+    auto* globals = &context->shader_global_block.globals;
+
+    glm::mat4 projection_matrix = camera.proj_mat;
+    projection_matrix[3][0] += jitter.x;
+    projection_matrix[3][1] += jitter.y;
+    
+    glm::mat4 inverse_projection_matrix = glm::inverse(projection_matrix);
+    glm::mat4 inverse_view_matrix = glm::inverse(camera.view_mat);
+    glm::mat4 projection_view_matrix = projection_matrix * camera.view_mat;
+    glm::mat4 inverse_projection_view = inverse_projection_matrix * inverse_view_matrix;
+    glm::vec4 terrain_y_clip_trick = projection_view_matrix * glm::vec4{0.0f, 1.0f, 0.0f, 0.0f};
+
+    globals->camera_projection_matrix = *reinterpret_cast<f32mat4x4*>(&projection_matrix);
+    globals->camera_inverse_projection_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_projection_matrix);
+    globals->camera_view_matrix = *reinterpret_cast<const f32mat4x4*>(&camera.view_mat);
+    globals->camera_inverse_view_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_view_matrix);
+    globals->camera_projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&projection_view_matrix);
+    globals->camera_inverse_projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&inverse_projection_view);
+    globals->terrain_y_clip_trick = *reinterpret_cast<f32vec4*>(&terrain_y_clip_trick);
+    globals->jitter = *reinterpret_cast<const f32vec2*>(&jitter);
+
+    globals->camera_near_clip = camera.near_clip;
+    globals->camera_far_clip = camera.far_clip;
+    globals->resolution = { static_cast<i32>(size_x), static_cast<i32>(size_y) };
+    globals->camera_position = *reinterpret_cast<const f32vec3*>(&camera_position);
+}
+
+void Renderer::reset_camera_history() {
+    auto* globals = &context->shader_global_block.globals;
+    globals->camera_previous_projection_matrix = globals->camera_projection_matrix;
+    globals->camera_previous_inverse_projection_matrix = globals->camera_inverse_projection_matrix;
+    globals->camera_previous_view_matrix = globals->camera_view_matrix;
+    globals->camera_previous_inverse_view_matrix = globals->camera_inverse_view_matrix;
+    globals->camera_previous_projection_view_matrix = globals->camera_projection_view_matrix;
+    globals->camera_previous_inverse_projection_view_matrix = globals->camera_inverse_projection_view_matrix;
+    globals->terrain_previous_y_clip_trick = globals->terrain_y_clip_trick;
+    globals->previous_jitter = globals->jitter;
+}
+
+void Renderer::update_sun_cascades(const Camera3D& camera) {
+    auto* globals = &context->shader_global_block.globals;
+
+    glm::vec3 dir = { 0.0f, -1.0f, 0.0f };
+    dir = glm::rotateX(dir, glm::radians(angle_direction.x));
+    dir = glm::rotateY(dir, glm::radians(angle_direction.y));
+    dir = glm::rotateZ(dir, glm::radians(angle_direction.z));
+    dir = glm::normalize(dir);
+
+    glm::mat4 sun_view = get_sun_view(dir);
+    auto cascades = fit_shadow_cascades(camera.view_mat, sun_view, ShadowCascadeSettings {
+        .fov = camera.fov,
+        .aspect = static_cast<f32>(size_x) / static_cast<f32>(size_y),
+        .near_clip = camera.near_clip,
+        .shadow_distance = std::min(shadow_distance, camera.far_clip),
+        .split_lambda = cascade_split_lambda,
+        .resolution = sun_shadow_resolution / SUN_CASCADE_ATLAS_WIDTH,
+        .caster_distance = shadow_caster_distance,
+    });
+
+    globals->sun_info.view_matrix = *reinterpret_cast<f32mat4x4*>(&sun_view);
+    globals->sun_info.direction = *reinterpret_cast<f32vec3*>(&dir);
+    for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+        glm::vec4 terrain_y_clip_trick = cascades[i].projection_view * glm::vec4{0.0f, 1.0f, 0.0f, 0.0f};
+        globals->sun_info.cascades[i] = SunCascade {
+            .projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&cascades[i].projection_view),
+            .terrain_y_clip_trick = *reinterpret_cast<f32vec4*>(&terrain_y_clip_trick),
+            .far_distance = cascades[i].far_distance,
+            .depth_range = cascades[i].depth_range,
+        };
+    }
+}
+
+void Renderer::select_lods(const Camera3D& camera, const glm::vec3& camera_position) {
+    // size of one pixel at a distance of one unit
+    f32 pixel_size = 2.0f * std::tan(glm::radians(camera.fov) * 0.5f) / static_cast<f32>(size_y);
+
+    scene_hiearchy_panel->scene->iterate([&](Entity entity){
+        if(!entity.has_component<MeshComponent>() || !entity.has_component<TransformComponent>()) { return; }
+        auto& mesh = entity.get_component<MeshComponent>();
+        if(!mesh.model || !mesh.model->is_ready()) { return; }
+
+        const glm::mat4& model_matrix = entity.get_component<TransformComponent>().model_matrix;
+        f32 scale = std::max({glm::length(glm::vec3{model_matrix[0]}), glm::length(glm::vec3{model_matrix[1]}), glm::length(glm::vec3{model_matrix[2]})});
+        if(scale <= 0.0f) { return; }
+
+        mesh.lods.resize(mesh.model->primitives.size());
+        mesh.shadow_lods.resize(mesh.model->primitives.size());
+        for(usize i = 0; i < mesh.model->primitives.size(); i++) {
+            const auto& primitive = mesh.model->primitives[i];
+            if(primitive.lod_count == 0) {
+                mesh.lods[i] = 0;
+                mesh.shadow_lods[i] = 0;
+                continue;
+            }
+
+            // the bounding sphere of the primitive bounds, distances inside it use the full detail
+            glm::vec3 extent = *reinterpret_cast<const glm::vec3*>(&primitive.position_scale);
+            glm::vec3 center = *reinterpret_cast<const glm::vec3*>(&primitive.position_min) + extent * 0.5f;
+            center = glm::vec3{model_matrix * glm::vec4{center, 1.0f}};
+            f32 distance = std::max(glm::distance(center, camera_position) - glm::length(extent) * 0.5f * scale, camera.near_clip);
+
+            // errors are stored in model space
+            f32 max_error = lod_pixel_error * pixel_size * distance / scale;
+            mesh.lods[i] = mesh.model->select_lod(primitive, max_error);
+            mesh.shadow_lods[i] = mesh.model->select_lod(primitive, max_error * shadow_lod_bias);
+        }
+    });
+}
+
+void Renderer::begin_occlusion_culling(const Camera3D& camera, const glm::vec3& camera_position) {
+    if(!cpu_occlusion_culling) { return; }
+    draw_list.begin_occlusion(scene_hiearchy_panel->scene.get(), camera.proj_mat * camera.view_mat, camera_position, static_cast<f32>(size_x) / static_cast<f32>(size_y), occlusion_pool);
+}
+
+void Renderer::cull_draws() {
+    PROFILE_SCOPE("Renderer::cull_draws");
+    const auto& globals = context->shader_global_block.globals;
+    draw_list.gather(scene_hiearchy_panel->scene.get());
+    std::array<glm::mat4, SUN_CASCADE_COUNT> sun_projection_views = {};
+    for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+        sun_projection_views[i] = *reinterpret_cast<const glm::mat4*>(&globals.sun_info.cascades[i].projection_view_matrix);
+    }
+    draw_list.cull(*reinterpret_cast<const glm::mat4*>(&globals.camera_projection_view_matrix), sun_projection_views);
+    draw_list.upload(context);
+}
+
 void Renderer::render() {
+    PROFILE_SCOPE("Renderer::render");
     auto reloaded_result = context->pipeline_manager.reload_all();
     if (auto reload_err = std::get_if<daxa::PipelineReloadError>(&reloaded_result)) {
         std::cout << "Failed to reload " << reload_err->message << '\n';
@@ -639,12 +879,6 @@ void Renderer::render() {
         std::cout << "Successfully reloaded!\n";
     }
 
-    auto image = context->swapchain.acquire_next_image();
-    if(image.is_empty()) { return; }
-    swapchain_image.set_images({.images = std::span{&image, 1}});
-
-    context->frame_index = (context->swapchain.get_cpu_timeline_value()) % (context->swapchain.info().max_allowed_frames_in_flight);
-
     u8* mapped_ptr = reinterpret_cast<u8*>(context->device.get_host_address(context->shader_globals_buffer));
     auto* ptr = reinterpret_cast<ShaderGlobalsBlock*>(mapped_ptr + ((static_cast<i32>(sizeof(ShaderGlobalsBlock)) + 256 - 1) / 256) * 256 * context->frame_index);
     *ptr = this->context->shader_global_block;
@@ -656,6 +890,28 @@ void Renderer::render() {
         .offset = ((static_cast<i32>(sizeof(ShaderGlobalsBlock)) + 256 - 1) / 256) * 256 * context->frame_index,
     };
 
+    if(!context->headless) {
+        draw_ui();
+    }
+
+    // after the ui, which can remove entities or move the sun
+    cull_draws();
+
+    {
+        PROFILE_SCOPE("task graph execute");
+        render_task_graph.execute({});
+    }
+    context->gpu_metric_pool->end_frame();
+
+    // resources destroyed during the frame are zombies until the gpu timeline passes them
+    {
+        PROFILE_SCOPE("collect garbage");
+        context->device.collect_garbage();
+    }
+}
+
+void Renderer::draw_ui() {
+    PROFILE_SCOPE("Renderer::draw_ui");
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
@@ -698,29 +954,19 @@ void Renderer::render() {
         GUI::f32_property("darkening factor", globals->sun_info.darkening_factor);
         GUI::f32_property("shadow bias", globals->sun_info.bias);
         GUI::f32_property("intensity", globals->sun_info.intensity);
-        bool changed = GUI::vec3_property("position", *reinterpret_cast<glm::vec3*>(&globals->sun_info.position), nullptr);
-        changed |= GUI::vec3_property("direction", angle_direction, nullptr);
-
-        glm::vec3 dir = { 0.0f, -1.0f, 0.0f };
-        dir = glm::rotateX(dir, glm::radians(angle_direction.x));
-        dir = glm::rotateY(dir, glm::radians(angle_direction.y));
-        dir = glm::rotateZ(dir, glm::radians(angle_direction.z));
-
-        GUI::vec3_property("normalized direction", dir, nullptr);
-
-        if(changed) {
-            glm::vec3 position = *reinterpret_cast<glm::vec3*>(&globals->sun_info.position);
-            glm::mat4 view = glm::lookAt(position, position + dir, glm::vec3(0.0, -1.0, 0.0));
-            globals->sun_info.view_matrix = *reinterpret_cast<f32mat4x4*>(&view);
+        GUI::f32_property("shadow distance", shadow_distance);
+        GUI::f32_property("cascade split lambda", cascade_split_lambda);
+        GUI::vec3_property("direction", angle_direction, nullptr);
+        GUI::vec3_property("normalized direction", *reinterpret_cast<glm::vec3*>(&globals->sun_info.direction), nullptr);
+    });
 
-            glm::mat4 projection_matrix = *reinterpret_cast<glm::mat4*>(&globals->sun_info.projection_matrix);
-            glm::vec4 terrain_y_clip_trick = projection_matrix * glm::vec4{0.0f, 1.0f, 0.0f, 0.0f};
-            glm::mat4 projection_view_matrix = projection_matrix * view;
+    settings_ui("lod settings", [&](){
+        GUI::f32_property("pixel error", lod_pixel_error);
+        GUI::f32_property("shadow bias", shadow_lod_bias);
+    });
 
-            globals->sun_info.projection_view_matrix = *reinterpret_cast<f32mat4x4*>(&projection_view_matrix);
-            globals->sun_info.terrain_y_clip_trick = *reinterpret_cast<f32vec4*>(&terrain_y_clip_trick);
-            globals->sun_info.direction = *reinterpret_cast<f32vec3*>(&dir);
-        }
+    settings_ui("culling settings", [&](){
+        GUI::bool_property("cpu occlusion", cpu_occlusion_culling);
     });
 
     settings_ui("ssao settings", [&](){
@@ -768,9 +1014,9 @@ void Renderer::render() {
 
     ImGui::Begin("GPU Metric");
     f64 total_time = 0.0;
-    for(auto& [key, metric] : context->gpu_metrics) {
-        total_time += metric->time_elapsed;
-        ImGui::Text("%s : %f ms", key.data(), metric->time_elapsed);
+    for(auto& metric : context->gpu_metric_pool->metrics) {
+        total_time += metric.time_elapsed;
+        ImGui::Text("%s : %f ms", metric.name.data(), metric.time_elapsed);
     }
 
     ImGui::Separator();
@@ -788,10 +1034,10 @@ void Renderer::render() {
             value.push(0.0f);
         }
 
-        for(auto& [key_metric, value_metric] : context->gpu_metrics) {
-            if(auto name = names.find(key_metric); name != names.end()) {
+        for(auto& metric : context->gpu_metric_pool->metrics) {
+            if(auto name = names.find(metric.name); name != names.end()) {
                 if(auto stat = metrics.find(name->second); stat != metrics.end()) {
-                    stat->second.get_current() += static_cast<f32>(value_metric->time_elapsed);
+                    stat->second.get_current() += static_cast<f32>(metric.time_elapsed);
                 }
             }
         }
@@ -806,18 +1052,18 @@ void Renderer::render() {
     ImGui::End();
 
     ImGui::Render();
-
-    render_task_graph.execute({});
-    context->device.wait_idle();
 }
 
 void Renderer::window_resized() {
     context->swapchain.resize();
+    size_x = window->get_width();
+    size_y = window->get_height();
 
     recreate_framebuffer();
 }
 
 void Renderer::recreate_framebuffer() {
+    PROFILE_SCOPE("Renderer::recreate_framebuffer");
     for (auto &[info, timg] : frame_buffer_images) {
         if (!timg.get_state().images.empty() && !timg.get_state().images[0].is_empty()) {
             context->device.destroy_image(timg.get_state().images[0]);
@@ -825,15 +1071,15 @@ void Renderer::recreate_framebuffer() {
 
         auto new_info = info;
         if(info.name.substr(0, 4) == "ssao") {
-            new_info.size = {this->window->get_width() / 2, this->window->get_height() / 2, 1};
+            new_info.size = {size_x / 2, size_y / 2, 1};
         } else if(info.name.substr(0, 5) == "clouds") {
-            new_info.size = {this->window->get_width() / 2, this->window->get_height() / 2, 1};
+            new_info.size = {size_x / 2, size_y / 2, 1};
         } else {
-            new_info.size = {this->window->get_width(), this->window->get_height(), 1};
+            new_info.size = {size_x, size_y, 1};
         }
 
         if(info.name == "depth of field image") {
-            depth_of_field_mips = static_cast<u32>(std::floor(std::log2(std::max(window->get_width(), window->get_height())))) + 1;
+            depth_of_field_mips = static_cast<u32>(std::floor(std::log2(std::max(size_x, size_y)))) + 1;
             new_info.mip_level_count = depth_of_field_mips;
 
             context->device.destroy_sampler(context->shader_global_block.globals.depth_of_field_sampler);
@@ -859,7 +1105,7 @@ void Renderer::recreate_framebuffer() {
         timg.set_images({.images = std::array{this->context->device.create_image(new_info)}});
     }
 
-    glm::uvec2 mip_size = { window->get_width(), window->get_height() };
+    glm::uvec2 mip_size = { size_x, size_y };
     for(usize i = 0; i < mip_chain_length; i++) {
         if (!bloom_mip_chain[i].get_state().images.empty() && !bloom_mip_chain[i].get_state().images[0].is_empty()) {
             context->device.destroy_image(bloom_mip_chain[i].get_state().images[0]);
@@ -900,8 +1146,8 @@ void Renderer::compile_pipelines() {
     };
 
     for (auto [name, info] : rasters) {
-        if(name == DisplayAttachmentTask::NAME) { info.color_attachments = {{ .format = context->swapchain.get_format() }}; }
-        if(name == ToneMappingTask::NAME) { info.color_attachments = {{ .format = context->swapchain.get_format() }}; }
+        if(name == DisplayAttachmentTask::NAME) { info.color_attachments = {{ .format = context->output_format }}; }
+        if(name == ToneMappingTask::NAME) { info.color_attachments = {{ .format = context->output_format }}; }
         //if(name == CompositionTask::NAME) { info.color_attachments = {{ .format = context->swapchain.get_format() }}; }
 
         auto compilation_result = this->context->pipeline_manager.add_raster_pipeline(info);
@@ -910,6 +1156,7 @@ void Renderer::compile_pipelines() {
     }
 
     std::vector<std::tuple<std::string_view, daxa::ComputePipelineCompileInfo>> computes = {
+        {CullDrawsTask::NAME, CullDrawsTask::PIPELINE_COMPILE_INFO},
         {HeightToNormalTask::NAME, HeightToNormalTask::PIPELINE_COMPILE_INFO},
         {CloudRenderingTask::NAME, CloudRenderingTask::PIPELINE_COMPILE_INFO},
         {GenerateMinHIZTask::NAME, GenerateMinHIZTask::PIPELINE_COMPILE_INFO},
@@ -927,11 +1174,12 @@ void Renderer::compile_pipelines() {
 }
 
 void Renderer::rebuild_task_graph() {
-    auto scene = scene_hiearchy_panel->scene;
+    PROFILE_SCOPE("Renderer::rebuild_task_graph");
+    auto metric = [&](const std::string& name) -> GPUMetricHandle { return context->gpu_metric_pool->get_metric(name); };
 
     render_task_graph = daxa::TaskGraph({
         .device = context->device,
-        .swapchain = context->swapchain,
+        .swapchain = context->headless ? std::optional<daxa::Swapchain>{} : std::optional<daxa::Swapchain>{context->swapchain},
         .name = "render task graph",
     });
 
@@ -957,40 +1205,74 @@ void Renderer::rebuild_task_graph() {
     render_task_graph.use_persistent_buffer(terrain_vertices);
     render_task_graph.use_persistent_buffer(terrain_indices);
     render_task_graph.use_persistent_buffer(auto_exposure_buffer);
+    render_task_graph.use_persistent_buffer(draw_list.camera_draws);
+    render_task_graph.use_persistent_buffer(draw_list.late_draws);
+    for(auto& sun_draws : draw_list.sun_draws) {
+        render_task_graph.use_persistent_buffer(sun_draws);
+    }
+    render_task_graph.use_persistent_buffer(draw_list.visibility);
 
     for(auto& mip : bloom_mip_chain) {
         render_task_graph.use_persistent_image(mip);
     }
 
+    // two phase occlusion culling, what was visible last frame is drawn first and the depth it leaves behind is used
+    // to test everything else, the late pass then adds what turned out to be visible
+    CullDrawsTask::build(context, render_task_graph, &draw_list);
+
     render_task_graph.add_task(DepthPrepassTask {
         .uses = {
-            .u_depth_image = depth_image
+            .u_depth_image = depth_image,
+            .u_draws = draw_list.camera_draws,
         },
         .context = context,
-        .scene = scene.get()
+        .gpu_metric = metric(std::string{DepthPrepassTask::NAME}),
+        .draw_list = &draw_list
     });
 
-    min_hiz_image = GenerateMinHIZTask::build(context, render_task_graph, depth_image);
-    max_hiz_image = GenerateMaxHIZTask::build(context, render_task_graph, depth_image);
+    daxa::TaskImageView occlusion_hiz = GenerateMaxHIZTask::build(context, render_task_graph, depth_image, std::string{GenerateMaxHIZTask::NAME} + " - occlusion");
+    CullDrawsTask::build_late(context, render_task_graph, &draw_list, occlusion_hiz);
 
-    render_task_graph.add_task(SunShadowDrawTask {
+    render_task_graph.add_task(DepthPrepassTask {
         .uses = {
-            .u_depth_image = sun_shadow_image
+            .u_depth_image = depth_image,
+            .u_draws = draw_list.late_draws,
         },
         .context = context,
-        .scene = scene.get()
+        .gpu_metric = metric(std::string{DepthPrepassTask::NAME} + " - late"),
+        .draw_list = &draw_list,
+        .load_op = daxa::AttachmentLoadOp::LOAD
     });
 
-    render_task_graph.add_task(SunShadowDrawTerrainTask {
-        .uses = {
-            .u_vertices = terrain_vertices,
-            .u_indices = terrain_indices,
-            .u_depth_image = sun_shadow_image
-        },
-        .context = context,
-        .terrain_index_size = terrain_index_size,
-        .terrain_heightmap = terrain_heightmap.get(),
-    });
+    min_hiz_image = GenerateMinHIZTask::build(context, render_task_graph, depth_image);
+    max_hiz_image = GenerateMaxHIZTask::build(context, render_task_graph, depth_image);
+
+    // every cascade renders into its own tile of the atlas
+    for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+        render_task_graph.add_task(SunShadowDrawTask {
+            .uses = {
+                .u_depth_image = sun_shadow_image,
+                .u_draws = draw_list.sun_draws[i],
+            },
+            .context = context,
+            .gpu_metric = metric(std::string{SunShadowDrawTask::NAME} + " - " + std::to_string(i)),
+            .draw_list = &draw_list,
+            .cascade = i
+        });
+
+        render_task_graph.add_task(SunShadowDrawTerrainTask {
+            .uses = {
+                .u_vertices = terrain_vertices,
+                .u_indices = terrain_indices,
+                .u_depth_image = sun_shadow_image
+            },
+            .context = context,
+            .gpu_metric = metric(std::string{SunShadowDrawTerrainTask::NAME} + " - " + std::to_string(i)),
+            .terrain_index_size = terrain_index_size,
+            .terrain_heightmap = terrain_heightmap.get(),
+            .cascade = i
+        });
+    }
 
     render_task_graph.add_task(GBufferGenerationTask {
         .uses = {
@@ -1000,9 +1282,12 @@ void Renderer::rebuild_task_graph() {
             .u_metallic_roughness_image = metallic_roughness_image,
             .u_velocity_image = velocity_image,
             .u_depth_image = depth_image,
+            .u_draws = draw_list.camera_draws,
+            .u_late_draws = draw_list.late_draws,
         },
         .context = context,
-        .scene = scene.get()
+        .gpu_metric = metric(std::string{GBufferGenerationTask::NAME}),
+        .draw_list = &draw_list
     });
 
     render_task_graph.add_task(DrawTerrainTask {
@@ -1016,6 +1301,7 @@ void Renderer::rebuild_task_graph() {
             .u_depth_image = depth_image
         },
         .context = context,
+        .gpu_metric = metric(std::string{DrawTerrainTask::NAME}),
         .terrain_index_size = terrain_index_size,
         .terrain_heightmap = terrain_heightmap.get(),
         .terrain_albedomap = terrain_albedomap.get(),
@@ -1027,7 +1313,7 @@ void Renderer::rebuild_task_graph() {
             .u_lower_mip = bloom_mip_chain[0]
         },
         .context = context,
-        .index = 0
+        .gpu_metric = metric(std::string{BloomDownsampleTask::NAME} + " - 0")
     });
 
     for(u32 i = 0; i < mip_chain_length - 1; i++) {
@@ -1037,7 +1323,7 @@ void Renderer::rebuild_task_graph() {
                 .u_lower_mip = bloom_mip_chain[i + 1]
             },
             .context = context,
-            .index = i + 1
+            .gpu_metric = metric(std::string{BloomDownsampleTask::NAME} + " - " + std::to_string(i + 1))
         });
     }
 
@@ -1048,7 +1334,7 @@ void Renderer::rebuild_task_graph() {
                 .u_lower_mip = bloom_mip_chain[i]
             },
             .context = context,
-            .index = i
+            .gpu_metric = metric(std::string{BloomUpsampleTask::NAME} + " - " + std::to_string(i))
         });
     }
 
@@ -1058,7 +1344,7 @@ void Renderer::rebuild_task_graph() {
             .u_lower_mip = bloom_mip_chain[0]
         },
         .context = context,
-        .index = 0
+        .gpu_metric = metric(std::string{BloomUpsampleTask::NAME} + " - 0")
     });
 
     render_task_graph.add_task(SSAOGenerationTask {
@@ -1068,6 +1354,7 @@ void Renderer::rebuild_task_graph() {
             .u_depth_image = depth_image
         },
         .context = context,
+        .gpu_metric = metric(std::string{SSAOGenerationTask::NAME}),
     });
 
     render_task_graph.add_task(SSAOBlurTask {
@@ -1076,6 +1363,7 @@ void Renderer::rebuild_task_graph() {
             .u_ssao_image = ssao_image
         },
         .context = context,
+        .gpu_metric = metric(std::string{SSAOBlurTask::NAME}),
     });
 
     render_task_graph.add_task(ScreenSpaceReflectionTask {
@@ -1088,7 +1376,8 @@ void Renderer::rebuild_task_graph() {
             .u_min_hiz = min_hiz_image,
             .u_max_hiz = max_hiz_image
         },
-        .context = context
+        .context = context,
+        .gpu_metric = metric(std::string{ScreenSpaceReflectionTask::NAME})
     });
 
     render_task_graph.add_task(CloudRenderingTask {
@@ -1097,6 +1386,7 @@ void Renderer::rebuild_task_graph() {
             .u_depth_image = depth_image
         },
         .context = context,
+        .gpu_metric = metric(std::string{CloudRenderingTask::NAME}),
         .noise_texture = noise_texture.get()
     });
 
@@ -1114,6 +1404,7 @@ void Renderer::rebuild_task_graph() {
             .u_clouds_image = clouds_image
         },
         .context = context,
+        .gpu_metric = metric(std::string{CompositionTask::NAME}),
     });
 
     // render_task_graph.add_task(BlitImageToImageTask {
@@ -1121,7 +1412,8 @@ void Renderer::rebuild_task_graph() {
     //         .u_target_image = depth_of_field_image.view().view({.base_mip_level = 0}),
     //         .u_color_image = color_image,
     //     },
-    //     .context = context
+    //     .context = context,
+    //     .gpu_metric = metric(std::string{BlitImageToImageTask::NAME})
     // });
 
     // {
@@ -1135,6 +1427,7 @@ void Renderer::rebuild_task_graph() {
     //                 .u_lower_mip = depth_of_field_image.view().view({.base_mip_level = i}),
     //             },
     //             .context = context,
+    //             .gpu_metric = metric(std::string{MipMappingTask::NAME} + " - " + std::to_string(i)),
     //             .mip = i,
     //             .mip_size = mip_size,
     //             .next_mip_size = next_mip_size,
@@ -1149,7 +1442,8 @@ void Renderer::rebuild_task_graph() {
     //         .u_depth_image = depth_image,
     //         .u_color_image = depth_of_field_image
     //     },
-    //     .context = context
+    //     .context = context,
+    //     .gpu_metric = metric(std::string{DepthOfFieldTask::NAME})
     // });
 
     render_task_graph.add_task(GenerateLuminanceHistogramTask {
@@ -1157,14 +1451,16 @@ void Renderer::rebuild_task_graph() {
             .u_hdr_image = color_image,
             .u_auto_exposure_buffer = auto_exposure_buffer
         },
-        .context = context
+        .context = context,
+        .gpu_metric = metric(std::string{GenerateLuminanceHistogramTask::NAME})
     });
 
     render_task_graph.add_task(ResolveLuminanceHistogramTask {
         .uses = {
             .u_auto_exposure_buffer = auto_exposure_buffer
         },
-        .context = context
+        .context = context,
+        .gpu_metric = metric(std::string{ResolveLuminanceHistogramTask::NAME})
     });
 
     render_task_graph.add_task(TemporalAntiAliasingTask {
@@ -1176,7 +1472,8 @@ void Renderer::rebuild_task_graph() {
             .u_previous_velocity_image = previous_velocity_image,
             .u_depth_image = depth_image
         },
-        .context = context
+        .context = context,
+        .gpu_metric = metric(std::string{TemporalAntiAliasingTask::NAME})
     });
 
     render_task_graph.add_task(CopyImageTask {
@@ -1185,7 +1482,7 @@ void Renderer::rebuild_task_graph() {
             .u_current_image = resolved_image
         },
         .context = context,
-        .type = "velocity"
+        .gpu_metric = metric(std::string{CopyImageTask::NAME} + " - velocity")
     });
 
     render_task_graph.add_task(CopyImageTask {
@@ -1194,7 +1491,7 @@ void Renderer::rebuild_task_graph() {
             .u_current_image = velocity_image
         },
         .context = context,
-        .type = "color"
+        .gpu_metric = metric(std::string{CopyImageTask::NAME} + " - color")
     });
 
     // render_task_graph.add_task(DisplayAttachmentTask {
@@ -1204,7 +1501,8 @@ void Renderer::rebuild_task_graph() {
     //         .u_displayed_image_2 = emissive_image,
     //         .u_displayed_image_3 = normal_image
     //     },
-    //     .context = context
+    //     .context = context,
+    //     .gpu_metric = metric(std::string{DisplayAttachmentTask::NAME})
     // });
 
     render_task_graph.add_task(ToneMappingTask {
@@ -1213,9 +1511,17 @@ void Renderer::rebuild_task_graph() {
             .u_color_image = resolved_image,
             .u_auto_exposure_buffer = auto_exposure_buffer
         },
-        .context = context
+        .context = context,
+        .gpu_metric = metric(std::string{ToneMappingTask::NAME})
     });
 
+    if(context->headless) {
+        headless_signals = { { context->headless_timeline, 0 } };
+        render_task_graph.submit({ .additional_signal_timeline_semaphores = &headless_signals });
+        render_task_graph.complete({});
+        return;
+    }
+
     render_task_graph.add_task({
         .uses = {
             daxa::ImageColorAttachment<>{swapchain_image},
@@ -10,13 +10,32 @@
 #include "ecs/entity.hpp"
 #include "ecs/components.hpp"
 #include "ui/editor/scene_hiearchy_panel.hpp"
+#include "draw_list.hpp"
 #include "utils/scrolling_buffer.hpp"
+#include "utils/threadpool.hpp"
 
 struct Renderer {
     Renderer(AppWindow* _window, Context* _context, const std::shared_ptr<Scene>& scene);
+    // headless, renders into an offscreen output image of the given size
+    Renderer(u32 _size_x, u32 _size_y, Context* _context, const std::shared_ptr<Scene>& scene);
     ~Renderer();
 
+    auto begin_frame() -> bool;
+    // camera globals for before the first frame, unlike update_globals it leaves the jitter sequence, the frame counter
+    // and the elapsed time alone
+    void init_globals(const Camera3D& camera, const glm::vec3& camera_position);
+    void update_globals(const Camera3D& camera, const glm::vec3& camera_position, f32 delta_time);
+    // fits the sun shadow cascades around the slices of the camera frustum, called by update_globals
+    void update_sun_cascades(const Camera3D& camera);
+    // picks the lod of every primitive so its simplification error stays below lod_pixel_error pixels on screen
+    void select_lods(const Camera3D& camera, const glm::vec3& camera_position);
+    // starts rasterizing the occluders for the cpu occlusion culling, call it before the scene updates so both overlap
+    void begin_occlusion_culling(const Camera3D& camera, const glm::vec3& camera_position);
+    // gathers the primitives of the scene, culls them against the camera and sun cascade frustums of this frame and
+    // uploads the survivors for CullDrawsTask, which splits them into the indirect draws of every view on the gpu
+    void cull_draws();
     void render();
+    void draw_ui();
     void window_resized();
 
     void recreate_framebuffer();
@@ -25,6 +44,12 @@ struct Renderer {
 
     AppWindow* window = {};
     Context* context = {};
+    u32 size_x = {};
+    u32 size_y = {};
+    u32 jitter_index = 0;
+
+    u64 headless_timeline_value = 0;
+    std::vector<std::pair<daxa::TimelineSemaphore, u64>> headless_signals = {};
 
     std::shared_ptr<SceneHiearchyPanel> scene_hiearchy_panel;
 
@@ -63,20 +88,43 @@ struct Renderer {
     std::unique_ptr<Texture> terrain_albedomap = {};
     daxa::TaskImage terrain_normalmap_task = {};
 
+    // atlas of SUN_CASCADE_ATLAS_WIDTH by SUN_CASCADE_ATLAS_HEIGHT cascade tiles
     daxa::TaskImage sun_shadow_image = {};
+    u32 sun_shadow_resolution = 4096;
     glm::vec3 angle_direction = { 4.0, 0.0f, 0.0f };
+    // camera depth the last cascade reaches
+    f32 shadow_distance = 150.0f;
+    // 0 splits the cascades evenly, 1 logarithmically
+    f32 cascade_split_lambda = 0.75f;
+    // casters this far towards the sun outside of a cascade still throw their shadow into it
+    f32 shadow_caster_distance = 50.0f;
 
     u32 terrain_index_size = {};
 
+    f32 lod_pixel_error = 1.0f;
+    // shadow map texels cover far more than a pixel, so the shadow pass tolerates a larger error
+    f32 shadow_lod_bias = 4.0f;
+    // occlusion culls the camera view on the cpu as well, for when the gpu culling cant be relied on
+    bool cpu_occlusion_culling = false;
+
     daxa::TaskBuffer auto_exposure_buffer = {};
 
     std::vector<daxa::TaskBuffer> buffers = {};
 
     daxa::TaskGraph render_task_graph = {};
+    DrawList draw_list = {};
+    ThreadPool occlusion_pool = {};
 
     daxa::ImGuiRenderer imgui_renderer = {};
 
     ScrollingBuffer<f32> accumulated_time = {};
     std::unordered_map<std::string, std::string> names = {};
     std::unordered_map<std::string, ScrollingBuffer<f32>> metrics = {};
+
+private:
+    Renderer(AppWindow* _window, u32 _size_x, u32 _size_y, Context* _context, const std::shared_ptr<Scene>& scene);
+
+    void write_camera_globals(const Camera3D& camera, const glm::vec3& camera_position, const glm::vec2& jitter);
+    // previous frame camera equal to the current one, for frames without a history
+    void reset_camera_history();
 };
@@ -0,0 +1,46 @@
+#include "sampler_cache.hpp"
+
+namespace {
+    // the name is only a debug label, samplers that differ in nothing else are the same sampler
+    auto is_same_sampler(const daxa::SamplerInfo& a, const daxa::SamplerInfo& b) -> bool {
+        return a.magnification_filter == b.magnification_filter &&
+            a.minification_filter == b.minification_filter &&
+            a.mipmap_filter == b.mipmap_filter &&
+            a.address_mode_u == b.address_mode_u &&
+            a.address_mode_v == b.address_mode_v &&
+            a.address_mode_w == b.address_mode_w &&
+            a.mip_lod_bias == b.mip_lod_bias &&
+            a.enable_anisotropy == b.enable_anisotropy &&
+            a.max_anisotropy == b.max_anisotropy &&
+            a.enable_compare == b.enable_compare &&
+            a.compare_op == b.compare_op &&
+            a.min_lod == b.min_lod &&
+            a.max_lod == b.max_lod &&
+            a.border_color == b.border_color &&
+            a.enable_unnormalized_coordinates == b.enable_unnormalized_coordinates;
+    }
+}
+
+SamplerCache::SamplerCache(daxa::Device _device) : device{_device} {}
+
+SamplerCache::~SamplerCache() {
+    for(auto& [info, sampler_id] : samplers) {
+        device.destroy_sampler(sampler_id);
+    }
+}
+
+auto SamplerCache::get(const daxa::SamplerInfo& info) -> daxa::SamplerId {
+    std::lock_guard lock{mutex};
+    for(const auto& [cached_info, sampler_id] : samplers) {
+        if(is_same_sampler(cached_info, info)) { return sampler_id; }
+    }
+
+    daxa::SamplerId sampler_id = device.create_sampler(info);
+    samplers.emplace_back(info, sampler_id);
+    return sampler_id;
+}
+
+auto SamplerCache::get_sampler_count() const -> usize {
+    std::lock_guard lock{mutex};
+    return samplers.size();
+}
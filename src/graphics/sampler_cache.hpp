@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include <mutex>
+
+// hands out one sampler per distinct sampler info, every texture with the same settings shares a descriptor slot.
+// samplers live as long as the cache, thread safe
+struct SamplerCache {
+    SamplerCache(daxa::Device _device);
+    ~SamplerCache();
+
+    SamplerCache(const SamplerCache&) = delete;
+    auto operator=(const SamplerCache&) -> SamplerCache& = delete;
+
+    auto get(const daxa::SamplerInfo& info) -> daxa::SamplerId;
+
+    [[nodiscard]] auto get_sampler_count() const -> usize;
+
+private:
+    daxa::Device device = {};
+    mutable std::mutex mutex = {};
+    // there are only a handful of distinct samplers, so a linear search beats hashing the info
+    std::vector<std::pair<daxa::SamplerInfo, daxa::SamplerId>> samplers = {};
+};
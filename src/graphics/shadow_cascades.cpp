@@ -0,0 +1,63 @@
+#include "shadow_cascades.hpp"
+
+auto get_sun_view(const glm::vec3& direction) -> glm::mat4 {
+    glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3{0.0f, 0.0f, 1.0f} : glm::vec3{0.0f, 1.0f, 0.0f};
+    return glm::lookAt(glm::vec3{0.0f}, direction, up);
+}
+
+auto fit_shadow_cascades(const glm::mat4& camera_view, const glm::mat4& sun_view, const ShadowCascadeSettings& settings) -> std::array<ShadowCascade, SUN_CASCADE_COUNT> {
+    std::array<ShadowCascade, SUN_CASCADE_COUNT> cascades = {};
+    glm::mat4 inverse_camera_view = glm::inverse(camera_view);
+
+    f32 tan_half_fov = std::tan(glm::radians(settings.fov) * 0.5f);
+    // squared distance from the view axis to a frustum corner at a depth of one
+    f32 corner_slope = tan_half_fov * tan_half_fov * (1.0f + settings.aspect * settings.aspect);
+    f32 near_clip = std::max(settings.near_clip, 0.001f);
+    f32 far_clip = std::max(settings.shadow_distance, near_clip * 2.0f);
+
+    f32 split_near = near_clip;
+    for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+        // practical split scheme, a blend of the logarithmic and the uniform split
+        f32 fraction = static_cast<f32>(i + 1) / static_cast<f32>(SUN_CASCADE_COUNT);
+        f32 logarithmic = near_clip * std::pow(far_clip / near_clip, fraction);
+        f32 uniform = near_clip + (far_clip - near_clip) * fraction;
+        f32 split_far = glm::mix(uniform, logarithmic, settings.split_lambda);
+
+        // the point on the view axis as far from the near corners as from the far ones, wide slices put it past the
+        // far plane and then the far corners alone bound the slice
+        f32 center_depth = std::min((split_near + split_far) * 0.5f * (1.0f + corner_slope), split_far);
+        f32 radius = std::sqrt((split_far - center_depth) * (split_far - center_depth) + split_far * split_far * corner_slope);
+        // rounded up so floating point noise never changes the texel size
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        f32 texel_size = 2.0f * radius / static_cast<f32>(settings.resolution);
+        glm::vec3 center = glm::vec3{sun_view * inverse_camera_view * glm::vec4{0.0f, 0.0f, -center_depth, 1.0f}};
+        center.x = std::floor(center.x / texel_size) * texel_size;
+        center.y = std::floor(center.y / texel_size) * texel_size;
+
+        // the sun looks down its negative z axis, the casters between it and the slice are in front of the sphere
+        f32 near_plane = -(center.z + radius + settings.caster_distance);
+        f32 far_plane = -(center.z - radius);
+        glm::mat4 projection = glm::orthoRH_ZO(center.x - radius, center.x + radius, center.y - radius, center.y + radius, near_plane, far_plane);
+
+        cascades[i] = ShadowCascade {
+            .projection_view = projection * sun_view,
+            .far_distance = split_far,
+            .depth_range = far_plane - near_plane,
+        };
+        split_near = split_far;
+    }
+
+    return cascades;
+}
+
+auto get_cascade_tile(u32 atlas_width, u32 atlas_height, u32 cascade) -> daxa::Rect2D {
+    u32 tile_width = atlas_width / SUN_CASCADE_ATLAS_WIDTH;
+    u32 tile_height = atlas_height / SUN_CASCADE_ATLAS_HEIGHT;
+    return daxa::Rect2D {
+        .x = static_cast<i32>((cascade % SUN_CASCADE_ATLAS_WIDTH) * tile_width),
+        .y = static_cast<i32>((cascade / SUN_CASCADE_ATLAS_WIDTH) * tile_height),
+        .width = tile_width,
+        .height = tile_height,
+    };
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "pch.hpp"
+
+// one slice of the camera frustum as the sun sees it
+struct ShadowCascade {
+    glm::mat4 projection_view = {};
+    // view space depth of the camera where the slice ends
+    f32 far_distance = {};
+    // world units between the near and far plane of the projection
+    f32 depth_range = {};
+};
+
+struct ShadowCascadeSettings {
+    f32 fov = {};
+    f32 aspect = {};
+    f32 near_clip = {};
+    // the camera far plane or less, nothing past it gets a shadow
+    f32 shadow_distance = {};
+    // 0 splits the distance evenly, 1 logarithmically
+    f32 split_lambda = {};
+    // texels along a side of every cascade
+    u32 resolution = {};
+    // how far behind a cascade towards the sun casters are still rendered
+    f32 caster_distance = {};
+};
+
+// rotation of the sun with its origin at the world origin, it only changes with the direction so the cascades can
+// snap to a grid that stays put while the camera moves
+auto get_sun_view(const glm::vec3& direction) -> glm::mat4;
+
+// every cascade is a square around the bounding sphere of its slice, so its size doesnt change when the camera turns,
+// and moves in whole texels, so the shadow edges dont crawl when it moves. depths use the 0 to 1 range
+auto fit_shadow_cascades(const glm::mat4& camera_view, const glm::mat4& sun_view, const ShadowCascadeSettings& settings) -> std::array<ShadowCascade, SUN_CASCADE_COUNT>;
+
+// the tile of a cascade in the shadow atlas
+auto get_cascade_tile(u32 atlas_width, u32 atlas_height, u32 cascade) -> daxa::Rect2D;
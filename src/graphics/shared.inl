@@ -21,13 +21,26 @@ struct SpotLight {
 
 DAXA_DECL_BUFFER_PTR(SpotLight)
 
-struct SunInfo {
-    f32mat4x4 projection_matrix;
-    f32mat4x4 view_matrix;
+// the sun shadow is split into cascades along the camera view, they share one atlas as a grid of equally sized tiles
+// filled row by row
+#define SUN_CASCADE_COUNT 4
+#define SUN_CASCADE_ATLAS_WIDTH 2
+#define SUN_CASCADE_ATLAS_HEIGHT 2
+
+struct SunCascade {
     f32mat4x4 projection_view_matrix;
     f32vec4 terrain_y_clip_trick;
-    f32vec3 position;
+    // view space depth of the camera where the next cascade takes over
+    f32 far_distance;
+    // world units the 0 to 1 depth of the cascade spans
+    f32 depth_range;
+};
+
+struct SunInfo {
+    f32mat4x4 view_matrix;
+    SunCascade cascades[SUN_CASCADE_COUNT];
     f32vec3 direction;
+    // per world unit between the occluder and the receiver
     f32 exponential_factor;
     f32 darkening_factor;
     f32 bias;
@@ -138,17 +151,6 @@ DAXA_DECL_UNIFORM_BUFFER(SHADER_GLOBALS_SLOT) ShaderGlobalsBlock {
     ShaderGlobals globals;
 };
 
-struct TransformInfo {
-    f32mat4x4 model_matrix;
-    f32mat4x4 normal_matrix;
-};
-
-#define TRANSFORM_INFO_SLOT 1
-
-DAXA_DECL_UNIFORM_BUFFER(TRANSFORM_INFO_SLOT) TransformInfoBlock {
-    TransformInfo transform;
-};
-
 struct TextureId {
     daxa_ImageViewId image_id;
     daxa_SamplerId sampler_id;
@@ -177,8 +179,42 @@ struct Primitive {
     u32 index_count;
     u32 vertex_count;
     u32 material_index;
+    // every primitive picks 16 bit indices when its vertex count allows it, index_offset is in bytes into the packed
+    // index data of its model and aligned to index_type_size
+    u32 index_offset;
+    u32 index_type_size;
+    // range in the meshlets of its model, empty when the model was cooked without them
+    u32 first_meshlet;
+    u32 meshlet_count;
+    // range in the lods of its model, lod 0 is full detail and mirrors the index range above
+    u32 first_lod;
+    u32 lod_count;
+    // packed positions are 16 bit fractions of the primitive bounds, position = position_min + fraction * position_scale
+    f32vec3 position_min;
+    f32vec3 position_scale;
+};
+
+// cluster of at most 64 vertices and 124 triangles, bounds are in the space of the model
+struct Meshlet {
+    f32vec3 center;
+    f32 radius;
+    f32vec3 aabb_min;
+    f32vec3 aabb_max;
+    // every triangle faces away from a camera at p when dot(normalize(cone_apex - p), cone_axis) >= cone_cutoff
+    f32vec3 cone_apex;
+    f32vec3 cone_axis;
+    f32 cone_cutoff;
+    // vertex_offset indexes the meshlet vertices, which are relative to the first vertex of the primitive.
+    // triangle_offset is in bytes into the meshlet triangles, three u8 indices into the meshlet vertices per triangle
+    u32 vertex_offset;
+    u32 triangle_offset;
+    u32 vertex_count;
+    u32 triangle_count;
 };
 
+DAXA_DECL_BUFFER_PTR(Meshlet)
+
+// full precision vertex the importer and the cpu side tools work with
 struct Vertex {
     f32vec3 position;
     f32vec3 normal;
@@ -186,4 +222,95 @@ struct Vertex {
     f32vec4 tangent;
 };
 
-DAXA_DECL_BUFFER_PTR(Vertex)
\ No newline at end of file
+// what the geometry passes read, 20 bytes instead of 48. positions are unorm16 inside the primitive bounds with the
+// tangent handedness in the top bit of position_z_tangent_sign, normal and tangent are octahedral snorm16 and the uv
+// half floats
+struct PackedVertex {
+    u32 position_xy;
+    u32 position_z_tangent_sign;
+    u32 normal;
+    u32 tangent;
+    u32 uv;
+};
+
+DAXA_DECL_BUFFER_PTR(PackedVertex)
+
+// copy of the packed position kept in its own stream, so depth only passes fetch 8 bytes per vertex instead of the
+// whole vertex. indexed exactly like the vertices
+struct PackedPosition {
+    u32 xy;
+    u32 z;
+};
+
+DAXA_DECL_BUFFER_PTR(PackedPosition)
+
+// one primitive of one entity as the gpu culling sees it, written by the renderer every frame for the primitives that
+// survive the cpu frustum cull. the instances of a batch share the selected lods and are drawn by one instanced draw,
+// the buffer is the only place the world matrices live in
+struct DrawInstance {
+    f32mat4x4 model_matrix;
+    f32mat4x4 normal_matrix;
+    f32vec3 aabb_min;
+    f32vec3 aabb_max;
+    f32vec3 position_min;
+    f32vec3 position_scale;
+    u32 material_index;
+    // the draw of the batch in the command list of every view
+    u32 batch_index;
+    // index of the DrawItem, stable between frames while the scene doesnt change, keys the occlusion history
+    u32 item_index;
+    // 0 when the cpu culled it for the camera and it was only uploaded for the shadows
+    u32 camera_visible;
+};
+
+DAXA_DECL_BUFFER_PTR(DrawInstance)
+
+// layout of VkDrawIndexedIndirectCommand. the instances of a batch are contiguous in the uploaded order, first_instance
+// is where the batch starts and instance_count how many of them a view draws
+struct DrawIndexedIndirect {
+    u32 index_count;
+    u32 instance_count;
+    u32 first_index;
+    i32 vertex_offset;
+    u32 first_instance;
+};
+
+DAXA_DECL_BUFFER_PTR(DrawIndexedIndirect)
+
+// a bound index buffer has one index type, so the batches of every view are split into a command stream per type. the
+// draw buffer of a view holds one command per batch and after capacity commands the indices of the instances it draws,
+// gl_InstanceIndex goes through them to the DrawInstance
+#define DRAW_STREAM_COUNT 2
+
+#if !defined(__cplusplus)
+f32vec3 unpack_position(PackedVertex vertex, f32vec3 position_min, f32vec3 position_scale) {
+    const f32vec3 fraction = f32vec3(unpackUnorm2x16(vertex.position_xy), unpackUnorm2x16(vertex.position_z_tangent_sign).x);
+    return position_min + fraction * position_scale;
+}
+
+f32vec3 unpack_position(PackedPosition position, f32vec3 position_min, f32vec3 position_scale) {
+    const f32vec3 fraction = f32vec3(unpackUnorm2x16(position.xy), unpackUnorm2x16(position.z).x);
+    return position_min + fraction * position_scale;
+}
+
+f32vec3 unpack_octahedral(u32 packed) {
+    const f32vec2 encoded = unpackSnorm2x16(packed);
+    f32vec3 direction = f32vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if(direction.z < 0.0) {
+        direction.xy = (1.0 - abs(direction.yx)) * mix(f32vec2(-1.0), f32vec2(1.0), greaterThanEqual(direction.xy, f32vec2(0.0)));
+    }
+    return normalize(direction);
+}
+
+f32vec3 unpack_normal(PackedVertex vertex) {
+    return unpack_octahedral(vertex.normal);
+}
+
+f32vec4 unpack_tangent(PackedVertex vertex) {
+    return f32vec4(unpack_octahedral(vertex.tangent), (vertex.position_z_tangent_sign & 0x80000000u) != 0 ? -1.0 : 1.0);
+}
+
+f32vec2 unpack_uv(PackedVertex vertex) {
+    return unpackHalf2x16(vertex.uv);
+}
+#endif
\ No newline at end of file
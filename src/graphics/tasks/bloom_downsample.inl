@@ -40,12 +40,11 @@ struct BloomDownsampleTask {
     };
 
     Context* context = {};
-    u32 index = {};
+    GPUMetricHandle gpu_metric = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        std::string current_name = std::string{BloomDownsampleTask::NAME} + " - " + std::to_string(index);
-        context->gpu_metrics[current_name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         auto lower_size = ti.get_device().info_image(uses.u_lower_mip.image()).size;
 
@@ -63,7 +62,7 @@ struct BloomDownsampleTask {
         cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
         cmd.draw({ .vertex_count = 3 });
         cmd.end_renderpass();
-        context->gpu_metrics[current_name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -49,12 +49,11 @@ struct BloomUpsampleTask {
     };
 
     Context* context = {};
-    u32 index = {};
+    GPUMetricHandle gpu_metric = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        std::string current_name = std::string{BloomUpsampleTask::NAME} + " - " + std::to_string(index);
-        context->gpu_metrics[current_name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         auto higher_size = ti.get_device().info_image(uses.u_higher_mip.image()).size;
 
@@ -72,7 +71,7 @@ struct BloomUpsampleTask {
         cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
         cmd.draw({ .vertex_count = 3 });
         cmd.end_renderpass();
-        context->gpu_metrics[current_name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -52,10 +52,11 @@ struct CompositionTask {
     };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_albedo_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_albedo_image.image()).size.y;
@@ -74,7 +75,7 @@ struct CompositionTask {
         cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
         cmd.draw({ .vertex_count = 3 });
         cmd.end_renderpass();
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -159,22 +160,45 @@ f32vec3 calculate_spot_light(SpotLight light, f32vec3 frag_color, f32vec3 normal
     return frag_color * light.color * (diffuse + exp(exponent)) * attenuation * light.intensity * intensity;
 }
 
+// where a position in the clip space of a cascade lands in the atlas
+f32vec2 get_cascade_uv(u32 cascade, f32vec2 clip_xy) {
+    const f32vec2 tile = f32vec2(cascade % SUN_CASCADE_ATLAS_WIDTH, cascade / SUN_CASCADE_ATLAS_WIDTH);
+    return (tile + clip_xy * 0.5 + 0.5) / f32vec2(SUN_CASCADE_ATLAS_WIDTH, SUN_CASCADE_ATLAS_HEIGHT);
+}
+
 void main() {
     // setup for shadow
     const f32 depth = texture(daxa_sampler2D(u_depth_image, globals.linear_sampler), in_uv).r;
     const f32vec3 vertex_position = get_world_position_from_depth(in_uv, depth);
-    const f32vec4 shadow_position = globals.sun_info.projection_matrix * globals.sun_info.view_matrix * f32vec4(vertex_position, 1.0);
-    
+    const f32 view_depth = -(globals.camera_view_matrix * f32vec4(vertex_position, 1.0)).z;
+
+    // the first cascade that reaches the pixel, past the last one nothing is shadowed
+    u32 cascade = SUN_CASCADE_COUNT;
+    for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+        if(view_depth <= globals.sun_info.cascades[i].far_distance) { cascade = i; break; }
+    }
 
     // calculate shadow
-    f32vec3 proj_coord = shadow_position.xyz / shadow_position.w;
-    proj_coord = f32vec3(proj_coord.xy * 0.5 + 0.5, proj_coord.z);
-    const f32 shadow_depth = texture(daxa_sampler2D(u_shadow_image, globals.linear_sampler), proj_coord.xy).r;
-    const f32 sun_shadow = clamp(pow(exp(globals.sun_info.exponential_factor * (proj_coord.z - shadow_depth)), globals.sun_info.darkening_factor), 0.0f, 1.0f);
+    f32 sun_shadow = 1.0;
+    if(cascade < SUN_CASCADE_COUNT) {
+        const f32vec4 shadow_position = globals.sun_info.cascades[cascade].projection_view_matrix * f32vec4(vertex_position, 1.0);
+        const f32vec3 proj_coord = shadow_position.xyz / shadow_position.w;
+        // linear filtering across the tile border would blend in the neighbouring cascade, so stay half a texel inside
+        const f32vec2 half_texel = 0.5 / f32vec2(textureSize(daxa_sampler2D(u_shadow_image, globals.linear_sampler), 0));
+        const f32vec2 tile_min = get_cascade_uv(cascade, f32vec2(-1.0)) + half_texel;
+        const f32vec2 tile_max = get_cascade_uv(cascade, f32vec2(1.0)) - half_texel;
+        const f32vec2 shadow_uv = clamp(get_cascade_uv(cascade, proj_coord.xy), tile_min, tile_max);
+        const f32 shadow_depth = texture(daxa_sampler2D(u_shadow_image, globals.linear_sampler), shadow_uv).r;
+        // the depth difference in world units, so every cascade darkens the same no matter how deep it is
+        const f32 distance = (proj_coord.z - shadow_depth) * globals.sun_info.cascades[cascade].depth_range;
+        sun_shadow = clamp(pow(exp(globals.sun_info.exponential_factor * distance), globals.sun_info.darkening_factor), 0.0f, 1.0f);
+    }
 
 
-    // volumetrics
-    f32vec4 shadow_camera_position = globals.sun_info.projection_matrix * globals.sun_info.view_matrix * f32vec4(globals.camera_position, 1.0);
+    // volumetrics, marched through the last cascade which covers the whole shadowed distance
+    const SunCascade fog_cascade = globals.sun_info.cascades[SUN_CASCADE_COUNT - 1];
+    const f32vec4 shadow_position = fog_cascade.projection_view_matrix * f32vec4(vertex_position, 1.0);
+    f32vec4 shadow_camera_position = fog_cascade.projection_view_matrix * f32vec4(globals.camera_position, 1.0);
     shadow_camera_position.xyz /= shadow_camera_position.w;
 
     f32vec3 V = (shadow_position.xyz / shadow_position.w) - shadow_camera_position.xyz;
@@ -188,7 +212,7 @@ void main() {
     float accum_fog = 0.0;
     for (u32 i = 0; i < NUM_STEPS_INT; ++i) {
         f32vec3 clip_space_step = shadow_camera_position.xyz + step * f32(i) + dither_value * step;
-        accum_fog += texture(daxa_sampler2DShadow(globals.sun_info.shadow_image, globals.sun_info.shadow_sampler), f32vec3(clip_space_step.xy * 0.5f + 0.5f, clip_space_step.z)).r;
+        accum_fog += texture(daxa_sampler2DShadow(globals.sun_info.shadow_image, globals.sun_info.shadow_sampler), f32vec3(get_cascade_uv(SUN_CASCADE_COUNT - 1, clip_space_step.xy), clip_space_step.z)).r;
     }
 
     V = normalize(vertex_position - globals.camera_position);
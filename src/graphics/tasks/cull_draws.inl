@@ -0,0 +1,273 @@
+#pragma once
+#define DAXA_ENABLE_SHADER_NO_NAMESPACE 1
+#include <daxa/daxa.inl>
+#include <daxa/utils/task_graph.inl>
+
+#include "../shared.inl"
+
+#define CULL_DRAWS_X 64
+
+// the early phase draws what passed the hiz test last frame, the late phase tests everything against the pyramid
+// built out of the early depth and draws what became visible
+#define CULL_DRAWS_EARLY 0
+#define CULL_DRAWS_LATE 1
+
+struct CullDrawsPush {
+    daxa_BufferPtr(DrawInstance) instances;
+    daxa_RWBufferPtr(u32) visibility;
+    daxa_RWBufferPtr(DrawIndexedIndirect) camera_commands;
+    daxa_RWBufferPtr(u32) camera_instance_indices;
+    daxa_RWBufferPtr(DrawIndexedIndirect) sun_commands[SUN_CASCADE_COUNT];
+    daxa_RWBufferPtr(u32) sun_instance_indices[SUN_CASCADE_COUNT];
+    daxa_ImageViewId hiz;
+    u32 hiz_mip_count;
+    u32 instance_count;
+    u32 phase;
+};
+
+#if __cplusplus
+#include "../../context.hpp"
+#include "../draw_list.hpp"
+
+struct CullDrawsTask {
+    inline static std::string_view NAME = "CullDraws";
+
+    inline static const daxa::ComputePipelineCompileInfo PIPELINE_COMPILE_INFO = {
+        .shader_info = daxa::ShaderCompileInfo{
+            .source = daxa::ShaderFile{"src/graphics/tasks/cull_draws.inl"},
+            .compile_options = { .defines = { { std::string{CullDrawsTask::NAME} + "_SHADER", "1" } } }
+        },
+        .push_constant_size = sizeof(CullDrawsPush),
+        .name = std::string{CullDrawsTask::NAME}
+    };
+
+    // tests every uploaded instance against the camera and sun cascade frustums, the camera draws only take what was visible
+    // last frame. the batch commands are copied in by a transfer first so the graph orders it against the previous
+    // frame's draws
+    static void build(Context* context, daxa::TaskGraph& task_graph, DrawList* draw_list) {
+        using namespace daxa::task_resource_uses;
+
+        std::vector<daxa::GenericTaskResourceUse> reset_uses = { BufferTransferWrite{draw_list->camera_draws}, BufferTransferWrite{draw_list->late_draws}, BufferTransferWrite{draw_list->visibility} };
+        std::vector<daxa::GenericTaskResourceUse> cull_uses = { BufferComputeShaderReadWrite{draw_list->camera_draws}, BufferComputeShaderRead{draw_list->visibility} };
+        for(auto& sun_draws : draw_list->sun_draws) {
+            reset_uses.push_back(BufferTransferWrite{sun_draws});
+            cull_uses.push_back(BufferComputeShaderReadWrite{sun_draws});
+        }
+
+        task_graph.add_task({
+            .uses = reset_uses,
+            .task = [=](daxa::TaskInterface ti) {
+                auto cmd = ti.get_command_list();
+                if(draw_list->batch_count != 0) {
+                    usize size = sizeof(DrawIndexedIndirect) * draw_list->batch_count;
+                    usize sun_offset = draw_list->batch_region_offset + sizeof(DrawIndexedIndirect) * draw_list->capacity;
+                    std::vector<std::pair<daxa::BufferId, usize>> copies = { { draw_list->camera_draws.get_state().buffers[0], draw_list->batch_region_offset }, { draw_list->late_draws.get_state().buffers[0], draw_list->batch_region_offset } };
+                    for(auto& sun_draws : draw_list->sun_draws) { copies.push_back({ sun_draws.get_state().buffers[0], sun_offset }); }
+                    for(auto [buffer, src_offset] : copies) {
+                        cmd.copy_buffer_to_buffer({ .src_buffer = draw_list->batch_buffer, .src_offset = src_offset, .dst_buffer = buffer, .dst_offset = 0, .size = size });
+                    }
+                }
+
+                if(draw_list->clear_visibility) {
+                    cmd.clear_buffer({ .buffer = draw_list->visibility.get_state().buffers[0], .offset = 0, .size = sizeof(u32) * draw_list->capacity, .clear_value = 0 });
+                    draw_list->clear_visibility = false;
+                }
+            },
+            .name = "reset draws",
+        });
+
+        const GPUMetricHandle gpu_metric = context->gpu_metric_pool->get_metric(std::string{CullDrawsTask::NAME});
+
+        task_graph.add_task({
+            .uses = cull_uses,
+            .task = [=](daxa::TaskInterface ti) {
+                auto cmd = ti.get_command_list();
+                context->gpu_metric_pool->start(cmd, gpu_metric);
+                cmd.set_uniform_buffer(context->shader_globals_set_info);
+                cmd.set_pipeline(*context->compute_pipelines.at(NAME));
+
+                auto camera_buffer = draw_list->camera_draws.get_state().buffers[0];
+                CullDrawsPush push = {
+                    .instances = draw_list->instances_address,
+                    .visibility = ti.get_device().get_device_address(draw_list->visibility.get_state().buffers[0]),
+                    .camera_commands = ti.get_device().get_device_address(camera_buffer),
+                    .camera_instance_indices = draw_list->get_instance_indices_address(ti.get_device(), camera_buffer),
+                    .sun_commands = {},
+                    .sun_instance_indices = {},
+                    .hiz = {},
+                    .hiz_mip_count = 0,
+                    .instance_count = draw_list->instance_count,
+                    .phase = CULL_DRAWS_EARLY,
+                };
+                for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+                    auto sun_buffer = draw_list->sun_draws[i].get_state().buffers[0];
+                    push.sun_commands[i] = ti.get_device().get_device_address(sun_buffer);
+                    push.sun_instance_indices[i] = draw_list->get_instance_indices_address(ti.get_device(), sun_buffer);
+                }
+                cmd.push_constant(push);
+
+                cmd.dispatch((draw_list->instance_count + CULL_DRAWS_X - 1) / CULL_DRAWS_X, 1, 1);
+                context->gpu_metric_pool->end(cmd, gpu_metric);
+            },
+            .name = "cull draws",
+        });
+    }
+
+    // tests the camera visible instances against a max depth pyramid of the early draws, writes the ones that werent
+    // drawn yet into the late draws and remembers the result for the next frame
+    static void build_late(Context* context, daxa::TaskGraph& task_graph, DrawList* draw_list, daxa::TaskImageView hiz) {
+        using namespace daxa::task_resource_uses;
+
+        const GPUMetricHandle gpu_metric = context->gpu_metric_pool->get_metric(std::string{CullDrawsTask::NAME} + " - late");
+
+        task_graph.add_task({
+            .uses = { BufferComputeShaderReadWrite{draw_list->late_draws}, BufferComputeShaderReadWrite{draw_list->visibility}, ImageComputeShaderSampled<>{hiz} },
+            .task = [=](daxa::TaskInterface ti) {
+                auto cmd = ti.get_command_list();
+                context->gpu_metric_pool->start(cmd, gpu_metric);
+                cmd.set_uniform_buffer(context->shader_globals_set_info);
+                cmd.set_pipeline(*context->compute_pipelines.at(NAME));
+
+                auto late_buffer = draw_list->late_draws.get_state().buffers[0];
+                cmd.push_constant(CullDrawsPush {
+                    .instances = draw_list->instances_address,
+                    .visibility = ti.get_device().get_device_address(draw_list->visibility.get_state().buffers[0]),
+                    .camera_commands = ti.get_device().get_device_address(late_buffer),
+                    .camera_instance_indices = draw_list->get_instance_indices_address(ti.get_device(), late_buffer),
+                    .sun_commands = {},
+                    .sun_instance_indices = {},
+                    .hiz = ti.uses[hiz].view(),
+                    .hiz_mip_count = ti.get_device().info_image(ti.uses[hiz].image()).mip_level_count,
+                    .instance_count = draw_list->instance_count,
+                    .phase = CULL_DRAWS_LATE,
+                });
+
+                cmd.dispatch((draw_list->instance_count + CULL_DRAWS_X - 1) / CULL_DRAWS_X, 1, 1);
+                context->gpu_metric_pool->end(cmd, gpu_metric);
+            },
+            .name = "cull late draws",
+        });
+    }
+};
+#endif
+
+#if defined(CullDraws_SHADER)
+#extension GL_KHR_shader_subgroup_ballot : require
+
+DAXA_DECL_PUSH_CONSTANT(CullDrawsPush, push)
+
+layout(local_size_x = CULL_DRAWS_X) in;
+
+// same plane corner test as cull_boxes on the cpu, a sign test doesnt need normalized planes
+bool is_box_in_frustum(f32mat4x4 projection_view, f32vec3 aabb_min, f32vec3 aabb_max) {
+    const f32vec4 row_x = f32vec4(projection_view[0][0], projection_view[1][0], projection_view[2][0], projection_view[3][0]);
+    const f32vec4 row_y = f32vec4(projection_view[0][1], projection_view[1][1], projection_view[2][1], projection_view[3][1]);
+    const f32vec4 row_z = f32vec4(projection_view[0][2], projection_view[1][2], projection_view[2][2], projection_view[3][2]);
+    const f32vec4 row_w = f32vec4(projection_view[0][3], projection_view[1][3], projection_view[2][3], projection_view[3][3]);
+    const f32vec4 planes[6] = f32vec4[](row_w + row_x, row_w - row_x, row_w + row_y, row_w - row_y, row_w + row_z, row_w - row_z);
+
+    for(u32 i = 0; i < 6; i++) {
+        const f32vec3 corner = mix(aabb_min, aabb_max, greaterThan(planes[i].xyz, f32vec3(0.0)));
+        if(dot(planes[i].xyz, corner) + planes[i].w < 0.0) { return false; }
+    }
+    return true;
+}
+
+// adds the instance to the draw of its batch. the instances are sorted by batch, so a subgroup mostly spans one or two
+// of them and takes a round per batch, the lanes of a round share one atomic and keep their order
+void write_draw(daxa_RWBufferPtr(DrawIndexedIndirect) commands, daxa_RWBufferPtr(u32) instance_indices, u32 batch_index, u32 instance_index) {
+    bool pending = true;
+    while(pending) {
+        if(batch_index == subgroupBroadcastFirst(batch_index)) {
+            const u32vec4 ballot = subgroupBallot(true);
+            u32 first_slot = 0;
+            if(subgroupElect()) { first_slot = atomicAdd(deref(commands[batch_index]).instance_count, subgroupBallotBitCount(ballot)); }
+            first_slot = subgroupBroadcastFirst(first_slot);
+            deref(instance_indices[deref(commands[batch_index]).first_instance + first_slot + subgroupBallotExclusiveBitCount(ballot)]) = instance_index;
+            pending = false;
+        }
+    }
+}
+
+// the pyramid holds the farthest depth under every texel, a box is only hidden when its nearest point is behind that
+// everywhere it covers. boxes reaching behind the camera or bigger than the pyramid are always visible
+bool is_box_occluded(f32vec3 aabb_min, f32vec3 aabb_max) {
+    f32vec2 uv_min = f32vec2(1.0);
+    f32vec2 uv_max = f32vec2(0.0);
+    f32 nearest_depth = 1.0;
+    for(u32 i = 0; i < 8; i++) {
+        const f32vec3 corner = mix(aabb_min, aabb_max, bvec3((i & 1) != 0, (i & 2) != 0, (i & 4) != 0));
+        const f32vec4 clip = globals.camera_projection_view_matrix * f32vec4(corner, 1.0);
+        if(clip.w <= 0.0) { return false; }
+        const f32vec3 ndc = clip.xyz / clip.w;
+        uv_min = min(uv_min, ndc.xy * 0.5 + 0.5);
+        uv_max = max(uv_max, ndc.xy * 0.5 + 0.5);
+        nearest_depth = min(nearest_depth, ndc.z);
+    }
+    uv_min = clamp(uv_min, 0.0, 1.0);
+    uv_max = clamp(uv_max, 0.0, 1.0);
+
+    // mip 0 is half the resolution and every level halves with floor, a texel of level l always covers the same
+    // 2^(l+1) pixel square but odd sizes drop the last row or column, so the real extent of every level comes from
+    // the image. the box starts at the level where it spans at most 2x2 texels and moves down while it reaches past
+    // what that level holds, at most 4x4 texels are read
+    const i32vec2 pixel_min = i32vec2(floor(uv_min * f32vec2(globals.resolution)));
+    const i32vec2 pixel_max = max(i32vec2(ceil(uv_max * f32vec2(globals.resolution))) - 1, pixel_min);
+    const i32vec2 pixel_extent = pixel_max - pixel_min + 1;
+    i32 level = i32(ceil(log2(max(f32(max(pixel_extent.x, pixel_extent.y)) * 0.5, 1.0))));
+    if(level >= i32(push.hiz_mip_count)) { return false; }
+
+    i32vec2 texel_min = pixel_min >> (level + 1);
+    i32vec2 texel_max = pixel_max >> (level + 1);
+    while(any(greaterThanEqual(texel_max, textureSize(daxa_sampler2D(push.hiz, globals.nearest_sampler), level)))) {
+        if(level == 0) { return false; }
+        level--;
+        texel_min = pixel_min >> (level + 1);
+        texel_max = pixel_max >> (level + 1);
+    }
+    if(any(greaterThan(texel_max - texel_min, i32vec2(3)))) { return false; }
+
+    f32 farthest_depth = 0.0;
+    for(i32 y = texel_min.y; y <= texel_max.y; y++) {
+        for(i32 x = texel_min.x; x <= texel_max.x; x++) {
+            farthest_depth = max(farthest_depth, texelFetch(daxa_sampler2D(push.hiz, globals.nearest_sampler), i32vec2(x, y), level).r);
+        }
+    }
+    return nearest_depth > farthest_depth;
+}
+
+void main() {
+    const u32 instance_index = gl_GlobalInvocationID.x;
+    if(instance_index >= push.instance_count) { return; }
+
+    const f32vec3 aabb_min = deref(push.instances[instance_index]).aabb_min;
+    const f32vec3 aabb_max = deref(push.instances[instance_index]).aabb_max;
+    const u32 batch_index = deref(push.instances[instance_index]).batch_index;
+    const u32 item_index = deref(push.instances[instance_index]).item_index;
+    const bool in_camera_frustum = deref(push.instances[instance_index]).camera_visible != 0 && is_box_in_frustum(globals.camera_projection_view_matrix, aabb_min, aabb_max);
+
+    if(push.phase == CULL_DRAWS_EARLY) {
+        if(in_camera_frustum && deref(push.visibility[item_index]) != 0) {
+            write_draw(push.camera_commands, push.camera_instance_indices, batch_index, instance_index);
+        }
+
+        // the sun has no depth of its own to test against, so the cascades keep the frustum test only
+        for(u32 i = 0; i < SUN_CASCADE_COUNT; i++) {
+            if(is_box_in_frustum(globals.sun_info.cascades[i].projection_view_matrix, aabb_min, aabb_max)) {
+                write_draw(push.sun_commands[i], push.sun_instance_indices[i], batch_index, instance_index);
+            }
+        }
+    } else {
+        const bool visible = in_camera_frustum && !is_box_occluded(aabb_min, aabb_max);
+        // the early phase already drew whatever was visible last frame
+        if(visible && deref(push.visibility[item_index]) == 0) {
+            write_draw(push.camera_commands, push.camera_instance_indices, batch_index, instance_index);
+        }
+        deref(push.visibility[item_index]) = visible ? 1 : 0;
+    }
+}
+#endif
+
+#undef CULL_DRAWS_X
+#undef CULL_DRAWS_EARLY
+#undef CULL_DRAWS_LATE
@@ -17,10 +17,11 @@ struct BlitImageToImageTask {
     DAXA_USE_TASK_HEADER(BlitImageToImage)
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
 
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         i32 size_x = static_cast<i32>(ti.get_device().info_image(uses.u_target_image.image()).size.x);
         i32 size_y = static_cast<i32>(ti.get_device().info_image(uses.u_target_image.image()).size.y);
@@ -43,7 +44,7 @@ struct BlitImageToImageTask {
             .filter = daxa::Filter::LINEAR,
         });
 
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 
@@ -56,14 +57,14 @@ struct MipMappingTask {
     DAXA_USE_TASK_HEADER(MipMapping)
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
     u32 mip = {};
     std::array<i32, 3> mip_size = {};
     std::array<i32, 3> next_mip_size = {};
 
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        std::string current_name = std::string{MipMappingTask::NAME} + " - " + std::to_string(mip);
-        context->gpu_metrics[current_name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         cmd.blit_image_to_image({
             .src_image = uses.u_lower_mip.image(),
@@ -83,7 +84,7 @@ struct MipMappingTask {
             .filter = daxa::Filter::LINEAR,
         });
 
-        context->gpu_metrics[current_name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 
@@ -127,10 +128,11 @@ struct DepthOfFieldTask {
     };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
 
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_target_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_target_image.image()).size.y;
@@ -150,7 +152,7 @@ struct DepthOfFieldTask {
         cmd.draw({ .vertex_count = 3 });
         cmd.end_renderpass();
 
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 
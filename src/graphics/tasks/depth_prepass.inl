@@ -9,19 +9,20 @@
 
 DAXA_DECL_TASK_USES_BEGIN(DepthPrepass, 2)
 DAXA_TASK_USE_IMAGE(u_depth_image, REGULAR_2D, DEPTH_ATTACHMENT)
+DAXA_TASK_USE_BUFFER(u_draws, daxa_BufferPtr(DrawIndexedIndirect), DRAW_INDIRECT_INFO_READ)
 DAXA_DECL_TASK_USES_END()
 
 struct DepthPrepassPush {
-    daxa_BufferPtr(Vertex) vertices;
+    daxa_BufferPtr(DrawInstance) instances;
+    daxa_BufferPtr(u32) instance_indices;
+    daxa_BufferPtr(PackedPosition) positions;
 };
 
 #endif
 
 #if __cplusplus
 #include "../../context.hpp"
-#include "../../ecs/scene.hpp"
-#include "../../ecs/entity.hpp"
-#include "../../ecs/components.hpp"
+#include "../draw_list.hpp"
 
 struct DepthPrepassTask {
     DAXA_USE_TASK_HEADER(DepthPrepass)
@@ -49,11 +50,14 @@ struct DepthPrepassTask {
     };
 
     Context* context = {};
-    Scene* scene {};
+    GPUMetricHandle gpu_metric = {};
+    DrawList* draw_list = {};
+    // the late pass of the occlusion culling draws on top of the depth of the first one
+    daxa::AttachmentLoadOp load_op = daxa::AttachmentLoadOp::CLEAR;
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_depth_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_depth_image.image()).size.y;
@@ -61,48 +65,25 @@ struct DepthPrepassTask {
         cmd.begin_renderpass( daxa::RenderPassBeginInfo {
             .depth_attachment = {{
                 .image_view = uses.u_depth_image.view(),
-                .load_op = daxa::AttachmentLoadOp::CLEAR,
+                .load_op = load_op,
                 .clear_value = daxa::DepthValue{1.0f, 0},
             }},
             .render_area = {.x = 0, .y = 0, .width = size_x, .height = size_y},
         });
 
-        scene->iterate([&](Entity entity){
-            if(entity.has_component<MeshComponent>() && entity.has_component<TransformComponent>()) {
-                cmd.set_uniform_buffer(context->shader_globals_set_info);
-                cmd.set_uniform_buffer(entity.get_component<TransformComponent>().buffer_info);
-                cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
-                cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
-
-                auto& mesh = entity.get_component<MeshComponent>();
-                for(auto& primitive : mesh.model->primitives) {
-                    cmd.push_constant(DepthPrepassPush {
-                        .vertices = ti.get_device().get_device_address(mesh.model->vertex_buffer),
-                    });
-
-                    if(primitive.index_count > 0) {
-                        cmd.set_index_buffer(mesh.model->index_buffer, 0);
-                        cmd.draw_indexed({
-                            .index_count = primitive.index_count,
-                            .instance_count = 1,
-                            .first_index = primitive.first_index,
-                            .vertex_offset = static_cast<i32>(primitive.first_vertex),
-                            .first_instance = 0,
-                        });
-                    } else {
-                        cmd.draw({
-                            .vertex_count = primitive.vertex_count,
-                            .instance_count = 1,
-                            .first_vertex = primitive.first_vertex,
-                            .first_instance = 0
-                        });
-                    }
-                }
-            }
+        auto* arena = context->geometry_arena.get();
+        cmd.set_uniform_buffer(context->shader_globals_set_info);
+        cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
+        cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
+        cmd.push_constant(DepthPrepassPush {
+            .instances = draw_list->instances_address,
+            .instance_indices = draw_list->get_instance_indices_address(ti.get_device(), uses.u_draws.buffer()),
+            .positions = ti.get_device().get_device_address(arena->position_buffer),
         });
+        draw_list->draw(cmd, arena->index_buffer, uses.u_draws.buffer());
 
         cmd.end_renderpass();
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -115,8 +96,9 @@ DAXA_DECL_PUSH_CONSTANT(DepthPrepassPush, push)
 #if DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_VERTEX
 
 void main() {    
-    const vec4 vertex_position = vec4(deref(push.vertices[gl_VertexIndex]).position, 1);
-    gl_Position = globals.camera_projection_matrix * globals.camera_view_matrix * transform.model_matrix * vertex_position;
+    const daxa_BufferPtr(DrawInstance) instance = push.instances[deref(push.instance_indices[gl_InstanceIndex])];
+    const vec4 vertex_position = vec4(unpack_position(deref(push.positions[gl_VertexIndex]), deref(instance).position_min, deref(instance).position_scale), 1);
+    gl_Position = globals.camera_projection_matrix * globals.camera_view_matrix * deref(instance).model_matrix * vertex_position;
 }
 
 #elif DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_FRAGMENT
@@ -72,13 +72,14 @@ struct DrawTerrainTask {
     };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
     u32 terrain_index_size = {};
     Texture* terrain_heightmap = {};
     Texture* terrain_albedomap = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_depth_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_depth_image.image()).size.y;
@@ -120,7 +121,7 @@ struct DrawTerrainTask {
         cmd.draw_indexed({ .index_count =  terrain_index_size });
 
         cmd.end_renderpass();
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
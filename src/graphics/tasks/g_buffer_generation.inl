@@ -14,20 +14,22 @@ DAXA_TASK_USE_IMAGE(u_normal_image, REGULAR_2D, COLOR_ATTACHMENT)
 DAXA_TASK_USE_IMAGE(u_metallic_roughness_image, REGULAR_2D, COLOR_ATTACHMENT)
 DAXA_TASK_USE_IMAGE(u_velocity_image, REGULAR_2D, COLOR_ATTACHMENT)
 DAXA_TASK_USE_IMAGE(u_depth_image, REGULAR_2D, DEPTH_ATTACHMENT)
+DAXA_TASK_USE_BUFFER(u_draws, daxa_BufferPtr(DrawIndexedIndirect), DRAW_INDIRECT_INFO_READ)
+DAXA_TASK_USE_BUFFER(u_late_draws, daxa_BufferPtr(DrawIndexedIndirect), DRAW_INDIRECT_INFO_READ)
 DAXA_DECL_TASK_USES_END()
 
 struct GBufferGenerationPush {
-    daxa_BufferPtr(Vertex) vertices;
-    daxa_BufferPtr(Material) material;
+    daxa_BufferPtr(DrawInstance) instances;
+    daxa_BufferPtr(u32) instance_indices;
+    daxa_BufferPtr(PackedVertex) vertices;
+    daxa_BufferPtr(Material) materials;
 };
 
 #endif
 
 #if __cplusplus
 #include "../../context.hpp"
-#include "../../ecs/scene.hpp"
-#include "../../ecs/entity.hpp"
-#include "../../ecs/components.hpp"
+#include "../draw_list.hpp"
 
 
 struct GBufferGenerationTask {
@@ -63,11 +65,12 @@ struct GBufferGenerationTask {
     };
 
     Context* context = {};
-    Scene* scene {};
+    GPUMetricHandle gpu_metric = {};
+    DrawList* draw_list = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_albedo_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_albedo_image.image()).size.y;
@@ -108,43 +111,22 @@ struct GBufferGenerationTask {
             .render_area = {.x = 0, .y = 0, .width = size_x, .height = size_y},
         });
 
-        scene->iterate([&](Entity entity){
-            if(entity.has_component<MeshComponent>() && entity.has_component<TransformComponent>()) {
-                cmd.set_uniform_buffer(context->shader_globals_set_info);
-                cmd.set_uniform_buffer(entity.get_component<TransformComponent>().buffer_info);
-                cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
-                cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
-
-                auto& mesh = entity.get_component<MeshComponent>();
-                for(auto& primitive : mesh.model->primitives) {
-                    cmd.push_constant(GBufferGenerationPush {
-                        .vertices = ti.get_device().get_device_address(mesh.model->vertex_buffer),
-                        .material = ti.get_device().get_device_address(mesh.model->material_buffer) + primitive.material_index * sizeof(Material),
-                    });
-
-                    if(primitive.index_count > 0) {
-                        cmd.set_index_buffer(mesh.model->index_buffer, 0);
-                        cmd.draw_indexed({
-                            .index_count = primitive.index_count,
-                            .instance_count = 1,
-                            .first_index = primitive.first_index,
-                            .vertex_offset = static_cast<i32>(primitive.first_vertex),
-                            .first_instance = 0,
-                        });
-                    } else {
-                        cmd.draw({
-                            .vertex_count = primitive.vertex_count,
-                            .instance_count = 1,
-                            .first_vertex = primitive.first_vertex,
-                            .first_instance = 0
-                        });
-                    }
-                }
-            }
-        });
+        auto* arena = context->geometry_arena.get();
+        cmd.set_uniform_buffer(context->shader_globals_set_info);
+        cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
+        cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
+        for(auto draw_buffer : { uses.u_draws.buffer(), uses.u_late_draws.buffer() }) {
+            cmd.push_constant(GBufferGenerationPush {
+                .instances = draw_list->instances_address,
+                .instance_indices = draw_list->get_instance_indices_address(ti.get_device(), draw_buffer),
+                .vertices = ti.get_device().get_device_address(arena->vertex_buffer),
+                .materials = ti.get_device().get_device_address(arena->material_buffer),
+            });
+            draw_list->draw(cmd, arena->index_buffer, draw_buffer);
+        }
 
         cmd.end_renderpass();
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -161,11 +143,15 @@ layout(location = 1) out f32vec3 out_normal;
 layout(location = 2) out f32vec3 out_position;
 layout(location = 3) out f32vec4 out_current_position_clip;
 layout(location = 4) out f32vec4 out_previous_position_clip;
+layout(location = 5) flat out u32 out_material_index;
 
 void main() {    
-    out_uv = deref(push.vertices[gl_VertexIndex]).uv;
-    out_normal = normalize(f32mat3x3(transform.normal_matrix) * deref(push.vertices[gl_VertexIndex]).normal);
-    const f32vec4 vertex_position = transform.model_matrix * vec4(deref(push.vertices[gl_VertexIndex]).position, 1);
+    const PackedVertex vertex = deref(push.vertices[gl_VertexIndex]);
+    const daxa_BufferPtr(DrawInstance) instance = push.instances[deref(push.instance_indices[gl_InstanceIndex])];
+    out_uv = unpack_uv(vertex);
+    out_normal = normalize(f32mat3x3(deref(instance).normal_matrix) * unpack_normal(vertex));
+    const f32vec4 vertex_position = deref(instance).model_matrix * vec4(unpack_position(vertex, deref(instance).position_min, deref(instance).position_scale), 1);
+    out_material_index = deref(instance).material_index;
     out_position = vertex_position.xyz;
     out_current_position_clip = globals.camera_projection_matrix * globals.camera_view_matrix * vertex_position;
     out_previous_position_clip = globals.camera_previous_projection_matrix * globals.camera_previous_view_matrix * vertex_position;
@@ -179,6 +165,7 @@ layout(location = 1) in f32vec3 in_normal;
 layout(location = 2) in f32vec3 in_position;
 layout(location = 3) in f32vec4 in_current_position_clip;
 layout(location = 4) in f32vec4 in_previous_position_clip;
+layout(location = 5) flat in u32 in_material_index;
 
 layout(location = 0) out f32vec4 out_albedo;
 layout(location = 1) out f32vec4 out_emissive;
@@ -187,16 +174,19 @@ layout(location = 3) out f32vec4 out_metallic_roughness;
 layout(location = 4) out f32vec4 out_velocity;
 
 void main() {
+    const daxa_BufferPtr(Material) material = push.materials[in_material_index];
     f32vec3 emissive = f32vec3(0.0f);
-    if(deref(push.material).has_emissive_image == 1) { emissive = sample_texture(deref(push.material).emissive_image, in_uv).rgb; }
+    if(deref(material).has_emissive_image == 1) { emissive = sample_texture(deref(material).emissive_image, in_uv).rgb; }
     out_emissive = f32vec4(emissive, 1.0f);
 
-    out_albedo = f32vec4(sample_texture(deref(push.material).albedo_image, in_uv).rgb + emissive, 1.0f);
+    out_albedo = f32vec4(sample_texture(deref(material).albedo_image, in_uv).rgb + emissive, 1.0f);
     
 
     f32vec3 normal = normalize(in_normal);
-    if(deref(push.material).has_normal_image == 1) {
-        f32vec3 tangent_normal = sample_texture(deref(push.material).normal_image, in_uv).xyz * 2.0 - 1.0;
+    if(deref(material).has_normal_image == 1) {
+        // normal maps can be stored as two channel BC5, so z is always rebuilt from xy
+        f32vec2 tangent_normal_xy = sample_texture(deref(material).normal_image, in_uv).xy * 2.0 - 1.0;
+        f32vec3 tangent_normal = f32vec3(tangent_normal_xy, sqrt(clamp(1.0 - dot(tangent_normal_xy, tangent_normal_xy), 0.0, 1.0)));
 
         f32vec3 Q1  = dFdx(in_position);
         f32vec3 Q2  = dFdy(in_position);
@@ -215,10 +205,10 @@ void main() {
     out_normal = f32vec4(normal, 1.0f);
 
     f32vec2 metallic_roughness = f32vec2(0.0f);
-    if(deref(push.material).has_metallic_roughness_image == 1) {
+    if(deref(material).has_metallic_roughness_image == 1) {
         // gltf spec channel G - roughness and B - metallic
         // I mapped the roughness to R and metallic to B channel
-        metallic_roughness = sample_texture(deref(push.material).metallic_roughness_image, in_uv).gb;
+        metallic_roughness = sample_texture(deref(material).metallic_roughness_image, in_uv).gb;
     }
 
     out_metallic_roughness = f32vec4(metallic_roughness , 0.0f, 1.0f);
@@ -32,17 +32,18 @@ struct GenerateLuminanceHistogramTask {
     };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
         cmd.set_uniform_buffer(context->shader_globals_set_info);
         cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
         cmd.set_pipeline(*context->compute_pipelines.at(PIPELINE_COMPILE_INFO.name));
 
         auto size = ti.get_device().info_image(uses.u_hdr_image.image()).size;
         cmd.dispatch((size.x + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (size.y + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -34,7 +34,8 @@ struct GenerateMinHIZTask {
 
     static daxa::TaskImageView build(Context* context, daxa::TaskGraph& task_graph, daxa::TaskImageView src_depth) {
         const u32vec2 hiz_size = u32vec2{static_cast<u32>(context->shader_global_block.globals.resolution.x / 2), static_cast<u32>(context->shader_global_block.globals.resolution.y / 2)};
-        const u32 mip_count = static_cast<u32>(std::ceil(std::log2(std::max(hiz_size.x, hiz_size.y))));
+        // one dispatch writes at most GENERATE_HIZ_LEVELS_PER_DISPATCH levels, the image gets no levels that nothing fills
+        const u32 mip_count = std::min(static_cast<u32>(std::ceil(std::log2(std::max(hiz_size.x, hiz_size.y)))), static_cast<u32>(GENERATE_HIZ_LEVELS_PER_DISPATCH));
         daxa::TaskImageView hiz = task_graph.create_transient_image({
             .format = daxa::Format::R32_SFLOAT,
             .size = { hiz_size.x, hiz_size.y, 1 },
@@ -45,22 +46,23 @@ struct GenerateMinHIZTask {
         });
 
         using namespace daxa::task_resource_uses;
-        const u32 mips_this_dispatch = std::min(mip_count, static_cast<u32>(GENERATE_HIZ_LEVELS_PER_DISPATCH));
 
         std::vector<daxa::GenericTaskResourceUse> uses = {};
         daxa::TaskImageView src_view = src_depth.view({.base_mip_level = 0});
         uses.push_back(ImageComputeShaderSampled<>{ src_view });
         daxa::TaskImageView dst_views[GENERATE_HIZ_LEVELS_PER_DISPATCH] = { };
-        for (u32 i = 0; i < mips_this_dispatch; ++i) {
+        for (u32 i = 0; i < mip_count; ++i) {
             dst_views[i] = hiz.view({.base_mip_level = i});
             uses.push_back(ImageComputeShaderStorageWriteOnly<>{ dst_views[i] });                                 
         }
 
+        const GPUMetricHandle gpu_metric = context->gpu_metric_pool->get_metric(std::string{GenerateMinHIZTask::NAME});
+
         task_graph.add_task({
             .uses = uses,
             .task = [=](daxa::TaskInterface ti) {
                 auto cmd = ti.get_command_list();
-                context->gpu_metrics[std::string{GenerateMinHIZTask::NAME}]->start(cmd);
+                context->gpu_metric_pool->start(cmd, gpu_metric);
                 cmd.set_uniform_buffer(context->shader_globals_set_info);
                 cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
                 cmd.set_pipeline(*context->compute_pipelines.at(NAME));
@@ -74,18 +76,18 @@ struct GenerateMinHIZTask {
                 GenerateMinHizPush push { 
                     .src = ti.uses[src_view].view(),
                     .mips = {},
-                    .mip_count = mips_this_dispatch,
+                    .mip_count = mip_count,
                     .counter_address = counter_alloc.device_address,
                     .total_workgroup_count = dispatch_x * dispatch_y,
                 };
 
-                for (u32 i = 0; i < mips_this_dispatch; ++i) {
+                for (u32 i = 0; i < mip_count; ++i) {
                     push.mips[i] = ti.uses[dst_views[i]].view();
                 }
 
                 cmd.push_constant(push);
                 cmd.dispatch(dispatch_x, dispatch_y, 1);
-                context->gpu_metrics[std::string{GenerateMinHIZTask::NAME}]->end(cmd);
+                context->gpu_metric_pool->end(cmd, gpu_metric);
             },
             .name = "generate min hiz",
         });
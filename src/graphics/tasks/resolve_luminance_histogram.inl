@@ -29,16 +29,17 @@ struct ResolveLuminanceHistogramTask {
     };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
         cmd.set_uniform_buffer(context->shader_globals_set_info);
         cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
         cmd.set_pipeline(*context->compute_pipelines.at(PIPELINE_COMPILE_INFO.name));
 
         cmd.dispatch(256, 1, 1);
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -40,13 +40,14 @@ struct SSAOBlurTask {
     };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
     f32* bias = {}; 
     f32* radius = {};
     i32* kernel_size = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_target_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_target_image.image()).size.y;
@@ -65,7 +66,7 @@ struct SSAOBlurTask {
         cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
         cmd.draw({ .vertex_count = 3 });
         cmd.end_renderpass();
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -8,10 +8,14 @@
 
 DAXA_DECL_TASK_USES_BEGIN(SunShadowDraw, 2)
 DAXA_TASK_USE_IMAGE(u_depth_image, REGULAR_2D, DEPTH_ATTACHMENT)
+DAXA_TASK_USE_BUFFER(u_draws, daxa_BufferPtr(DrawIndexedIndirect), DRAW_INDIRECT_INFO_READ)
 DAXA_DECL_TASK_USES_END()
 
 struct SunShadowDrawPush {
-    daxa_BufferPtr(Vertex) vertices;
+    daxa_BufferPtr(DrawInstance) instances;
+    daxa_BufferPtr(u32) instance_indices;
+    daxa_BufferPtr(PackedPosition) positions;
+    u32 cascade;
 };
 
 #endif
@@ -19,9 +23,8 @@ struct SunShadowDrawPush {
 
 #if __cplusplus
 #include "../../context.hpp"
-#include "../../ecs/scene.hpp"
-#include "../../ecs/entity.hpp"
-#include "../../ecs/components.hpp"
+#include "../draw_list.hpp"
+#include "../shadow_cascades.hpp"
 
 
 struct SunShadowDrawTask {
@@ -54,11 +57,14 @@ struct SunShadowDrawTask {
     };
 
     Context* context = {};
-    Scene* scene {};
+    GPUMetricHandle gpu_metric = {};
+    DrawList* draw_list = {};
+    // draws into the tile of the cascade and only clears that
+    u32 cascade = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_depth_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_depth_image.image()).size.y;
@@ -69,46 +75,24 @@ struct SunShadowDrawTask {
                 .load_op = daxa::AttachmentLoadOp::CLEAR,
                 .clear_value = daxa::DepthValue{1.0f, 0},
             }},
-            .render_area = {.x = 0, .y = 0, .width = size_x, .height = size_y},
+            .render_area = get_cascade_tile(size_x, size_y, cascade),
         });
 
-        scene->iterate([&](Entity entity){
-            if(entity.has_component<MeshComponent>() && entity.has_component<TransformComponent>()) {
-                cmd.set_uniform_buffer(context->shader_globals_set_info);
-                cmd.set_uniform_buffer(entity.get_component<TransformComponent>().buffer_info);
-                cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
-                cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
-                cmd.set_depth_bias(daxa::DepthBiasInfo { .constant_factor = 1.25f, .clamp = 0.0f, .slope_factor = 1.75f });
-
-                auto& mesh = entity.get_component<MeshComponent>();
-                for(auto& primitive : mesh.model->primitives) {
-                    cmd.push_constant(SunShadowDrawPush {
-                        .vertices = ti.get_device().get_device_address(mesh.model->vertex_buffer),
-                    });
-
-                    if(primitive.index_count > 0) {
-                        cmd.set_index_buffer(mesh.model->index_buffer, 0);
-                        cmd.draw_indexed({
-                            .index_count = primitive.index_count,
-                            .instance_count = 1,
-                            .first_index = primitive.first_index,
-                            .vertex_offset = static_cast<i32>(primitive.first_vertex),
-                            .first_instance = 0,
-                        });
-                    } else {
-                        cmd.draw({
-                            .vertex_count = primitive.vertex_count,
-                            .instance_count = 1,
-                            .first_vertex = primitive.first_vertex,
-                            .first_instance = 0
-                        });
-                    }
-                }
-            }
+        auto* arena = context->geometry_arena.get();
+        cmd.set_uniform_buffer(context->shader_globals_set_info);
+        cmd.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
+        cmd.set_pipeline(*context->raster_pipelines.at(PIPELINE_COMPILE_INFO.name));
+        cmd.set_depth_bias(daxa::DepthBiasInfo { .constant_factor = 1.25f, .clamp = 0.0f, .slope_factor = 1.75f });
+        cmd.push_constant(SunShadowDrawPush {
+            .instances = draw_list->instances_address,
+            .instance_indices = draw_list->get_instance_indices_address(ti.get_device(), uses.u_draws.buffer()),
+            .positions = ti.get_device().get_device_address(arena->position_buffer),
+            .cascade = cascade,
         });
+        draw_list->draw(cmd, arena->index_buffer, uses.u_draws.buffer());
 
         cmd.end_renderpass();
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -121,8 +105,9 @@ DAXA_DECL_PUSH_CONSTANT(SunShadowDrawPush, push)
 #if DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_VERTEX
 
 void main() {    
-    const vec4 vertex_position = vec4(deref(push.vertices[gl_VertexIndex]).position, 1);
-    gl_Position = globals.sun_info.projection_matrix * globals.sun_info.view_matrix * transform.model_matrix * vertex_position;
+    const daxa_BufferPtr(DrawInstance) instance = push.instances[deref(push.instance_indices[gl_InstanceIndex])];
+    const vec4 vertex_position = vec4(unpack_position(deref(push.positions[gl_VertexIndex]), deref(instance).position_min, deref(instance).position_scale), 1);
+    gl_Position = globals.sun_info.cascades[push.cascade].projection_view_matrix * deref(instance).model_matrix * vertex_position;
 }
 
 #elif DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_FRAGMENT
@@ -15,6 +15,7 @@ DAXA_DECL_TASK_USES_END()
 
 struct SunShadowDrawTerrainPush {
     TextureId texture_heightmap;
+    u32 cascade;
 };
 
 #endif
@@ -22,6 +23,7 @@ struct SunShadowDrawTerrainPush {
 #if __cplusplus
 #include "../../context.hpp"
 #include "../texture.hpp"
+#include "../shadow_cascades.hpp"
 
 
 struct SunShadowDrawTerrainTask {
@@ -62,12 +64,15 @@ struct SunShadowDrawTerrainTask {
     };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
     u32 terrain_index_size = {};
     Texture* terrain_heightmap = {};
+    // draws on top of the casters of the cascade in its tile
+    u32 cascade = {};
     
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_depth_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_depth_image.image()).size.y;
@@ -78,7 +83,7 @@ struct SunShadowDrawTerrainTask {
                 .load_op = daxa::AttachmentLoadOp::LOAD,
                 .clear_value = daxa::DepthValue{1.0f, 0},
             }},
-            .render_area = {.x = 0, .y = 0, .width = size_x, .height = size_y},
+            .render_area = get_cascade_tile(size_x, size_y, cascade),
         });
 
         cmd.set_uniform_buffer(context->shader_globals_set_info);
@@ -87,11 +92,12 @@ struct SunShadowDrawTerrainTask {
         cmd.set_index_buffer(uses.u_indices.buffer(), 0);
         cmd.push_constant(SunShadowDrawTerrainPush { 
             .texture_heightmap = terrain_heightmap->get_texture_id(),
+            .cascade = cascade,
         });
         cmd.draw_indexed({ .index_count =  terrain_index_size });
 
         cmd.end_renderpass();
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -109,7 +115,7 @@ layout(location = 0) out f32vec2 out_uv;
 void main() {   
     const f32vec2 uv = deref(u_vertices[gl_VertexIndex]);
     out_uv = uv;
-    gl_Position = globals.sun_info.projection_view_matrix * f32vec4(uv.x * globals.terrain_scale.x, 0.0, uv.y * globals.terrain_scale.y, 1.0);
+    gl_Position = globals.sun_info.cascades[push.cascade].projection_view_matrix * f32vec4(uv.x * globals.terrain_scale.x, 0.0, uv.y * globals.terrain_scale.y, 1.0);
 }
 
 #elif DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_TESSELATION_CONTROL
@@ -155,7 +161,7 @@ void main() {
     const f32 sampled_height = texture(daxa_sampler2D(push.texture_heightmap.image_id, globals.linear_sampler), f32vec2(out_uv.xy)).r;
     const f32 adjusted_height = (sampled_height - globals.terrain_midpoint) * globals.terrain_height_scale;
 
-    gl_Position += globals.sun_info.terrain_y_clip_trick * adjusted_height;
+    gl_Position += globals.sun_info.cascades[push.cascade].terrain_y_clip_trick * adjusted_height;
 }
 
 #elif DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_FRAGMENT
@@ -17,11 +17,11 @@ struct CopyImageTask {
     DAXA_USE_TASK_HEADER(CopyImage)
 
     Context* context = {};
-    std::string type = {};
+    GPUMetricHandle gpu_metric = {};
 
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name + " - " + type]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_target_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_target_image.image()).size.y;
@@ -32,7 +32,7 @@ struct CopyImageTask {
             .extent = { size_x, size_y, 1 }
         });
 
-        context->gpu_metrics[name + " - " + type]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 #endif
@@ -85,10 +85,11 @@ struct TemporalAntiAliasingTask {
     // };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
 
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_target_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_target_image.image()).size.y;
@@ -111,7 +112,7 @@ struct TemporalAntiAliasingTask {
         // cmd.set_pipeline(*context->compute_pipelines.at(PIPELINE_COMPILE_INFO.name));
         // cmd.dispatch((size_x + 8 - 1) / 8, (size_x + 4 - 1) / 4, 1); 
 
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 
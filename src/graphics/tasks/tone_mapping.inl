@@ -42,10 +42,11 @@ struct ToneMappingTask {
     };
 
     Context* context = {};
+    GPUMetricHandle gpu_metric = {};
 
     void callback(daxa::TaskInterface ti) {
         auto cmd = ti.get_command_list();
-        context->gpu_metrics[name]->start(cmd);
+        context->gpu_metric_pool->start(cmd, gpu_metric);
 
         u32 size_x = ti.get_device().info_image(uses.u_target_image.image()).size.x;
         u32 size_y = ti.get_device().info_image(uses.u_target_image.image()).size.y;
@@ -65,7 +66,7 @@ struct ToneMappingTask {
         cmd.draw({ .vertex_count = 3 });
         cmd.end_renderpass();
 
-        context->gpu_metrics[name]->end(cmd);
+        context->gpu_metric_pool->end(cmd, gpu_metric);
     }
 };
 
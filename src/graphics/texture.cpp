@@ -1,4 +1,8 @@
 #include "texture.hpp"
+#include "texture_container.hpp"
+#include "upload_service.hpp"
+#include "sampler_cache.hpp"
+#include "utils/profiler.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -18,10 +22,33 @@ using namespace OPENEXR_IMF_NAMESPACE;
 using namespace IMATH_NAMESPACE;
 
 
+namespace {
+    // max_lod isnt clamped to the mip count so every texture can share the same sampler
+    auto texture_sampler_info() -> daxa::SamplerInfo {
+        return daxa::SamplerInfo {
+            .magnification_filter = daxa::Filter::LINEAR,
+            .minification_filter = daxa::Filter::LINEAR,
+            .mipmap_filter = daxa::Filter::LINEAR,
+            .address_mode_u = daxa::SamplerAddressMode::REPEAT,
+            .address_mode_v = daxa::SamplerAddressMode::REPEAT,
+            .address_mode_w = daxa::SamplerAddressMode::REPEAT,
+            .mip_lod_bias = 0.0f,
+            .enable_anisotropy = true,
+            .max_anisotropy = 16.0f,
+            .enable_compare = false,
+            .compare_op = daxa::CompareOp::ALWAYS,
+            .min_lod = 0.0f,
+            .max_lod = 1000.0f,
+            .enable_unnormalized_coordinates = false,
+            .name = "texture sampler",
+        };
+    }
+}
+
 Texture::~Texture() {
+    // the sampler belongs to the sampler cache
     if(!dont_destroy) {
         device.destroy_image(this->image_id);
-        device.destroy_sampler(this->sampler_id);
     }
 }
 
@@ -29,43 +56,42 @@ auto Texture::get_texture_id() -> TextureId {
     return TextureId { .image_id = image_id.default_view(), .sampler_id = sampler_id };
 }
 
-Texture::Texture(daxa::Device& _device, u32 size_x, u32 size_y, u32 channels, u8* data, daxa::Format format, daxa::ImageUsageFlags flags) : device{_device} {
-    auto payload = load_texture(device, size_x, size_y, channels, data, DeAllocType::STB, format, flags);
+Texture::Texture(UploadService& upload_service, SamplerCache& sampler_cache, u32 size_x, u32 size_y, u32 channels, u8* data, daxa::Format format, daxa::ImageUsageFlags flags) : device{upload_service.device} {
+    auto payload = load_texture(upload_service, sampler_cache, size_x, size_y, channels, data, DeAllocType::STB, format, flags);
     payload.texture->dont_destroy = true;
 
-    device.submit_commands({ .command_lists = { payload.command_list }});
-    device.wait_idle();
+    upload_service.wait(payload.upload_value);
 
     image_id = payload.texture->image_id;
     sampler_id = payload.texture->sampler_id;
     image_dimension = payload.texture->image_dimension;
 }
 
-Texture::Texture(daxa::Device& _device, u8* data, u32 size, daxa::Format format, daxa::ImageUsageFlags flags) : device{_device} {
-    auto payload = load_texture(device, data, size, format, flags);
+Texture::Texture(UploadService& upload_service, SamplerCache& sampler_cache, u8* data, u32 size, daxa::Format format, daxa::ImageUsageFlags flags) : device{upload_service.device} {
+    auto payload = load_texture(upload_service, sampler_cache, data, size, format, flags);
     payload.texture->dont_destroy = true;
 
-    device.submit_commands({ .command_lists = { payload.command_list }});
-    device.wait_idle();
+    upload_service.wait(payload.upload_value);
 
     image_id = payload.texture->image_id;
     sampler_id = payload.texture->sampler_id;
     image_dimension = payload.texture->image_dimension;
 }
 
-Texture::Texture(daxa::Device& _device, const std::string_view& file_path, daxa::Format format, daxa::ImageUsageFlags flags) : device{_device} {
-    auto payload = load_texture(device, file_path, format, flags);
+Texture::Texture(UploadService& upload_service, SamplerCache& sampler_cache, const std::string_view& file_path, daxa::Format format, daxa::ImageUsageFlags flags) : device{upload_service.device} {
+    auto payload = load_texture(upload_service, sampler_cache, file_path, format, flags);
     payload.texture->dont_destroy = true;
 
-    device.submit_commands({ .command_lists = { payload.command_list }});
-    device.wait_idle();
+    upload_service.wait(payload.upload_value);
 
     image_id = payload.texture->image_id;
     sampler_id = payload.texture->sampler_id;
     image_dimension = payload.texture->image_dimension;
 }
 
-auto Texture::load_texture(daxa::Device& device, u32 size_x, u32 size_y, u32 channels, u8* data, DeAllocType dealloc_memory, daxa::Format format, daxa::ImageUsageFlags flags) -> Texture::PayLoad {
+auto Texture::load_texture(UploadService& upload_service, SamplerCache& sampler_cache, u32 size_x, u32 size_y, u32 channels, u8* data, DeAllocType dealloc_memory, daxa::Format format, daxa::ImageUsageFlags flags) -> Texture::PayLoad {
+    PROFILE_SCOPE("Texture::load_texture upload");
+    auto& device = upload_service.device;
     u8* image_data = data;
     bool deallocate_image_data = false;
     u32 bytes_per_channel = 1;
@@ -118,150 +144,118 @@ auto Texture::load_texture(daxa::Device& device, u32 size_x, u32 size_y, u32 cha
         .allocate_info = daxa::MemoryFlagBits::DEDICATED_MEMORY
     });
 
-    daxa::SamplerId sampler_id = device.create_sampler({
-        .magnification_filter = daxa::Filter::LINEAR,
-        .minification_filter = daxa::Filter::LINEAR,
-        .mipmap_filter = daxa::Filter::LINEAR,
-        .address_mode_u = daxa::SamplerAddressMode::REPEAT,
-        .address_mode_v = daxa::SamplerAddressMode::REPEAT,
-        .address_mode_w = daxa::SamplerAddressMode::REPEAT,
-        .mip_lod_bias = 0.0f,
-        .enable_anisotropy = true,
-        .max_anisotropy = 16.0f,
-        .enable_compare = false,
-        .compare_op = daxa::CompareOp::ALWAYS,
-        .min_lod = 0.0f,
-        .max_lod = static_cast<f32>(mip_levels),
-        .enable_unnormalized_coordinates = false,
-    });
-
-    daxa::BufferId staging_buffer = device.create_buffer({
-        .size = size_x * size_y * bytes_per_channel * channels,
-        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-        .name = "staging buffer"
-    });
+    daxa::SamplerId sampler_id = sampler_cache.get(texture_sampler_info());
 
-    auto* buffer_ptr = device.get_host_address_as<u8>(staging_buffer);
-    std::memcpy(buffer_ptr, image_data, size_x * size_y * bytes_per_channel * channels);
-
-    daxa::CommandList cmd_list = device.create_command_list({.name = "upload command list"});
-
-    cmd_list.pipeline_barrier_image_transition({
-        .src_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
-        .dst_access = daxa::AccessConsts::READ_WRITE,
-        .src_layout = daxa::ImageLayout::UNDEFINED,
-        .dst_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
-        .image_slice = {
-            .base_mip_level = 0,
-            .level_count = mip_levels,
-            .base_array_layer = 0,
-            .layer_count = 1,
-        },
-        .image_id = image_id,
-    });
-
-    cmd_list.copy_buffer_to_image({
-        .buffer = staging_buffer,
-        .buffer_offset = 0,
-        .image = image_id,
-        .image_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
-        .image_slice = {
-            .mip_level = 0,
-            .base_array_layer = 0,
-            .layer_count = 1,
-        },
-        .image_offset = { 0, 0, 0 },
-        .image_extent = { static_cast<u32>(size_x), static_cast<u32>(size_y), 1 }
-    });
-
-    cmd_list.pipeline_barrier({
-        .src_access = daxa::AccessConsts::HOST_WRITE,
-        .dst_access = daxa::AccessConsts::TRANSFER_READ,
-    });
-
-    auto image_info = device.info_image(image_id);
-
-    std::array<i32, 3> mip_size = {
-        static_cast<i32>(image_info.size.x),
-        static_cast<i32>(image_info.size.y),
-        static_cast<i32>(image_info.size.z),
-    };
-
-    for(u32 i = 1; i < image_info.mip_level_count; i++) {
+    // the bytes are copied into staging memory right here, so the decoded image can be freed before the upload is flushed
+    std::span<const u8> image_bytes = {image_data, static_cast<usize>(size_x) * size_y * bytes_per_channel * channels};
+    u64 upload_value = upload_service.upload({image_bytes}, [image_id, mip_levels, size_x, size_y](daxa::CommandList& cmd_list, daxa::BufferId staging_buffer, u64 staging_offset) {
         cmd_list.pipeline_barrier_image_transition({
-            .src_access = daxa::AccessConsts::TRANSFER_WRITE,
-            .dst_access = daxa::AccessConsts::BLIT_READ,
-            .src_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
-            .dst_layout = daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
+            .src_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
+            .dst_access = daxa::AccessConsts::READ_WRITE,
+            .src_layout = daxa::ImageLayout::UNDEFINED,
+            .dst_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
             .image_slice = {
-                .base_mip_level = i - 1,
-                .level_count = 1,
+                .base_mip_level = 0,
+                .level_count = mip_levels,
                 .base_array_layer = 0,
                 .layer_count = 1,
             },
             .image_id = image_id,
         });
 
-        std::array<i32, 3> next_mip_size = {
-            std::max<i32>(1, mip_size[0] / 2),
-            std::max<i32>(1, mip_size[1] / 2),
-            std::max<i32>(1, mip_size[2] / 2),
-        };
-
-        cmd_list.blit_image_to_image({
-            .src_image = image_id,
-            .src_image_layout = daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
-            .dst_image = image_id,
-            .dst_image_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
-            .src_slice = {
-                .mip_level = i - 1,
-                .base_array_layer = 0,
-                .layer_count = 1,
-            },
-            .src_offsets = {{{0, 0, 0}, {mip_size[0], mip_size[1], mip_size[2]}}},
-            .dst_slice = {
-                .mip_level = i,
+        cmd_list.copy_buffer_to_image({
+            .buffer = staging_buffer,
+            .buffer_offset = static_cast<usize>(staging_offset),
+            .image = image_id,
+            .image_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+            .image_slice = {
+                .mip_level = 0,
                 .base_array_layer = 0,
                 .layer_count = 1,
             },
-            .dst_offsets = {{{0, 0, 0}, {next_mip_size[0], next_mip_size[1], next_mip_size[2]}}},
-            .filter = daxa::Filter::LINEAR,
+            .image_offset = { 0, 0, 0 },
+            .image_extent = { static_cast<u32>(size_x), static_cast<u32>(size_y), 1 }
         });
 
+        std::array<i32, 3> mip_size = {
+            static_cast<i32>(size_x),
+            static_cast<i32>(size_y),
+            1,
+        };
+
+        for(u32 i = 1; i < mip_levels; i++) {
+            cmd_list.pipeline_barrier_image_transition({
+                .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+                .dst_access = daxa::AccessConsts::BLIT_READ,
+                .src_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+                .dst_layout = daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
+                .image_slice = {
+                    .base_mip_level = i - 1,
+                    .level_count = 1,
+                    .base_array_layer = 0,
+                    .layer_count = 1,
+                },
+                .image_id = image_id,
+            });
+
+            std::array<i32, 3> next_mip_size = {
+                std::max<i32>(1, mip_size[0] / 2),
+                std::max<i32>(1, mip_size[1] / 2),
+                std::max<i32>(1, mip_size[2] / 2),
+            };
+
+            cmd_list.blit_image_to_image({
+                .src_image = image_id,
+                .src_image_layout = daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
+                .dst_image = image_id,
+                .dst_image_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+                .src_slice = {
+                    .mip_level = i - 1,
+                    .base_array_layer = 0,
+                    .layer_count = 1,
+                },
+                .src_offsets = {{{0, 0, 0}, {mip_size[0], mip_size[1], mip_size[2]}}},
+                .dst_slice = {
+                    .mip_level = i,
+                    .base_array_layer = 0,
+                    .layer_count = 1,
+                },
+                .dst_offsets = {{{0, 0, 0}, {next_mip_size[0], next_mip_size[1], next_mip_size[2]}}},
+                .filter = daxa::Filter::LINEAR,
+            });
+
+            cmd_list.pipeline_barrier_image_transition({
+                .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+                .dst_access = daxa::AccessConsts::BLIT_READ,
+                .src_layout = daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
+                .dst_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                .image_slice = {
+                    .base_mip_level = i - 1,
+                    .level_count = 1,
+                    .base_array_layer = 0,
+                    .layer_count = 1,
+                },
+                .image_id = image_id,
+            });
+
+            mip_size = next_mip_size;
+        }
+
         cmd_list.pipeline_barrier_image_transition({
-            .src_access = daxa::AccessConsts::TRANSFER_WRITE,
-            .dst_access = daxa::AccessConsts::BLIT_READ,
-            .src_layout = daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
+            .src_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
+            .dst_access = daxa::AccessConsts::READ_WRITE,
+            .src_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
             .dst_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
             .image_slice = {
-                .base_mip_level = i - 1,
+                .base_mip_level = mip_levels - 1,
                 .level_count = 1,
                 .base_array_layer = 0,
                 .layer_count = 1,
             },
             .image_id = image_id,
         });
-        
-        mip_size = next_mip_size;
-    }
-
-    cmd_list.pipeline_barrier_image_transition({
-        .src_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
-        .dst_access = daxa::AccessConsts::READ_WRITE,
-        .src_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
-        .dst_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
-        .image_slice = {
-            .base_mip_level = image_info.mip_level_count - 1,
-            .level_count = 1,
-            .base_array_layer = 0,
-            .layer_count = 1,
-        },
-        .image_id = image_id,
     });
 
-    cmd_list.destroy_buffer_deferred(staging_buffer);
-    cmd_list.complete();
-
     if(deallocate_image_data) { delete[] image_data; }
     if(dealloc_memory == DeAllocType::STB) {
         stbi_image_free(data);
@@ -277,10 +271,11 @@ auto Texture::load_texture(daxa::Device& device, u32 size_x, u32 size_y, u32 cha
     tex->sampler_id = sampler_id;
     tex->image_dimension = { size_x, size_y };
 
-    return { .texture = std::move(tex), .command_list = cmd_list };
+    return { .texture = std::move(tex), .upload_value = upload_value };
 }
 
-auto Texture::load_texture(daxa::Device& device, u8* data, u32 size, daxa::Format format, daxa::ImageUsageFlags flags) -> Texture::PayLoad {
+auto Texture::load_texture(UploadService& upload_service, SamplerCache& sampler_cache, u8* data, u32 size, daxa::Format format, daxa::ImageUsageFlags flags) -> Texture::PayLoad {
+    PROFILE_SCOPE("Texture::load_texture decode");
     i32 size_x = 0;
     i32 size_y = 0;
     i32 num_channels = 0;
@@ -289,7 +284,7 @@ auto Texture::load_texture(daxa::Device& device, u8* data, u32 size, daxa::Forma
         throw std::runtime_error("Textures couldn't be loaded from memory");
     }
 
-    return load_texture(device, static_cast<u32>(size_x), static_cast<u32>(size_y), static_cast<u32>(num_channels), loaded_data, DeAllocType::STB, format, flags);
+    return load_texture(upload_service, sampler_cache, static_cast<u32>(size_x), static_cast<u32>(size_y), static_cast<u32>(num_channels), loaded_data, DeAllocType::STB, format, flags);
 }
 
 struct CreateStagingBufferInfo {
@@ -409,7 +404,9 @@ auto load_texture_data(CreateStagingBufferInfo & info) -> u8* {
     return reinterpret_cast<u8*>(data);
 }
 
-auto Texture::load_texture(daxa::Device& device, const std::string_view& file_path, daxa::Format format, daxa::ImageUsageFlags flags) -> Texture::PayLoad {    
+auto Texture::load_texture(UploadService& upload_service, SamplerCache& sampler_cache, const std::string_view& file_path, daxa::Format format, daxa::ImageUsageFlags flags) -> Texture::PayLoad {    
+    PROFILE_SCOPE("Texture::load_texture file");
+    auto& device = upload_service.device;
     std::string extension = std::filesystem::path{file_path.data()}.extension().string();
 
     i32 size_x = 0;
@@ -418,7 +415,9 @@ auto Texture::load_texture(daxa::Device& device, const std::string_view& file_pa
     u8* data = nullptr;
     DeAllocType de_alloc_type = DeAllocType::NONE;
 
-    if(extension == ".jpg" || extension == ".png") {
+    if(extension == TextureContainer::EXTENSION) {
+        return load_texture(upload_service, sampler_cache, TextureContainer{std::filesystem::path{file_path}}, flags);
+    } else if(extension == ".jpg" || extension == ".png") {
         data = stbi_load(file_path.data(), &size_x, &size_y, &num_channels, 4);
         num_channels = 4;
         de_alloc_type = DeAllocType::STB;
@@ -482,5 +481,83 @@ auto Texture::load_texture(daxa::Device& device, const std::string_view& file_pa
     }
     
 
-    return load_texture(device, static_cast<u32>(size_x), static_cast<u32>(size_y), static_cast<u32>(num_channels), data, de_alloc_type, format, flags);
-}
\ No newline at end of file
+    return load_texture(upload_service, sampler_cache, static_cast<u32>(size_x), static_cast<u32>(size_y), static_cast<u32>(num_channels), data, de_alloc_type, format, flags);
+}
+
+auto Texture::load_texture(UploadService& upload_service, SamplerCache& sampler_cache, const TextureContainer& container, daxa::ImageUsageFlags flags) -> Texture::PayLoad {
+    PROFILE_SCOPE("Texture::load_texture container");
+    auto& device = upload_service.device;
+    const auto& header = container.get_header();
+    auto mips = container.get_mips();
+    auto data = container.get_data();
+
+    daxa::ImageId image_id = device.create_image({
+        .dimensions = 2,
+        .format = static_cast<daxa::Format>(header.format),
+        .size = { header.size_x, header.size_y, 1 },
+        .mip_level_count = header.mip_level_count,
+        .array_layer_count = 1,
+        .sample_count = 1,
+        .usage = daxa::ImageUsageFlagBits::SHADER_SAMPLED | daxa::ImageUsageFlagBits::TRANSFER_DST | flags,
+        .allocate_info = daxa::MemoryFlagBits::DEDICATED_MEMORY
+    });
+
+    daxa::SamplerId sampler_id = sampler_cache.get(texture_sampler_info());
+
+    // the whole mip chain is staged as one block, mip offsets in the container are relative to its start
+    std::vector<TextureContainerMip> mip_regions{mips.begin(), mips.end()};
+    u32 mip_level_count = header.mip_level_count;
+    u64 upload_value = upload_service.upload({data}, [image_id, mip_regions = std::move(mip_regions), mip_level_count](daxa::CommandList& cmd_list, daxa::BufferId staging_buffer, u64 staging_offset) {
+        cmd_list.pipeline_barrier_image_transition({
+            .src_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
+            .dst_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .src_layout = daxa::ImageLayout::UNDEFINED,
+            .dst_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+            .image_slice = {
+                .base_mip_level = 0,
+                .level_count = mip_level_count,
+                .base_array_layer = 0,
+                .layer_count = 1,
+            },
+            .image_id = image_id,
+        });
+
+        for(u32 i = 0; i < mip_level_count; i++) {
+            cmd_list.copy_buffer_to_image({
+                .buffer = staging_buffer,
+                .buffer_offset = static_cast<usize>(staging_offset + mip_regions[i].data_offset),
+                .image = image_id,
+                .image_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+                .image_slice = {
+                    .mip_level = i,
+                    .base_array_layer = 0,
+                    .layer_count = 1,
+                },
+                .image_offset = { 0, 0, 0 },
+                .image_extent = { mip_regions[i].size_x, mip_regions[i].size_y, 1 }
+            });
+        }
+
+        cmd_list.pipeline_barrier_image_transition({
+            .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .dst_access = daxa::AccessConsts::READ_WRITE,
+            .src_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+            .dst_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+            .image_slice = {
+                .base_mip_level = 0,
+                .level_count = mip_level_count,
+                .base_array_layer = 0,
+                .layer_count = 1,
+            },
+            .image_id = image_id,
+        });
+    });
+
+    auto tex = std::make_unique<Texture>();
+    tex->device = device;
+    tex->image_id = image_id;
+    tex->sampler_id = sampler_id;
+    tex->image_dimension = { header.size_x, header.size_y };
+
+    return { .texture = std::move(tex), .upload_value = upload_value };
+}
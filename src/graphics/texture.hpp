@@ -2,10 +2,15 @@
 
 #include "pch.hpp"
 
+struct TextureContainer;
+struct UploadService;
+struct SamplerCache;
+
 struct Texture {
     struct PayLoad {
         std::unique_ptr<Texture> texture;
-        daxa::CommandList command_list;
+        // the texture can be used once the upload service completed this value
+        u64 upload_value;
     };
 
     enum struct DeAllocType: u32 {
@@ -19,13 +24,14 @@ struct Texture {
 
     auto get_texture_id() -> TextureId;
 
-    Texture(daxa::Device& _device, u32 size_x, u32 size_y, u32 channels, u8* data, daxa::Format format, daxa::ImageUsageFlags flags = {});
-    Texture(daxa::Device& _device, u8* data, u32 size, daxa::Format format, daxa::ImageUsageFlags flags = {});
-    Texture(daxa::Device& _device, const std::string_view& file_path, daxa::Format format, daxa::ImageUsageFlags flags = {});
+    Texture(UploadService& upload_service, SamplerCache& sampler_cache, u32 size_x, u32 size_y, u32 channels, u8* data, daxa::Format format, daxa::ImageUsageFlags flags = {});
+    Texture(UploadService& upload_service, SamplerCache& sampler_cache, u8* data, u32 size, daxa::Format format, daxa::ImageUsageFlags flags = {});
+    Texture(UploadService& upload_service, SamplerCache& sampler_cache, const std::string_view& file_path, daxa::Format format, daxa::ImageUsageFlags flags = {});
 
-    static auto load_texture(daxa::Device& device, u32 size_x, u32 size_y, u32 channels, u8* data, DeAllocType dealloc_memory, daxa::Format format, daxa::ImageUsageFlags flags = {}) -> PayLoad;
-    static auto load_texture(daxa::Device& device, u8* data, u32 size, daxa::Format format, daxa::ImageUsageFlags flags = {}) -> PayLoad;
-    static auto load_texture(daxa::Device& device, const std::string_view& file_path, daxa::Format format, daxa::ImageUsageFlags flags = {}) -> PayLoad;
+    static auto load_texture(UploadService& upload_service, SamplerCache& sampler_cache, u32 size_x, u32 size_y, u32 channels, u8* data, DeAllocType dealloc_memory, daxa::Format format, daxa::ImageUsageFlags flags = {}) -> PayLoad;
+    static auto load_texture(UploadService& upload_service, SamplerCache& sampler_cache, u8* data, u32 size, daxa::Format format, daxa::ImageUsageFlags flags = {}) -> PayLoad;
+    static auto load_texture(UploadService& upload_service, SamplerCache& sampler_cache, const std::string_view& file_path, daxa::Format format, daxa::ImageUsageFlags flags = {}) -> PayLoad;
+    static auto load_texture(UploadService& upload_service, SamplerCache& sampler_cache, const TextureContainer& container, daxa::ImageUsageFlags flags = {}) -> PayLoad;
 
     daxa::Device device;
     daxa::ImageId image_id;
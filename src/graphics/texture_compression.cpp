@@ -0,0 +1,341 @@
+#include "texture_compression.hpp"
+
+#include "utils/threadpool.hpp"
+#include "utils/profiler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURE_COMPRESSION_SSE2
+#endif
+
+namespace {
+    constexpr u64 DATA_ALIGNMENT = 16;
+    constexpr u32 BLOCK_ROWS_PER_TASK = 8;
+    constexpr std::array<u32, 16> BC7_WEIGHTS = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    auto align_up(u64 value) -> u64 {
+        return (value + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+    }
+
+    template<usize COUNT>
+    using Palette = std::array<std::array<f32, COUNT>, 4>;
+
+    // index of the palette entry closest to the texel, the palette is stored channel planar so four entries are compared at once
+    template<usize COUNT>
+    auto find_closest(const Palette<COUNT>& palette, const u8* texel, u32 channel_count) -> u32 {
+        std::array<f32, COUNT> errors = {};
+#if defined(TEXTURE_COMPRESSION_SSE2)
+        for(usize i = 0; i < COUNT; i += 4) {
+            __m128 error = _mm_setzero_ps();
+            for(u32 c = 0; c < channel_count; c++) {
+                __m128 difference = _mm_sub_ps(_mm_loadu_ps(&palette[c][i]), _mm_set1_ps(static_cast<f32>(texel[c])));
+                error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+            }
+            _mm_storeu_ps(&errors[i], error);
+        }
+#else
+        for(usize i = 0; i < COUNT; i++) {
+            for(u32 c = 0; c < channel_count; c++) {
+                f32 difference = palette[c][i] - static_cast<f32>(texel[c]);
+                errors[i] += difference * difference;
+            }
+        }
+#endif
+        return static_cast<u32>(std::min_element(errors.begin(), errors.end()) - errors.begin());
+    }
+
+    // end points of the line through the block along its principal axis, only the first CHANNELS channels are fitted
+    template<u32 CHANNELS>
+    auto fit_endpoints(const u8* texels) -> std::pair<std::array<f32, 4>, std::array<f32, 4>> {
+        std::array<f32, CHANNELS> mean = {};
+        for(u32 i = 0; i < 16; i++) {
+            for(u32 c = 0; c < CHANNELS; c++) { mean[c] += static_cast<f32>(texels[i * 4 + c]) / 16.0f; }
+        }
+
+        std::array<f32, CHANNELS * CHANNELS> covariance = {};
+        for(u32 i = 0; i < 16; i++) {
+            for(u32 a = 0; a < CHANNELS; a++) {
+                for(u32 b = 0; b < CHANNELS; b++) {
+                    covariance[a * CHANNELS + b] += (static_cast<f32>(texels[i * 4 + a]) - mean[a]) * (static_cast<f32>(texels[i * 4 + b]) - mean[b]);
+                }
+            }
+        }
+
+        // power iteration, seeded with the row of the channel that varies the most
+        u32 widest = 0;
+        for(u32 c = 1; c < CHANNELS; c++) {
+            if(covariance[c * CHANNELS + c] > covariance[widest * CHANNELS + widest]) { widest = c; }
+        }
+
+        std::array<f32, CHANNELS> axis = {};
+        for(u32 c = 0; c < CHANNELS; c++) { axis[c] = covariance[widest * CHANNELS + c]; }
+        for(u32 iteration = 0; iteration < 8; iteration++) {
+            std::array<f32, CHANNELS> next = {};
+            for(u32 a = 0; a < CHANNELS; a++) {
+                for(u32 b = 0; b < CHANNELS; b++) { next[a] += covariance[a * CHANNELS + b] * axis[b]; }
+            }
+
+            f32 length = 0.0f;
+            for(u32 c = 0; c < CHANNELS; c++) { length += next[c] * next[c]; }
+            if(length < 1e-8f) { break; }
+            for(u32 c = 0; c < CHANNELS; c++) { axis[c] = next[c] / std::sqrt(length); }
+        }
+
+        f32 min_t = 0.0f;
+        f32 max_t = 0.0f;
+        for(u32 i = 0; i < 16; i++) {
+            f32 t = 0.0f;
+            for(u32 c = 0; c < CHANNELS; c++) { t += (static_cast<f32>(texels[i * 4 + c]) - mean[c]) * axis[c]; }
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+
+        std::array<f32, 4> low = {};
+        std::array<f32, 4> high = {};
+        for(u32 c = 0; c < CHANNELS; c++) {
+            low[c] = std::clamp(mean[c] + axis[c] * min_t, 0.0f, 255.0f);
+            high[c] = std::clamp(mean[c] + axis[c] * max_t, 0.0f, 255.0f);
+        }
+
+        return { low, high };
+    }
+
+    struct BlockWriter {
+        std::array<u8, 16> bytes = {};
+        u32 position = 0;
+
+        void write(u32 value, u32 bit_count) {
+            for(u32 bit = 0; bit < bit_count; bit++, position++) {
+                if((value >> bit) & 1u) { bytes[position / 8] = static_cast<u8>(bytes[position / 8] | (1u << (position % 8))); }
+            }
+        }
+    };
+
+    void load_block(const u8* rgba, u32 size_x, u32 size_y, u32 block_x, u32 block_y, u8* texels) {
+        for(u32 y = 0; y < 4; y++) {
+            u32 source_y = std::min(block_y * 4 + y, size_y - 1);
+            for(u32 x = 0; x < 4; x++) {
+                u32 source_x = std::min(block_x * 4 + x, size_x - 1);
+                std::memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<usize>(source_y) * size_x + source_x) * 4, 4);
+            }
+        }
+    }
+
+    void encode_block(daxa::Format format, const u8* texels, u8* output) {
+        switch(format) {
+            case daxa::Format::BC1_RGB_UNORM_BLOCK:
+            case daxa::Format::BC1_RGB_SRGB_BLOCK: encode_bc1_block(texels, output); break;
+            case daxa::Format::BC4_UNORM_BLOCK: encode_bc4_block(texels, 0, output); break;
+            case daxa::Format::BC5_UNORM_BLOCK: encode_bc5_block(texels, output); break;
+            case daxa::Format::BC7_UNORM_BLOCK:
+            case daxa::Format::BC7_SRGB_BLOCK: encode_bc7_block(texels, output); break;
+            default: break;
+        }
+    }
+}
+
+auto get_block_size(daxa::Format format) -> u32 {
+    switch(format) {
+        case daxa::Format::BC1_RGB_UNORM_BLOCK:
+        case daxa::Format::BC1_RGB_SRGB_BLOCK:
+        case daxa::Format::BC4_UNORM_BLOCK: return 8;
+        case daxa::Format::BC5_UNORM_BLOCK:
+        case daxa::Format::BC7_UNORM_BLOCK:
+        case daxa::Format::BC7_SRGB_BLOCK: return 16;
+        default: return 0;
+    }
+}
+
+void encode_bc1_block(const u8* texels, u8* output) {
+    auto [low, high] = fit_endpoints<3>(texels);
+
+    auto to_565 = [](const std::array<f32, 4>& color) -> u16 {
+        u32 r = static_cast<u32>(std::lround(color[0] * 31.0f / 255.0f));
+        u32 g = static_cast<u32>(std::lround(color[1] * 63.0f / 255.0f));
+        u32 b = static_cast<u32>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<u16>((r << 11) | (g << 5) | b);
+    };
+
+    // color_0 > color_1 selects the four color mode
+    u16 color_0 = to_565(high);
+    u16 color_1 = to_565(low);
+    if(color_0 < color_1) { std::swap(color_0, color_1); }
+
+    u32 indices = 0;
+    if(color_0 != color_1) {
+        Palette<4> palette = {};
+        for(u32 i = 0; i < 2; i++) {
+            u32 color = i == 0 ? color_0 : color_1;
+            u32 r = (color >> 11) & 31u;
+            u32 g = (color >> 5) & 63u;
+            u32 b = color & 31u;
+            palette[0][i] = static_cast<f32>((r << 3) | (r >> 2));
+            palette[1][i] = static_cast<f32>((g << 2) | (g >> 4));
+            palette[2][i] = static_cast<f32>((b << 3) | (b >> 2));
+        }
+
+        for(u32 c = 0; c < 3; c++) {
+            palette[c][2] = (2.0f * palette[c][0] + palette[c][1]) / 3.0f;
+            palette[c][3] = (palette[c][0] + 2.0f * palette[c][1]) / 3.0f;
+        }
+
+        for(u32 i = 0; i < 16; i++) {
+            indices |= find_closest(palette, texels + i * 4, 3) << (i * 2);
+        }
+    }
+
+    std::memcpy(output, &color_0, sizeof(u16));
+    std::memcpy(output + 2, &color_1, sizeof(u16));
+    std::memcpy(output + 4, &indices, sizeof(u32));
+}
+
+void encode_bc4_block(const u8* texels, u32 channel, u8* output) {
+    u8 min_value = 255;
+    u8 max_value = 0;
+    for(u32 i = 0; i < 16; i++) {
+        min_value = std::min(min_value, texels[i * 4 + channel]);
+        max_value = std::max(max_value, texels[i * 4 + channel]);
+    }
+
+    // red_0 > red_1 selects the eight value mode
+    output[0] = max_value;
+    output[1] = min_value;
+
+    u64 indices = 0;
+    if(max_value > min_value) {
+        Palette<8> palette = {};
+        palette[0][0] = static_cast<f32>(max_value);
+        palette[0][1] = static_cast<f32>(min_value);
+        for(u32 i = 2; i < 8; i++) {
+            palette[0][i] = (static_cast<f32>(8 - i) * static_cast<f32>(max_value) + static_cast<f32>(i - 1) * static_cast<f32>(min_value)) / 7.0f;
+        }
+
+        for(u32 i = 0; i < 16; i++) {
+            indices |= static_cast<u64>(find_closest(palette, texels + i * 4 + channel, 1)) << (i * 3);
+        }
+    }
+
+    std::memcpy(output + 2, &indices, 6);
+}
+
+void encode_bc5_block(const u8* texels, u8* output) {
+    encode_bc4_block(texels, 0, output);
+    encode_bc4_block(texels, 1, output + 8);
+}
+
+// mode 6 only: one subset, 7.7.7.7 end points with a p-bit each and 4 bit indices
+void encode_bc7_block(const u8* texels, u8* output) {
+    auto [low, high] = fit_endpoints<4>(texels);
+
+    struct Endpoint {
+        std::array<u32, 4> value = {};
+        u32 p_bit = {};
+    };
+
+    auto quantize = [](const std::array<f32, 4>& color) -> Endpoint {
+        Endpoint best = {};
+        f32 best_error = std::numeric_limits<f32>::max();
+        for(u32 p_bit = 0; p_bit < 2; p_bit++) {
+            Endpoint candidate = { .p_bit = p_bit };
+            f32 error = 0.0f;
+            for(u32 c = 0; c < 4; c++) {
+                candidate.value[c] = static_cast<u32>(std::clamp(std::lround((color[c] - static_cast<f32>(p_bit)) / 2.0f), 0l, 127l));
+                f32 difference = static_cast<f32>(candidate.value[c] * 2 + p_bit) - color[c];
+                error += difference * difference;
+            }
+            if(error < best_error) { best = candidate; best_error = error; }
+        }
+        return best;
+    };
+
+    std::array<Endpoint, 2> endpoints = { quantize(low), quantize(high) };
+
+    Palette<16> palette = {};
+    for(u32 c = 0; c < 4; c++) {
+        u32 end_0 = endpoints[0].value[c] * 2 + endpoints[0].p_bit;
+        u32 end_1 = endpoints[1].value[c] * 2 + endpoints[1].p_bit;
+        for(u32 i = 0; i < 16; i++) {
+            palette[c][i] = static_cast<f32>(((64 - BC7_WEIGHTS[i]) * end_0 + BC7_WEIGHTS[i] * end_1 + 32) >> 6);
+        }
+    }
+
+    std::array<u32, 16> indices = {};
+    for(u32 i = 0; i < 16; i++) {
+        indices[i] = find_closest(palette, texels + i * 4, 4);
+    }
+
+    // the anchor index is stored without its top bit, so flip the block when it would be set
+    if(indices[0] >= 8) {
+        std::swap(endpoints[0], endpoints[1]);
+        for(auto& index : indices) { index = 15 - index; }
+    }
+
+    BlockWriter writer = {};
+    writer.write(1u << 6, 7);
+    for(u32 c = 0; c < 4; c++) {
+        writer.write(endpoints[0].value[c], 7);
+        writer.write(endpoints[1].value[c], 7);
+    }
+    writer.write(endpoints[0].p_bit, 1);
+    writer.write(endpoints[1].p_bit, 1);
+    for(u32 i = 0; i < 16; i++) {
+        writer.write(indices[i], i == 0 ? 3 : 4);
+    }
+
+    std::memcpy(output, writer.bytes.data(), writer.bytes.size());
+}
+
+auto compress_texture(const TextureContainerData& texture, daxa::Format format, ThreadPool& pool) -> TextureContainerData {
+    PROFILE_SCOPE("compress_texture");
+    u32 block_size = get_block_size(format);
+    if(block_size == 0) {
+        throw std::runtime_error("unsupported compressed texture format: " + std::to_string(static_cast<u32>(format)));
+    }
+
+    if(texture.format != daxa::Format::R8G8B8A8_UNORM && texture.format != daxa::Format::R8G8B8A8_SRGB) {
+        throw std::runtime_error("only rgba8 textures can be compressed");
+    }
+
+    TextureContainerData compressed = {
+        .format = format,
+        .size_x = texture.size_x,
+        .size_y = texture.size_y,
+    };
+    compressed.mips.resize(texture.mips.size());
+
+    u64 data_size = 0;
+    for(usize mip = 0; mip < texture.mips.size(); mip++) {
+        auto& level = compressed.mips[mip];
+        level.size_x = texture.mips[mip].size_x;
+        level.size_y = texture.mips[mip].size_y;
+        level.data_offset = data_size;
+        level.data_size = static_cast<u64>((level.size_x + 3) / 4) * ((level.size_y + 3) / 4) * block_size;
+        data_size = align_up(data_size + level.data_size);
+    }
+    compressed.data.resize(static_cast<usize>(data_size));
+
+    std::vector<std::future<void>> futures = {};
+    for(usize mip = 0; mip < texture.mips.size(); mip++) {
+        u32 blocks_y = (texture.mips[mip].size_y + 3) / 4;
+        for(u32 first_row = 0; first_row < blocks_y; first_row += BLOCK_ROWS_PER_TASK) {
+            futures.push_back(pool.submit([&texture, &compressed, format, block_size, mip, first_row, blocks_y] {
+                const auto& source = texture.mips[mip];
+                const u8* source_data = texture.data.data() + source.data_offset;
+                u8* output = compressed.data.data() + compressed.mips[mip].data_offset;
+                u32 blocks_x = (source.size_x + 3) / 4;
+
+                std::array<u8, 64> texels = {};
+                for(u32 block_y = first_row; block_y < std::min(first_row + BLOCK_ROWS_PER_TASK, blocks_y); block_y++) {
+                    for(u32 block_x = 0; block_x < blocks_x; block_x++) {
+                        load_block(source_data, source.size_x, source.size_y, block_x, block_y, texels.data());
+                        encode_block(format, texels.data(), output + (static_cast<usize>(block_y) * blocks_x + block_x) * block_size);
+                    }
+                }
+            }));
+        }
+    }
+
+    for(auto& future : futures) { future.get(); }
+
+    return compressed;
+}
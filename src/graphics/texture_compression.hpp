@@ -0,0 +1,17 @@
+#pragma once
+
+#include "texture_container.hpp"
+
+class ThreadPool;
+
+// bytes per 4x4 block, 0 for formats that arent block compressed
+auto get_block_size(daxa::Format format) -> u32;
+
+// every encoder takes a 4x4 block of rgba8 texels, row by row
+void encode_bc1_block(const u8* texels, u8* output);
+void encode_bc4_block(const u8* texels, u32 channel, u8* output);
+void encode_bc5_block(const u8* texels, u8* output);
+void encode_bc7_block(const u8* texels, u8* output);
+
+// compresses every mip of an rgba8 texture into one of the BC1, BC4, BC5 or BC7 formats, rows of blocks are spread over the pool
+auto compress_texture(const TextureContainerData& texture, daxa::Format format, ThreadPool& pool) -> TextureContainerData;
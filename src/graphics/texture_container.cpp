@@ -0,0 +1,233 @@
+#include "texture_container.hpp"
+#include "texture_compression.hpp"
+#include "utils/profiler.hpp"
+
+#include <stb_image.h>
+
+#include <fstream>
+
+namespace {
+    constexpr u64 DATA_ALIGNMENT = 16;
+
+    auto align_up(u64 value) -> u64 {
+        return (value + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+    }
+
+    auto srgb_to_linear(f32 value) -> f32 {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    auto linear_to_srgb(f32 value) -> f32 {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    auto is_srgb(daxa::Format format) -> bool {
+        return format == daxa::Format::R8G8B8A8_SRGB;
+    }
+
+    // bytes a mip of a cooked format takes, block compressed mips are rounded up to whole blocks
+    auto get_mip_data_size(daxa::Format format, u32 size_x, u32 size_y) -> u64 {
+        u32 block_size = get_block_size(format);
+        if(block_size != 0) { return static_cast<u64>((size_x + 3) / 4) * ((size_y + 3) / 4) * block_size; }
+        return static_cast<u64>(size_x) * size_y * 4;
+    }
+}
+
+auto is_cooked_texture_format(daxa::Format format) -> bool {
+    return format == daxa::Format::R8G8B8A8_UNORM || format == daxa::Format::R8G8B8A8_SRGB || get_block_size(format) != 0;
+}
+
+auto get_cooked_texture_format_name(daxa::Format format) -> std::string_view {
+    switch(format) {
+        case daxa::Format::R8G8B8A8_UNORM: return "rgba8";
+        case daxa::Format::R8G8B8A8_SRGB: return "rgba8_srgb";
+        case daxa::Format::BC1_RGB_UNORM_BLOCK: return "bc1";
+        case daxa::Format::BC1_RGB_SRGB_BLOCK: return "bc1_srgb";
+        case daxa::Format::BC4_UNORM_BLOCK: return "bc4";
+        case daxa::Format::BC5_UNORM_BLOCK: return "bc5";
+        case daxa::Format::BC7_UNORM_BLOCK: return "bc7";
+        case daxa::Format::BC7_SRGB_BLOCK: return "bc7_srgb";
+        default: throw std::runtime_error("unsupported texture format: " + std::to_string(static_cast<u32>(format)));
+    }
+}
+
+auto TextureContainer::bake(const std::filesystem::path& image_path, daxa::Format format) -> TextureContainerData {
+    i32 size_x = 0;
+    i32 size_y = 0;
+    i32 num_channels = 0;
+    u8* data = stbi_load(image_path.string().c_str(), &size_x, &size_y, &num_channels, 4);
+    if(data == nullptr) {
+        throw std::runtime_error("Textures couldn't be found with path: " + image_path.string());
+    }
+
+    auto texture = generate_mip_chain(static_cast<u32>(size_x), static_cast<u32>(size_y), data, format);
+    stbi_image_free(data);
+    return texture;
+}
+
+auto TextureContainer::bake(std::span<const u8> encoded_image, daxa::Format format) -> TextureContainerData {
+    i32 size_x = 0;
+    i32 size_y = 0;
+    i32 num_channels = 0;
+    u8* data = stbi_load_from_memory(encoded_image.data(), static_cast<i32>(encoded_image.size()), &size_x, &size_y, &num_channels, 4);
+    if(data == nullptr) {
+        throw std::runtime_error("Textures couldn't be loaded from memory");
+    }
+
+    auto texture = generate_mip_chain(static_cast<u32>(size_x), static_cast<u32>(size_y), data, format);
+    stbi_image_free(data);
+    return texture;
+}
+
+auto TextureContainer::generate_mip_chain(u32 size_x, u32 size_y, const u8* rgba, daxa::Format format) -> TextureContainerData {
+    PROFILE_SCOPE("TextureContainer::generate_mip_chain");
+    if(format != daxa::Format::R8G8B8A8_UNORM && format != daxa::Format::R8G8B8A8_SRGB) {
+        throw std::runtime_error("unsupported texture format: " + std::to_string(static_cast<u32>(format)));
+    }
+
+    u32 mip_levels = static_cast<u32>(std::floor(std::log2(std::max(size_x, size_y)))) + 1;
+    bool srgb = is_srgb(format);
+
+    TextureContainerData texture = {
+        .format = format,
+        .size_x = size_x,
+        .size_y = size_y,
+    };
+    texture.mips.resize(mip_levels);
+
+    u64 data_size = 0;
+    for(u32 mip = 0; mip < mip_levels; mip++) {
+        auto& level = texture.mips[mip];
+        level.size_x = std::max(1u, size_x >> mip);
+        level.size_y = std::max(1u, size_y >> mip);
+        level.data_offset = data_size;
+        level.data_size = static_cast<u64>(level.size_x) * level.size_y * 4;
+        data_size = align_up(data_size + level.data_size);
+    }
+    texture.data.resize(static_cast<usize>(data_size));
+    std::memcpy(texture.data.data(), rgba, static_cast<usize>(texture.mips[0].data_size));
+
+    // filtering happens in linear space and in full precision, every level is only quantized once when it gets stored
+    std::array<f32, 256> decode_lut = {};
+    for(u32 i = 0; i < 256; i++) {
+        decode_lut[i] = srgb ? srgb_to_linear(static_cast<f32>(i) / 255.0f) : static_cast<f32>(i) / 255.0f;
+    }
+
+    std::vector<f32> level_data(static_cast<usize>(size_x) * size_y * 4);
+    for(usize i = 0; i < level_data.size(); i++) {
+        level_data[i] = (i % 4 == 3) ? static_cast<f32>(rgba[i]) / 255.0f : decode_lut[rgba[i]];
+    }
+
+    std::vector<f32> next_level_data = {};
+    for(u32 mip = 1; mip < mip_levels; mip++) {
+        const auto& src = texture.mips[mip - 1];
+        const auto& dst = texture.mips[mip];
+        next_level_data.resize(static_cast<usize>(dst.size_x) * dst.size_y * 4);
+        u8* dst_data = texture.data.data() + dst.data_offset;
+
+        for(u32 y = 0; y < dst.size_y; y++) {
+            u32 y0 = std::min(y * 2, src.size_y - 1);
+            u32 y1 = std::min(y * 2 + 1, src.size_y - 1);
+            for(u32 x = 0; x < dst.size_x; x++) {
+                u32 x0 = std::min(x * 2, src.size_x - 1);
+                u32 x1 = std::min(x * 2 + 1, src.size_x - 1);
+                usize dst_index = (static_cast<usize>(y) * dst.size_x + x) * 4;
+
+                for(u32 c = 0; c < 4; c++) {
+                    f32 value = 0.25f * (
+                        level_data[(static_cast<usize>(y0) * src.size_x + x0) * 4 + c] +
+                        level_data[(static_cast<usize>(y0) * src.size_x + x1) * 4 + c] +
+                        level_data[(static_cast<usize>(y1) * src.size_x + x0) * 4 + c] +
+                        level_data[(static_cast<usize>(y1) * src.size_x + x1) * 4 + c]);
+                    next_level_data[dst_index + c] = value;
+
+                    f32 encoded = (srgb && c != 3) ? linear_to_srgb(value) : value;
+                    dst_data[dst_index + c] = static_cast<u8>(std::clamp(encoded * 255.0f + 0.5f, 0.0f, 255.0f));
+                }
+            }
+        }
+
+        std::swap(level_data, next_level_data);
+    }
+
+    return texture;
+}
+
+void TextureContainer::write(const TextureContainerData& texture, const std::filesystem::path& file_path) {
+    TextureContainerHeader header = {
+        .magic = MAGIC,
+        .version = VERSION,
+        .format = static_cast<u32>(texture.format),
+        .size_x = texture.size_x,
+        .size_y = texture.size_y,
+        .mip_level_count = static_cast<u32>(texture.mips.size()),
+        .mips_offset = align_up(sizeof(TextureContainerHeader)),
+    };
+    header.data_offset = align_up(header.mips_offset + texture.mips.size() * sizeof(TextureContainerMip));
+    header.data_size = texture.data.size();
+
+    std::ofstream file(file_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open()) {
+        throw std::runtime_error("couldnt open file: " + file_path.string());
+    }
+
+    auto write_section = [&](u64 offset, const void* data, usize size) {
+        std::vector<char> padding(static_cast<usize>(offset) - static_cast<usize>(static_cast<std::streamoff>(file.tellp())), 0);
+        file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    write_section(0, &header, sizeof(TextureContainerHeader));
+    write_section(header.mips_offset, texture.mips.data(), texture.mips.size() * sizeof(TextureContainerMip));
+    write_section(header.data_offset, texture.data.data(), texture.data.size());
+
+    if(!file) {
+        throw std::runtime_error("failed writing texture container: " + file_path.string());
+    }
+}
+
+TextureContainer::TextureContainer(const std::filesystem::path& _file_path) : file_path{_file_path}, file{_file_path.string()} {
+    if(file.size() < sizeof(TextureContainerHeader)) {
+        throw std::runtime_error("texture container is truncated: " + file_path.string());
+    }
+
+    header = reinterpret_cast<const TextureContainerHeader*>(file.data());
+    if(header->magic != MAGIC || header->version != VERSION) {
+        throw std::runtime_error("texture container has an unsupported version, recook it: " + file_path.string());
+    }
+
+    if(header->mip_level_count == 0 || header->mips_offset + header->mip_level_count * sizeof(TextureContainerMip) > file.size() || header->data_offset + header->data_size > file.size()) {
+        throw std::runtime_error("texture container is truncated: " + file_path.string());
+    }
+
+    auto format = static_cast<daxa::Format>(header->format);
+    if(!is_cooked_texture_format(format) || header->size_x == 0 || header->size_y == 0) {
+        throw std::runtime_error("texture container is corrupt, recook it: " + file_path.string());
+    }
+
+    // the uploader copies every mip with its own extent straight out of the mapped file, so the extents
+    // have to follow the chain and the data has to be exactly what the format needs for them
+    auto mips = get_mips();
+    if(mips.size() > static_cast<usize>(std::floor(std::log2(std::max(header->size_x, header->size_y)))) + 1) {
+        throw std::runtime_error("texture container is corrupt, recook it: " + file_path.string());
+    }
+
+    for(u32 i = 0; i < mips.size(); i++) {
+        const auto& mip = mips[i];
+        if(mip.size_x != std::max(1u, header->size_x >> i) || mip.size_y != std::max(1u, header->size_y >> i) || mip.data_size != get_mip_data_size(format, mip.size_x, mip.size_y)) {
+            throw std::runtime_error("texture container is corrupt, recook it: " + file_path.string());
+        }
+
+        if(mip.data_size > header->data_size || mip.data_offset > header->data_size - mip.data_size) {
+            throw std::runtime_error("texture container is truncated: " + file_path.string());
+        }
+    }
+}
+
+auto TextureContainer::get_mips() const -> std::span<const TextureContainerMip> {
+    return { reinterpret_cast<const TextureContainerMip*>(file.data() + header->mips_offset), header->mip_level_count };
+}
+
+auto TextureContainer::get_data() const -> std::span<const u8> {
+    return { file.data() + header->data_offset, static_cast<usize>(header->data_size) };
+}
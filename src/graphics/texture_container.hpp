@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pch.hpp"
+#include "utils/mapped_file.hpp"
+
+struct TextureContainerHeader {
+    u32 magic = {};
+    u32 version = {};
+    u32 format = {};
+    u32 size_x = {};
+    u32 size_y = {};
+    u32 mip_level_count = {};
+    u64 mips_offset = {};
+    u64 data_offset = {};
+    u64 data_size = {};
+};
+
+// data_offset is relative to the start of the mip data, so it can be used as a staging buffer offset directly
+struct TextureContainerMip {
+    u32 size_x = {};
+    u32 size_y = {};
+    u64 data_offset = {};
+    u64 data_size = {};
+};
+
+// rgba8 or one of the block compressed formats asset_cooker encodes into
+auto is_cooked_texture_format(daxa::Format format) -> bool;
+// short name of a cooked format, part of the file name so the same image cooked in two formats gets two files
+auto get_cooked_texture_format_name(daxa::Format format) -> std::string_view;
+
+// cpu side texture with its whole mip chain, either freshly baked or about to be written
+struct TextureContainerData {
+    daxa::Format format = daxa::Format::R8G8B8A8_UNORM;
+    u32 size_x = {};
+    u32 size_y = {};
+    std::vector<TextureContainerMip> mips = {};
+    std::vector<u8> data = {};
+};
+
+// engine native texture written by asset_cooker. every mip is already filtered, so loading is
+// mapping the file, copying the mip data into one staging buffer and issuing one copy per mip
+struct TextureContainer {
+    static constexpr u32 MAGIC = 0x58455443; // "CTEX"
+    static constexpr u32 VERSION = 1;
+    static constexpr std::string_view EXTENSION = ".ctex";
+
+    static auto bake(const std::filesystem::path& image_path, daxa::Format format) -> TextureContainerData;
+    static auto bake(std::span<const u8> encoded_image, daxa::Format format) -> TextureContainerData;
+    static auto generate_mip_chain(u32 size_x, u32 size_y, const u8* rgba, daxa::Format format) -> TextureContainerData;
+    static void write(const TextureContainerData& texture, const std::filesystem::path& file_path);
+
+    TextureContainer(const std::filesystem::path& _file_path);
+
+    [[nodiscard]] auto get_header() const -> const TextureContainerHeader& { return *header; }
+    [[nodiscard]] auto get_mips() const -> std::span<const TextureContainerMip>;
+    [[nodiscard]] auto get_data() const -> std::span<const u8>;
+
+    std::filesystem::path file_path = {};
+    MappedFile file;
+    const TextureContainerHeader* header = {};
+};
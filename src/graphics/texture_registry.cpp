@@ -0,0 +1,94 @@
+#include "texture_registry.hpp"
+#include "upload_service.hpp"
+
+#include "utils/profiler.hpp"
+
+namespace {
+    // fnv-1a, only has to tell the embedded images of the loaded models apart
+    auto hash_bytes(std::span<const u8> bytes) -> u64 {
+        u64 hash = 14695981039346656037ull;
+        for(u8 byte : bytes) {
+            hash ^= byte;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    auto format_suffix(daxa::Format format) -> std::string {
+        return "#" + std::to_string(static_cast<u32>(format));
+    }
+}
+
+TextureRegistry::TextureRegistry(UploadService* _upload_service, SamplerCache* _sampler_cache) : upload_service{_upload_service}, sampler_cache{_sampler_cache} {
+    auto null = acquire(std::filesystem::path{"assets/white.png"}, daxa::Format::R8G8B8A8_SRGB);
+    upload_service->wait(null.upload_value);
+    null_texture = std::move(null.texture);
+}
+
+auto TextureRegistry::acquire(const std::filesystem::path& path, daxa::Format format) -> SharedTexture {
+    std::error_code error = {};
+    std::filesystem::path canonical_path = std::filesystem::weakly_canonical(path, error);
+    std::string key = (error ? path : canonical_path).string() + format_suffix(format);
+
+    return acquire(key, [&]() {
+        return Texture::load_texture(*upload_service, *sampler_cache, path.string(), format);
+    });
+}
+
+auto TextureRegistry::acquire(std::span<const u8> bytes, daxa::Format format) -> SharedTexture {
+    std::string key = "embedded:" + std::to_string(hash_bytes(bytes)) + ":" + std::to_string(bytes.size()) + format_suffix(format);
+
+    return acquire(key, [&]() {
+        return Texture::load_texture(*upload_service, *sampler_cache, const_cast<u8*>(bytes.data()), static_cast<u32>(bytes.size()), format);
+    });
+}
+
+auto TextureRegistry::acquire(const std::string& key, const std::function<Texture::PayLoad()>& load) -> SharedTexture {
+    PROFILE_SCOPE("TextureRegistry::acquire");
+    {
+        std::unique_lock lock{mutex};
+        while(true) {
+            auto it = entries.find(key);
+            if(it == entries.end()) { break; }
+
+            if(!it->second.loading) {
+                if(auto texture = it->second.texture.lock()) {
+                    return SharedTexture { .texture = std::move(texture), .upload_value = it->second.upload_value };
+                }
+                break;
+            }
+
+            loaded_condition.wait(lock);
+        }
+
+        entries[key] = Entry { .loading = true };
+    }
+
+    Texture::PayLoad payload = {};
+    try {
+        payload = load();
+    } catch(...) {
+        // whoever waited on this texture tries to load it itself
+        std::lock_guard lock{mutex};
+        entries.erase(key);
+        loaded_condition.notify_all();
+        throw;
+    }
+
+    std::shared_ptr<Texture> texture = std::move(payload.texture);
+    {
+        std::lock_guard lock{mutex};
+        entries[key] = Entry { .texture = texture, .upload_value = payload.upload_value, .loading = false };
+
+        // drop the entries of textures nobody holds anymore
+        std::erase_if(entries, [](const auto& entry) { return !entry.second.loading && entry.second.texture.expired(); });
+    }
+    loaded_condition.notify_all();
+
+    return SharedTexture { .texture = std::move(texture), .upload_value = payload.upload_value };
+}
+
+auto TextureRegistry::get_texture_count() -> usize {
+    std::lock_guard lock{mutex};
+    return static_cast<usize>(std::count_if(entries.begin(), entries.end(), [](const auto& entry) { return !entry.second.texture.expired(); }));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "texture.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+struct SamplerCache;
+
+// a texture shared through the registry, it can be sampled once the upload service completed upload_value
+struct SharedTexture {
+    std::shared_ptr<Texture> texture = {};
+    u64 upload_value = {};
+};
+
+// every texture the models use, keyed by file path or by a hash of the bytes for images embedded in a model, each
+// together with the format it was loaded as. a texture asked for twice is decoded and uploaded once and lives until
+// the last model holding it lets go. thread safe, a second request for a texture that is still decoding waits for
+// the first one instead of decoding it again
+struct TextureRegistry {
+    TextureRegistry(UploadService* _upload_service, SamplerCache* _sampler_cache);
+
+    TextureRegistry(const TextureRegistry&) = delete;
+    auto operator=(const TextureRegistry&) -> TextureRegistry& = delete;
+
+    auto acquire(const std::filesystem::path& path, daxa::Format format) -> SharedTexture;
+    auto acquire(std::span<const u8> bytes, daxa::Format format) -> SharedTexture;
+
+    // white texture bound in place of missing or not yet loaded ones
+    [[nodiscard]] auto get_null_texture() const -> const std::shared_ptr<Texture>& { return null_texture; }
+    // textures that are alive right now, each counted once no matter how many models share it
+    [[nodiscard]] auto get_texture_count() -> usize;
+
+private:
+    struct Entry {
+        std::weak_ptr<Texture> texture = {};
+        u64 upload_value = {};
+        bool loading = false;
+    };
+
+    auto acquire(const std::string& key, const std::function<Texture::PayLoad()>& load) -> SharedTexture;
+
+    UploadService* upload_service = {};
+    SamplerCache* sampler_cache = {};
+
+    std::mutex mutex = {};
+    std::condition_variable loaded_condition = {};
+    std::unordered_map<std::string, Entry> entries = {};
+
+    std::shared_ptr<Texture> null_texture = {};
+};
@@ -0,0 +1,156 @@
+#include "upload_service.hpp"
+
+#include "utils/profiler.hpp"
+
+UploadService::UploadService(daxa::Device _device, u64 ring_size)
+    : device{_device},
+        ring_capacity{ring_size},
+        upload_timeline{device.create_timeline_semaphore({ .initial_value = 0, .name = "upload timeline" })} {
+    ring_buffer = device.create_buffer({
+        .size = static_cast<u32>(ring_capacity),
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
+        .name = "upload ring buffer",
+    });
+
+    ring_ptr = device.get_host_address_as<u8>(ring_buffer);
+}
+
+UploadService::~UploadService() {
+    for(auto& job : pending_jobs) {
+        if(job.dedicated) { device.destroy_buffer(job.staging_buffer); }
+    }
+
+    device.destroy_buffer(ring_buffer);
+}
+
+auto UploadService::upload(std::initializer_list<std::span<const u8>> parts, RecordFunction&& record) -> u64 {
+    PROFILE_SCOPE("UploadService::upload");
+    u64 size = 0;
+    for(const auto& part : parts) { size += part.size(); }
+
+    Job job = { .record = std::move(record) };
+    std::optional<u64> ring_allocation_id = std::nullopt;
+
+    if(auto allocation = allocate_ring(size)) {
+        job.staging_buffer = ring_buffer;
+        job.staging_offset = allocation->first;
+        ring_allocation_id = allocation->second;
+    } else {
+        job.staging_buffer = device.create_buffer({
+            .size = static_cast<u32>(std::max<u64>(size, 1)),
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
+            .name = "dedicated staging buffer",
+        });
+        job.dedicated = true;
+    }
+
+    // the range is reserved, so the copy doesnt have to hold the lock
+    u8* dst = device.get_host_address_as<u8>(job.staging_buffer) + job.staging_offset;
+    for(const auto& part : parts) {
+        std::memcpy(dst, part.data(), part.size());
+        dst += part.size();
+    }
+
+    std::lock_guard lock{mutex};
+    if(ring_allocation_id) {
+        ring_allocations[*ring_allocation_id - first_ring_allocation_id].upload_value = next_upload_value;
+    }
+
+    pending_jobs.push_back(std::move(job));
+    return next_upload_value;
+}
+
+auto UploadService::upload_to_buffer(std::span<const u8> data, daxa::BufferId dst_buffer, u64 dst_offset) -> u64 {
+    u64 size = data.size();
+    return upload({data}, [dst_buffer, dst_offset, size](daxa::CommandList& cmd_list, daxa::BufferId staging_buffer, u64 staging_offset) {
+        cmd_list.copy_buffer_to_buffer({
+            .src_buffer = staging_buffer,
+            .src_offset = static_cast<usize>(staging_offset),
+            .dst_buffer = dst_buffer,
+            .dst_offset = static_cast<usize>(dst_offset),
+            .size = static_cast<usize>(size),
+        });
+    });
+}
+
+void UploadService::flush() {
+    PROFILE_SCOPE("UploadService::flush");
+    std::vector<Job> jobs = {};
+    u64 upload_value = 0;
+    {
+        std::lock_guard lock{mutex};
+        if(pending_jobs.empty()) { return; }
+        std::swap(jobs, pending_jobs);
+        upload_value = next_upload_value++;
+    }
+
+    auto cmd_list = device.create_command_list({
+        .name = "upload batch",
+    });
+
+    // host writes are visible to the queue once it is submitted, the barrier only waits for frames that still read the destinations
+    cmd_list.pipeline_barrier({
+        .src_access = daxa::AccessConsts::READ_WRITE,
+        .dst_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
+    });
+
+    for(auto& job : jobs) {
+        job.record(cmd_list, job.staging_buffer, job.staging_offset);
+        if(job.dedicated) { cmd_list.destroy_buffer_deferred(job.staging_buffer); }
+    }
+
+    cmd_list.pipeline_barrier({
+        .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+        .dst_access = daxa::AccessConsts::READ,
+    });
+
+    cmd_list.complete();
+
+    device.submit_commands({
+        .command_lists = {std::move(cmd_list)},
+        .signal_timeline_semaphores = {{upload_timeline, upload_value}},
+    });
+}
+
+void UploadService::wait(u64 upload_value) {
+    bool is_queued = false;
+    {
+        std::lock_guard lock{mutex};
+        is_queued = upload_value >= next_upload_value;
+    }
+
+    if(is_queued) { flush(); }
+    upload_timeline.wait_for_value(upload_value);
+}
+
+auto UploadService::allocate_ring(u64 size) -> std::optional<std::pair<u64, u64>> {
+    std::lock_guard lock{mutex};
+    retire_ring_allocations();
+
+    u64 aligned_size = (std::max<u64>(size, 1) + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+    if(aligned_size > ring_capacity) { return std::nullopt; }
+
+    // the tail end of the ring is skipped when the allocation doesnt fit in front of the wrap
+    u64 offset = ring_head;
+    u64 padding = 0;
+    if(offset + aligned_size > ring_capacity) {
+        padding = ring_capacity - offset;
+        offset = 0;
+    }
+
+    if(ring_used_size + padding + aligned_size > ring_capacity) { return std::nullopt; }
+
+    ring_head = (offset + aligned_size) % ring_capacity;
+    ring_used_size += padding + aligned_size;
+    ring_allocations.push_back(RingAllocation { .size = padding + aligned_size, .upload_value = 0 });
+    return std::pair{offset, next_ring_allocation_id++};
+}
+
+void UploadService::retire_ring_allocations() {
+    u64 completed_value = upload_timeline.value();
+    while(!ring_allocations.empty() && ring_allocations.front().upload_value != 0 && ring_allocations.front().upload_value <= completed_value) {
+        ring_used_size -= ring_allocations.front().size;
+        ring_allocations.pop_front();
+        first_ring_allocation_id++;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// moves cpu data to the gpu through one persistent host visible ring buffer. any thread can queue an upload, its
+// bytes are copied into staging memory right away and flush records every queued copy into a single command list
+// that signals a timeline value once it is done. uploads that dont fit into the ring get their own staging buffer
+struct UploadService {
+    static constexpr u64 DEFAULT_RING_SIZE = 64 << 20;
+    // covers the texel block size of every format we upload and the 4 byte alignment of buffer copies
+    static constexpr u64 STAGING_ALIGNMENT = 16;
+
+    // records the copy out of staging memory into the destination, called on the main thread during flush
+    using RecordFunction = std::function<void(daxa::CommandList& cmd_list, daxa::BufferId staging_buffer, u64 staging_offset)>;
+
+    UploadService(daxa::Device _device, u64 ring_size = DEFAULT_RING_SIZE);
+    ~UploadService();
+
+    UploadService(const UploadService&) = delete;
+    auto operator=(const UploadService&) -> UploadService& = delete;
+
+    // thread safe, the parts are placed back to back in staging memory. returns the timeline value that marks the
+    // upload as complete
+    auto upload(std::initializer_list<std::span<const u8>> parts, RecordFunction&& record) -> u64;
+    auto upload_to_buffer(std::span<const u8> data, daxa::BufferId dst_buffer, u64 dst_offset) -> u64;
+
+    // submits everything queued so far as one batch, main thread only
+    void flush();
+    // flushes when the upload is still queued and blocks until it is done, main thread only
+    void wait(u64 upload_value);
+
+    [[nodiscard]] auto is_complete(u64 upload_value) const -> bool { return upload_timeline.value() >= upload_value; }
+    [[nodiscard]] auto get_completed_value() const -> u64 { return upload_timeline.value(); }
+
+    daxa::Device device = {};
+
+private:
+    struct Job {
+        RecordFunction record = {};
+        daxa::BufferId staging_buffer = {};
+        u64 staging_offset = {};
+        // a staging buffer made just for this job, destroyed once the batch retires
+        bool dedicated = false;
+    };
+
+    // ring space is handed out and given back in the same order, a range is reusable once the batch that read it retired
+    struct RingAllocation {
+        u64 size = {};
+        // 0 while the bytes are still being written
+        u64 upload_value = {};
+    };
+
+    auto allocate_ring(u64 size) -> std::optional<std::pair<u64, u64>>;
+    void retire_ring_allocations();
+
+    daxa::BufferId ring_buffer = {};
+    u8* ring_ptr = {};
+    u64 ring_capacity = {};
+    u64 ring_head = 0;
+    u64 ring_used_size = 0;
+    std::deque<RingAllocation> ring_allocations = {};
+    u64 first_ring_allocation_id = 0;
+    u64 next_ring_allocation_id = 0;
+
+    daxa::TimelineSemaphore upload_timeline = {};
+    // value the next flush signals, every job queued before it completes with that value
+    u64 next_upload_value = 1;
+
+    mutable std::mutex mutex = {};
+    std::vector<Job> pending_jobs = {};
+};
@@ -0,0 +1,109 @@
+#include "vertex_quantization.hpp"
+#include "model_importer.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include "utils/profiler.hpp"
+
+auto pack_octahedral(const f32vec3& direction) -> u32 {
+    f32 length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if(length == 0.0f) { return glm::packSnorm2x16(glm::vec2{0.0f}); }
+
+    glm::vec3 n = glm::vec3{direction.x, direction.y, direction.z} / length;
+    glm::vec2 encoded = {n.x, n.y};
+    if(n.z < 0.0f) {
+        // the lower hemisphere is folded over the diagonals of the upper one
+        glm::vec2 sign = {n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f};
+        encoded = (1.0f - glm::abs(glm::vec2{n.y, n.x})) * sign;
+    }
+
+    return glm::packSnorm2x16(encoded);
+}
+
+auto pack_position(const f32vec3& position, const f32vec3& position_min, const f32vec3& position_scale) -> PackedPosition {
+    auto fraction = [](f32 value, f32 min, f32 scale) -> f32 {
+        return scale > 0.0f ? std::clamp((value - min) / scale, 0.0f, 1.0f) : 0.0f;
+    };
+
+    return PackedPosition {
+        .xy = glm::packUnorm2x16(glm::vec2{fraction(position.x, position_min.x, position_scale.x), fraction(position.y, position_min.y, position_scale.y)}),
+        .z = glm::packUnorm2x16(glm::vec2{fraction(position.z, position_min.z, position_scale.z), 0.0f}) & 0xFFFFu,
+    };
+}
+
+auto pack_vertex(const Vertex& vertex, const f32vec3& position_min, const f32vec3& position_scale) -> PackedVertex {
+    PackedPosition position = pack_position(vertex.position, position_min, position_scale);
+    u32 tangent_sign = vertex.tangent.w < 0.0f ? 0x80000000u : 0u;
+
+    return PackedVertex {
+        .position_xy = position.xy,
+        .position_z_tangent_sign = position.z | tangent_sign,
+        .normal = pack_octahedral(vertex.normal),
+        .tangent = pack_octahedral({vertex.tangent.x, vertex.tangent.y, vertex.tangent.z}),
+        .uv = glm::packHalf2x16(glm::vec2{vertex.uv.x, vertex.uv.y}),
+    };
+}
+
+void pack_indices(ModelData& model) {
+    model.index_data.clear();
+
+    auto pack_range = [&](u32 first_index, u32 index_count, u32 index_type_size) -> u32 {
+        usize offset = (model.index_data.size() + index_type_size - 1) / index_type_size * index_type_size;
+        model.index_data.resize(offset + static_cast<usize>(index_count) * index_type_size, 0);
+
+        const u32* indices = model.indices.data() + first_index;
+        if(index_type_size == sizeof(u16)) {
+            u16* output = reinterpret_cast<u16*>(model.index_data.data() + offset);
+            for(u32 i = 0; i < index_count; i++) { output[i] = static_cast<u16>(indices[i]); }
+        } else {
+            std::memcpy(model.index_data.data() + offset, indices, index_count * sizeof(u32));
+        }
+
+        return static_cast<u32>(offset);
+    };
+
+    for(auto& primitive : model.primitives) {
+        // indices are relative to the first vertex of their primitive, so the vertex count alone decides the type
+        bool use_u16_indices = primitive.vertex_count <= std::numeric_limits<u16>::max() + 1u;
+        primitive.index_type_size = use_u16_indices ? static_cast<u32>(sizeof(u16)) : static_cast<u32>(sizeof(u32));
+
+        // lod 0 covers the same indices as the primitive itself
+        if(primitive.lod_count == 0) {
+            primitive.index_offset = pack_range(primitive.first_index, primitive.index_count, primitive.index_type_size);
+            continue;
+        }
+
+        for(u32 l = primitive.first_lod; l < primitive.first_lod + primitive.lod_count; l++) {
+            model.lods[l].index_offset = pack_range(model.lods[l].first_index, model.lods[l].index_count, primitive.index_type_size);
+        }
+        primitive.index_offset = model.lods[primitive.first_lod].index_offset;
+    }
+}
+
+void quantize_model(ModelData& model) {
+    PROFILE_SCOPE("quantize_model");
+    model.packed_vertices.resize(model.vertices.size());
+    model.packed_positions.resize(model.vertices.size());
+
+    for(auto& primitive : model.primitives) {
+        if(primitive.vertex_count == 0) { continue; }
+
+        glm::vec3 min = glm::vec3{std::numeric_limits<f32>::max()};
+        glm::vec3 max = glm::vec3{std::numeric_limits<f32>::lowest()};
+        for(u32 v = primitive.first_vertex; v < primitive.first_vertex + primitive.vertex_count; v++) {
+            const auto& position = model.vertices[v].position;
+            min = glm::min(min, glm::vec3{position.x, position.y, position.z});
+            max = glm::max(max, glm::vec3{position.x, position.y, position.z});
+        }
+
+        primitive.position_min = {min.x, min.y, min.z};
+        primitive.position_scale = {max.x - min.x, max.y - min.y, max.z - min.z};
+
+        for(u32 v = primitive.first_vertex; v < primitive.first_vertex + primitive.vertex_count; v++) {
+            model.packed_vertices[v] = pack_vertex(model.vertices[v], primitive.position_min, primitive.position_scale);
+            model.packed_positions[v] = pack_position(model.vertices[v].position, primitive.position_min, primitive.position_scale);
+        }
+    }
+
+    pack_indices(model);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "pch.hpp"
+
+struct ModelData;
+
+auto pack_octahedral(const f32vec3& direction) -> u32;
+auto pack_position(const f32vec3& position, const f32vec3& position_min, const f32vec3& position_scale) -> PackedPosition;
+auto pack_vertex(const Vertex& vertex, const f32vec3& position_min, const f32vec3& position_scale) -> PackedVertex;
+
+// narrows the indices of every primitive with at most 65536 vertices to 16 bits and packs them and their lods into
+// ModelData::index_data, writing the offsets and index type into the primitives and lods
+void pack_indices(ModelData& model);
+
+// rebuilds ModelData::packed_vertices, packed_positions and index_data from the full precision data and writes the position
+// bounds every primitive dequantizes with, has to run again whenever the vertices, indices or primitives change
+void quantize_model(ModelData& model);
@@ -1,4 +1,5 @@
 #include "window.hpp"
+#include "utils/profiler.hpp"
 
 #if defined(_WIN32)
 #define GLFW_EXPOSE_NATIVE_WIN32
@@ -173,6 +174,7 @@ auto AppWindow::is_cursor_captured() const -> bool {
 }
 
 auto AppWindow::update() -> bool {
+    PROFILE_FUNCTION();
     this->window_state->key_down_old = this->window_state->key_down;
     this->window_state->mouse_button_down_old = this->window_state->mouse_button_down;
     this->window_state->old_cursor_pos_x = this->get_cursor_x();
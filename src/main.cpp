@@ -1,8 +1,46 @@
 #include "application.hpp"
+#include "utils/profiler.hpp"
 
-auto main() -> int {
+#include <charconv>
+#include <limits>
+
+auto parse_frame_count(std::string_view text) -> u32 {
+    u32 frame_count = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), frame_count);
+    if(error != std::errc{} || end != text.data() + text.size() || frame_count == 0) {
+        throw std::runtime_error("--profile expects a frame count between 1 and " + std::to_string(std::numeric_limits<u32>::max()) + ", got: " + std::string{text});
+    }
+    return frame_count;
+}
+
+auto main(int argc, char** argv) -> int {
     Application app;
+
+    auto value = [&](i32& i) -> std::string_view {
+        if(i + 1 >= argc) { throw std::runtime_error(std::string{"missing value for "} + argv[i]); }
+        return argv[++i];
+    };
+
+    // --profile <frames> captures the first frames to profile_capture.json, F9 captures at any time
+    // --record <path> sets where F10 records the camera path, --replay <path> plays one back and exits with a frame time report
+    try {
+        for(i32 i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            if(arg == "--profile") {
+                app.profile_capture_frame_count = parse_frame_count(value(i));
+                Profiler::capture_frames(app.profile_capture_frame_count, "profile_capture.json");
+            } else if(arg == "--record") {
+                app.camera_path_file = value(i);
+            } else if(arg == "--replay") {
+                app.start_camera_path_replay(std::string{value(i)});
+            }
+        }
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
     app.run();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,107 @@
+#include "graphics/model_importer.hpp"
+#include "graphics/cooked_model.hpp"
+#include "graphics/texture_container.hpp"
+#include "graphics/texture_compression.hpp"
+#include "graphics/meshlet_builder.hpp"
+#include "utils/threadpool.hpp"
+
+#include <chrono>
+
+// converts a gltf model into the engine native .cmodel format
+//   asset_cooker [--uncompressed] [--no-meshlets] <input.gltf> [output.cmodel]
+// without an output path the cooked file is written next to the input, where Model picks it up automatically
+// every image is baked into a .ctex with its full mip chain, external images next to their source (foo.png becomes
+// foo.png.bc7_srgb.ctex) and embedded ones next to the cooked model, and the cooked model references the .ctex files instead
+// images are block compressed by usage (see import_gltf_model) unless --uncompressed is passed
+// every primitive is split into meshlets with culling bounds unless --no-meshlets is passed
+
+struct TextureStats {
+    u64 uncompressed_size = {};
+    u64 cooked_size = {};
+};
+
+auto bake_images(ModelData& model, const std::filesystem::path& output_path, bool compress, ThreadPool& pool) -> TextureStats {
+    TextureStats stats = {};
+
+    // one image at a time, the encoder itself spreads the blocks of every mip over the pool
+    for(usize i = 0; i < model.images.size(); i++) {
+        auto& image = model.images[i];
+        // the source extension and the cooked format stay in the name, foo.png and foo.jpg or one image used
+        // as srgb and as linear data would otherwise overwrite each other
+        std::string suffix = "." + std::string{get_cooked_texture_format_name(compress ? image.compressed_format : image.format)} + std::string{TextureContainer::EXTENSION};
+        std::filesystem::path texture_path = {};
+        TextureContainerData texture = {};
+        if(!image.path.empty()) {
+            texture_path = image.path;
+            texture_path += suffix;
+            texture = TextureContainer::bake(image.path, image.format);
+        } else {
+            texture_path = output_path.parent_path() / (output_path.stem().string() + "_image" + std::to_string(i) + suffix);
+            texture = TextureContainer::bake(image.bytes, image.format);
+        }
+
+        stats.uncompressed_size += texture.data.size();
+        if(compress) {
+            texture = compress_texture(texture, image.compressed_format, pool);
+        }
+        stats.cooked_size += texture.data.size();
+
+        TextureContainer::write(texture, texture_path);
+        image.path = texture_path;
+        image.format = texture.format;
+        image.bytes.clear();
+    }
+
+    return stats;
+}
+
+auto main(i32 argc, char** argv) -> i32 {
+    bool compress = true;
+    bool meshlets = true;
+    std::vector<std::string> paths = {};
+    for(i32 i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if(arg == "--uncompressed") { compress = false; }
+        else if(arg == "--no-meshlets") { meshlets = false; }
+        else { paths.emplace_back(arg); }
+    }
+
+    if(paths.empty() || paths.size() > 2) {
+        std::cerr << "usage: asset_cooker [--uncompressed] [--no-meshlets] <input.gltf> [output.cmodel]" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path input_path = paths[0];
+    std::filesystem::path output_path = input_path;
+    output_path.replace_extension(CookedModel::EXTENSION);
+    if(paths.size() == 2) { output_path = paths[1]; }
+
+    try {
+        ThreadPool pool(std::thread::hardware_concurrency());
+        auto start = std::chrono::steady_clock::now();
+        ModelData model = import_gltf_model(input_path, &pool);
+        if(meshlets) { build_model_meshlets(model, pool); }
+        auto imported = std::chrono::steady_clock::now();
+        TextureStats texture_stats = bake_images(model, output_path, compress, pool);
+        auto baked = std::chrono::steady_clock::now();
+        CookedModel::write(model, output_path);
+        auto written = std::chrono::steady_clock::now();
+
+        CookedModel cooked_model{output_path};
+        const auto& header = cooked_model.get_header();
+        std::cout << "cooked " << input_path.string() << " -> " << output_path.string() << '\n';
+        auto u16_primitive_count = std::count_if(cooked_model.get_primitives().begin(), cooked_model.get_primitives().end(), [](const Primitive& primitive) { return primitive.index_type_size == sizeof(u16); });
+        std::cout << "  vertices: " << header.vertex_count << ", indices: " << header.index_count << " (" << header.index_data_size / 1024 << " KiB, " << u16_primitive_count << "/" << header.primitive_count << " primitives 16 bit)" << '\n';
+        const auto& cache_stats = model.optimization_stats;
+        std::cout << "  vertex cache: acmr " << cache_stats.before.get_acmr() << " -> " << cache_stats.after.get_acmr() << ", atvr " << cache_stats.before.get_atvr() << " -> " << cache_stats.after.get_atvr() << '\n';
+        std::cout << "  primitives: " << header.primitive_count << ", lods: " << header.lod_count << ", meshlets: " << header.meshlet_count << ", materials: " << header.material_count << ", images: " << header.image_count << '\n';
+        std::cout << "  size: " << std::filesystem::file_size(output_path) / 1024 << " KiB" << '\n';
+        std::cout << "  textures: " << texture_stats.uncompressed_size / (1024 * 1024) << " MiB -> " << texture_stats.cooked_size / (1024 * 1024) << " MiB" << '\n';
+        std::cout << "  import: " << std::chrono::duration<f64, std::milli>(imported - start).count() << " ms, textures: " << std::chrono::duration<f64, std::milli>(baked - imported).count() << " ms, write: " << std::chrono::duration<f64, std::milli>(written - baked).count() << " ms" << std::endl;
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
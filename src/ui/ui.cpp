@@ -379,6 +379,15 @@ namespace GUI {
         return modified;
     }
 
+    auto bool_property(const char* label, bool &value, const char* tooltip) -> bool {
+        begin_property(label);
+        bool modified = ImGui::Checkbox(IDBuffer.data(), &value);
+        show_tooltip(tooltip);
+        end_property();
+
+        return modified;
+    }
+
     auto string_input(const char* label_ID, std::string &value, const ImGuiInputTextFlags input_flags) -> bool {
         std::memset(&buffer, 0, sizeof(buffer));
         std::memcpy(&buffer, value.c_str(), sizeof(buffer));
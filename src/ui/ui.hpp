@@ -36,6 +36,7 @@ namespace GUI {
     auto u64_property(const char* label, u64 &value, const char* tooltip = nullptr, ImGuiInputTextFlags input_flags = ImGuiInputTextFlags_None) -> bool;
     auto i32_property(const char* label, i32 &value, const char* tooltip = nullptr, ImGuiInputTextFlags input_flags = ImGuiInputTextFlags_None) -> bool;
     auto f32_property(const char* label, f32 &value, const char* tooltip = nullptr, ImGuiInputTextFlags input_flags = ImGuiInputTextFlags_None) -> bool;
+    auto bool_property(const char* label, bool &value, const char* tooltip = nullptr) -> bool;
     auto vec2_property(const char* label, glm::vec2 &value, const f32 *reset_values, const char** tooltips = nullptr) -> bool;
     auto vec3_property(const char* label, glm::vec3 &value, const f32 *reset_values, const char** tooltips = nullptr) -> bool;
 }
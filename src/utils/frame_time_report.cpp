@@ -0,0 +1,52 @@
+#include "frame_time_report.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+void FrameTimeReport::add_cpu_time(f64 time) {
+    cpu_times.push_back(time);
+}
+
+void FrameTimeReport::add_gpu_time(f64 time) {
+    gpu_times.push_back(time);
+}
+
+auto FrameTimeReport::compute_stats(std::vector<f64> samples) -> FrameTimeStats {
+    if(samples.empty()) { return {}; }
+    std::sort(samples.begin(), samples.end());
+
+    // nearest rank percentile
+    auto percentile = [&](f64 p) -> f64 {
+        usize rank = static_cast<usize>(std::ceil(p * static_cast<f64>(samples.size())));
+        return samples[std::clamp<usize>(rank, 1, samples.size()) - 1];
+    };
+
+    return FrameTimeStats {
+        .average = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<f64>(samples.size()),
+        .p50 = percentile(0.50),
+        .p95 = percentile(0.95),
+        .p99 = percentile(0.99),
+        .worst = samples.back(),
+    };
+}
+
+void FrameTimeReport::print(std::ostream& out) const {
+    auto print_stats = [&](const char* name, const std::vector<f64>& samples) {
+        FrameTimeStats stats = compute_stats(samples);
+        out << name << " (" << samples.size() << " frames) : avg " << stats.average << " ms, p50 " << stats.p50 << " ms, p95 " << stats.p95 << " ms, p99 " << stats.p99 << " ms, worst " << stats.worst << " ms\n";
+    };
+
+    print_stats("cpu", cpu_times);
+    print_stats("gpu", gpu_times);
+}
+
+void FrameTimeReport::write_json(std::ostream& out, const std::string& indent) const {
+    auto write_stats = [&](const char* name, const std::vector<f64>& samples, bool last) {
+        FrameTimeStats stats = compute_stats(samples);
+        out << indent << "\"" << name << "\": { \"frames\": " << samples.size() << ", \"avg_ms\": " << stats.average << ", \"p50_ms\": " << stats.p50 << ", \"p95_ms\": " << stats.p95 << ", \"p99_ms\": " << stats.p99 << ", \"worst_ms\": " << stats.worst << " }" << (last ? "\n" : ",\n");
+    };
+
+    write_stats("cpu", cpu_times, false);
+    write_stats("gpu", gpu_times, true);
+}
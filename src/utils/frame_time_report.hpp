@@ -0,0 +1,30 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct FrameTimeStats {
+    f64 average = {};
+    f64 p50 = {};
+    f64 p95 = {};
+    f64 p99 = {};
+    f64 worst = {};
+};
+
+// collects cpu and gpu frame times of a run and summarizes them as percentiles, all times are in milliseconds
+struct FrameTimeReport {
+    void add_cpu_time(f64 time);
+    void add_gpu_time(f64 time);
+
+    static auto compute_stats(std::vector<f64> samples) -> FrameTimeStats;
+
+    void print(std::ostream& out) const;
+    void write_json(std::ostream& out, const std::string& indent) const;
+
+    std::vector<f64> cpu_times = {};
+    std::vector<f64> gpu_times = {};
+};
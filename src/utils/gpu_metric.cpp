@@ -1,43 +1,119 @@
 #include "gpu_metric.hpp"
+#include "profiler.hpp"
 
-GPUMetricPool::GPUMetricPool(const daxa::Device& _device) : device{_device}, timeline_query_pool{device.create_timeline_query_pool(daxa::TimelineQueryPoolInfo {
-        .query_count = 2048,
+GPUMetricPool::GPUMetricPool(const daxa::Device& _device, u32 _frames_in_flight) : device{_device}, timeline_query_pool{device.create_timeline_query_pool(daxa::TimelineQueryPoolInfo {
+        .query_count = 2 * MAX_METRICS * _frames_in_flight,
         .name = "gpu metric pool"
-})}, timestamp_period(static_cast<f64>(device.properties().limits.timestamp_period)) {}
+})}, frames_in_flight{_frames_in_flight}, written_query_count(_frames_in_flight, 0), submit_times(_frames_in_flight, 0), written(_frames_in_flight, std::vector<bool>(MAX_METRICS, false)),
+    timestamp_period(static_cast<f64>(device.properties().limits.timestamp_period)) {
+
+    // queries have to be reset once before their results may be read, even when they end up unused
+    auto cmd_list = device.create_command_list({ .name = "gpu metric pool reset" });
+    cmd_list.reset_timestamps(daxa::ResetTimestampsInfo {
+        .query_pool = timeline_query_pool,
+        .start_index = 0,
+        .count = 2 * MAX_METRICS * frames_in_flight
+    });
+    cmd_list.complete();
+    device.submit_commands({ .command_lists = { std::move(cmd_list) }});
+}
 
 GPUMetricPool::~GPUMetricPool() {}
 
-GPUMetric::GPUMetric(GPUMetricPool* _gpu_metric_pool) : gpu_metric_pool{_gpu_metric_pool}, index{gpu_metric_pool->query_count} {
-    gpu_metric_pool->query_count += 2;
+auto GPUMetricPool::create_metric(const std::string& name) -> GPUMetricHandle {
+    if(auto it = metric_lookup.find(name); it != metric_lookup.end()) {
+        return GPUMetricHandle { .index = it->second };
+    }
+
+    if(metrics.size() >= MAX_METRICS) {
+        throw std::runtime_error("gpu metric pool is full, couldnt create metric: " + name);
+    }
+
+    u32 index = static_cast<u32>(metrics.size());
+    metrics.push_back(GPUMetric { .name = name, .time_elapsed = 0.0 });
+    metric_lookup[name] = index;
+    return GPUMetricHandle { .index = index };
+}
+
+auto GPUMetricPool::get_metric(const std::string& name) const -> GPUMetricHandle {
+    if(auto it = metric_lookup.find(name); it != metric_lookup.end()) {
+        return GPUMetricHandle { .index = it->second };
+    }
+
+    throw std::runtime_error("gpu metric hasnt been found: " + name);
+}
+
+void GPUMetricPool::begin_frame(u32 _frame_index) {
+    frame_index = _frame_index;
+
+    u32 query_count = written_query_count[frame_index];
+    if(query_count == 0) { return; }
+
+    // every query returns a value and availability pair
+    std::vector<u64> timestamps = timeline_query_pool.get_query_results(2 * MAX_METRICS * frame_index, query_count);
+
+    u64 first_timestamp = std::numeric_limits<u64>::max();
+    u64 last_timestamp = 0;
+    for(u32 i = 0; i < query_count / 2; i++) {
+        if(written[frame_index][i] && timestamps[4 * i + 1] != 0 && timestamps[4 * i + 3] != 0) {
+            first_timestamp = std::min(first_timestamp, timestamps[4 * i]);
+            last_timestamp = std::max(last_timestamp, timestamps[4 * i + 2]);
+        }
+    }
+
+    if(last_timestamp > first_timestamp) {
+        frame_time_elapsed = static_cast<f64>(last_timestamp - first_timestamp) * timestamp_period * 1e-6;
+    }
+
+    // there is no calibrated clock, so the gpu track is placed by lining up the first pass of the frame with its submission
+    bool profiling = Profiler::is_capturing();
+
+    for(u32 i = 0; i < query_count / 2; i++) {
+        if(!written[frame_index][i]) { continue; }
+        written[frame_index][i] = false;
+
+        if(timestamps[4 * i + 1] == 0 || timestamps[4 * i + 3] == 0) { continue; }
+        metrics[i].time_elapsed = static_cast<f64>(timestamps[4 * i + 2] - timestamps[4 * i]) * timestamp_period * 1e-6;
+
+        if(profiling) {
+            u64 start = submit_times[frame_index] + static_cast<u64>(static_cast<f64>(timestamps[4 * i] - first_timestamp) * timestamp_period);
+            u64 end = submit_times[frame_index] + static_cast<u64>(static_cast<f64>(timestamps[4 * i + 2] - first_timestamp) * timestamp_period);
+            Profiler::add_gpu_zone(metrics[i].name, start, end);
+        }
+    }
+
+    written_query_count[frame_index] = 0;
 }
 
-GPUMetric::~GPUMetric() {
-    gpu_metric_pool->query_count -= 2;
+void GPUMetricPool::end_frame() {
+    submit_times[frame_index] = Profiler::now();
 }
 
-void GPUMetric::start(daxa::CommandList& cmd_list) {
+void GPUMetricPool::start(daxa::CommandList& cmd_list, GPUMetricHandle handle) {
+    u32 query_index = 2 * MAX_METRICS * frame_index + 2 * handle.index;
+
     cmd_list.reset_timestamps(daxa::ResetTimestampsInfo {
-        .query_pool = gpu_metric_pool->timeline_query_pool,
-        .start_index = index,
+        .query_pool = timeline_query_pool,
+        .start_index = query_index,
         .count = 2
     });
 
     cmd_list.write_timestamp(daxa::WriteTimestampInfo {
-        .query_pool = gpu_metric_pool->timeline_query_pool,
+        .query_pool = timeline_query_pool,
         .pipeline_stage = daxa::PipelineStageFlagBits::TOP_OF_PIPE,
-        .query_index = index,
+        .query_index = query_index,
     });
 }
 
-void GPUMetric::end(daxa::CommandList& cmd_list) {
+void GPUMetricPool::end(daxa::CommandList& cmd_list, GPUMetricHandle handle) {
+    u32 query_index = 2 * MAX_METRICS * frame_index + 2 * handle.index;
+
     cmd_list.write_timestamp(daxa::WriteTimestampInfo {
-        .query_pool = gpu_metric_pool->timeline_query_pool,
+        .query_pool = timeline_query_pool,
         .pipeline_stage = daxa::PipelineStageFlagBits::BOTTOM_OF_PIPE,
-        .query_index = index + 1,
+        .query_index = query_index + 1,
     });
 
-    std::vector<u64> timestamps = gpu_metric_pool->timeline_query_pool.get_query_results(index, 2);
-
-    if(timestamps[1] == 0 || timestamps[3] == 0) { return; }
-    time_elapsed = static_cast<f64>(timestamps[2] - timestamps[0]) / gpu_metric_pool->timestamp_period * 1e-6;
-}
\ No newline at end of file
+    written[frame_index][handle.index] = true;
+    written_query_count[frame_index] = std::max(written_query_count[frame_index], 2 * handle.index + 2);
+}
@@ -3,28 +3,48 @@
 #include <daxa/daxa.hpp>
 using namespace daxa::types;
 
+#include <limits>
+#include <unordered_map>
+
+struct GPUMetricHandle {
+    u32 index = std::numeric_limits<u32>::max();
+};
+
+struct GPUMetric {
+    std::string name = {};
+    f64 time_elapsed = {};
+};
+
+// Every frame in flight owns its own range of queries. A range is read back in a single
+// non-blocking call when its frame slot comes around again, which is when the swapchain
+// throttling guarantees the GPU has retired the frame that wrote it.
 struct GPUMetricPool {
-    GPUMetricPool(const daxa::Device& _device);
+    static constexpr u32 MAX_METRICS = 512;
+
+    GPUMetricPool(const daxa::Device& _device, u32 _frames_in_flight);
     ~GPUMetricPool();
 
-private:
-    friend struct GPUMetric;
+    auto create_metric(const std::string& name) -> GPUMetricHandle;
+    auto get_metric(const std::string& name) const -> GPUMetricHandle;
 
-    daxa::Device device = {};
-    daxa::TimelineQueryPool timeline_query_pool = {};
-    u32 query_count = 0;
-    f64 timestamp_period = 0.0;
-};
+    void begin_frame(u32 _frame_index);
+    void end_frame();
 
-struct GPUMetric {
-    GPUMetric(GPUMetricPool* _gpu_metric_pool);
-    ~GPUMetric();
+    void start(daxa::CommandList& cmd_list, GPUMetricHandle handle);
+    void end(daxa::CommandList& cmd_list, GPUMetricHandle handle);
 
-    void start(daxa::CommandList& cmd_list);
-    void end(daxa::CommandList& cmd_list);
+    std::vector<GPUMetric> metrics = {};
+    // span from the first pass start to the last pass end of the most recently read back frame
+    f64 frame_time_elapsed = {};
 
-    f64 time_elapsed = {};
 private:
-    GPUMetricPool* gpu_metric_pool = {};
-    u32 index = 0;
-};
\ No newline at end of file
+    daxa::Device device = {};
+    daxa::TimelineQueryPool timeline_query_pool = {};
+    u32 frames_in_flight = 1;
+    u32 frame_index = 0;
+    std::vector<u32> written_query_count = {};
+    std::vector<u64> submit_times = {};
+    std::vector<std::vector<bool>> written = {};
+    std::unordered_map<std::string, u32> metric_lookup = {};
+    f64 timestamp_period = 0.0;
+};
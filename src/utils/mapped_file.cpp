@@ -0,0 +1,70 @@
+#include "mapped_file.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string_view& file_path) {
+    if(!std::filesystem::exists(file_path)) {
+        throw std::runtime_error("file hasnt been found: " + std::string{file_path});
+    }
+
+#if defined(_WIN32)
+    file_handle = CreateFileA(std::string{file_path}.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("couldnt open file: " + std::string{file_path});
+    }
+
+    LARGE_INTEGER file_size = {};
+    GetFileSizeEx(file_handle, &file_size);
+    mapped_size = static_cast<usize>(file_size.QuadPart);
+    if(mapped_size == 0) { return; }
+
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping_handle == nullptr) {
+        CloseHandle(file_handle);
+        throw std::runtime_error("couldnt map file: " + std::string{file_path});
+    }
+
+    mapped_data = static_cast<const u8*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+#else
+    file_descriptor = open(std::string{file_path}.c_str(), O_RDONLY);
+    if(file_descriptor == -1) {
+        throw std::runtime_error("couldnt open file: " + std::string{file_path});
+    }
+
+    struct stat file_stat = {};
+    fstat(file_descriptor, &file_stat);
+    mapped_size = static_cast<usize>(file_stat.st_size);
+    if(mapped_size == 0) { return; }
+
+    void* address = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if(address == MAP_FAILED) {
+        close(file_descriptor);
+        throw std::runtime_error("couldnt map file: " + std::string{file_path});
+    }
+
+    // the whole file is consumed front to back right away
+    madvise(address, mapped_size, MADV_SEQUENTIAL);
+    madvise(address, mapped_size, MADV_WILLNEED);
+    mapped_data = static_cast<const u8*>(address);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if defined(_WIN32)
+    if(mapped_data != nullptr) { UnmapViewOfFile(mapped_data); }
+    if(mapping_handle != nullptr) { CloseHandle(mapping_handle); }
+    if(file_handle != nullptr && file_handle != INVALID_HANDLE_VALUE) { CloseHandle(file_handle); }
+#else
+    if(mapped_data != nullptr) { munmap(const_cast<u8*>(mapped_data), mapped_size); }
+    if(file_descriptor != -1) { close(file_descriptor); }
+#endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pch.hpp"
+
+// read only view of a whole file mapped into the address space, pages are faulted in by the os on first touch
+struct MappedFile {
+    MappedFile(const std::string_view& file_path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+
+    [[nodiscard]] auto data() const -> const u8* { return mapped_data; }
+    [[nodiscard]] auto size() const -> usize { return mapped_size; }
+
+private:
+    const u8* mapped_data = {};
+    usize mapped_size = {};
+#if defined(_WIN32)
+    void* file_handle = {};
+    void* mapping_handle = {};
+#else
+    i32 file_descriptor = -1;
+#endif
+};
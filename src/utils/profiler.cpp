@@ -0,0 +1,254 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct ProfileZone {
+        std::string name = {};
+        u64 start_ns = {};
+        u64 end_ns = {};
+    };
+
+    struct ThreadData {
+        u32 id = {};
+        std::string name = {};
+        std::mutex mutex = {};
+        std::vector<ProfileZone> zones = {};
+        // only touched by the owning thread
+        std::vector<std::pair<const char*, u64>> open_zones = {};
+        // set under the registry lock once the owning thread exited during a capture, the entry goes with that capture
+        bool exited = {};
+    };
+
+    enum struct CaptureState : u32 {
+        Idle,
+        Pending,
+        Capturing,
+        Draining
+    };
+
+    // gpu results trail the cpu by the frames in flight, keep collecting them for a few frames after the cpu capture stops
+    constexpr u32 DRAIN_FRAME_COUNT = 4;
+
+    std::mutex registry_mutex = {};
+    std::vector<std::unique_ptr<ThreadData>> threads = {};
+    std::vector<ProfileZone> gpu_zones = {};
+    std::vector<u64> frame_starts = {};
+    CaptureState state = CaptureState::Idle;
+    u32 frames_left = 0;
+    u64 capture_start_ns = 0;
+    std::string capture_path = {};
+    u32 next_thread_id = 1;
+
+    // registers the thread on first use and drops its entry again when it exits, right away outside of a
+    // capture and after the capture is written otherwise, so the zones it recorded still end up in the file
+    struct LocalThread {
+        ThreadData* data = nullptr;
+
+        ~LocalThread() {
+            if(data == nullptr) { return; }
+            const std::scoped_lock lock(registry_mutex);
+            if(state == CaptureState::Capturing || state == CaptureState::Draining) {
+                data->exited = true;
+            } else {
+                std::erase_if(threads, [&](const std::unique_ptr<ThreadData>& thread) { return thread.get() == data; });
+            }
+        }
+    };
+
+    thread_local LocalThread local_thread = {};
+
+    auto get_thread_data() -> ThreadData* {
+        if(local_thread.data == nullptr) {
+            const std::scoped_lock lock(registry_mutex);
+            auto& data = threads.emplace_back(std::make_unique<ThreadData>());
+            data->id = next_thread_id++;
+            data->name = "thread " + std::to_string(data->id);
+            local_thread.data = data.get();
+        }
+
+        return local_thread.data;
+    }
+
+    auto escape(std::string_view text) -> std::string {
+        std::string result = {};
+        result.reserve(text.size());
+        for(char c : text) {
+            if(c == '"' || c == '\\') { result.push_back('\\'); }
+            result.push_back(c);
+        }
+        return result;
+    }
+
+    void write_event(std::ostream& out, bool& first, const std::string& name, u32 pid, u32 tid, u64 start_ns, u64 end_ns) {
+        if(!first) { out << ",\n"; }
+        first = false;
+
+        f64 ts = static_cast<f64>(start_ns - std::min(start_ns, capture_start_ns)) * 1e-3;
+        f64 dur = static_cast<f64>(end_ns - std::min(end_ns, start_ns)) * 1e-3;
+        out << R"({"name":")" << escape(name) << R"(","ph":"X","pid":)" << pid << R"(,"tid":)" << tid << R"(,"ts":)" << ts << R"(,"dur":)" << dur << "}";
+    }
+
+    void write_metadata(std::ostream& out, bool& first, const char* type, u32 pid, u32 tid, const std::string& name) {
+        if(!first) { out << ",\n"; }
+        first = false;
+
+        out << R"({"name":")" << type << R"(","ph":"M","pid":)" << pid << R"(,"tid":)" << tid << R"(,"args":{"name":")" << escape(name) << R"("}})";
+    }
+
+    // expects the registry lock to be held
+    void write_trace(std::ostream& out) {
+        bool first = true;
+        out << "{\"traceEvents\":[\n";
+
+        write_metadata(out, first, "process_name", 0, 0, "CPU");
+        write_metadata(out, first, "process_name", 1, 0, "GPU");
+        write_metadata(out, first, "thread_name", 0, 0, "frames");
+        write_metadata(out, first, "thread_name", 1, 0, "graphics queue");
+
+        for(auto& thread : threads) {
+            const std::scoped_lock thread_lock(thread->mutex);
+            write_metadata(out, first, "thread_name", 0, thread->id, thread->name);
+            for(auto& zone : thread->zones) {
+                write_event(out, first, zone.name, 0, thread->id, zone.start_ns, zone.end_ns);
+            }
+        }
+
+        for(usize i = 0; i + 1 < frame_starts.size(); i++) {
+            write_event(out, first, "frame " + std::to_string(i), 0, 0, frame_starts[i], frame_starts[i + 1]);
+        }
+
+        for(auto& zone : gpu_zones) {
+            write_event(out, first, zone.name, 1, 0, zone.start_ns, zone.end_ns);
+        }
+
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+}
+
+auto Profiler::now() -> u64 {
+    return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::set_thread_name(const std::string& name) {
+    ThreadData* data = get_thread_data();
+    const std::scoped_lock lock(data->mutex);
+    data->name = name;
+}
+
+void Profiler::capture_frames(u32 frame_count, const std::string& path) {
+    const std::scoped_lock lock(registry_mutex);
+    if(state != CaptureState::Idle) {
+        std::cout << "profiler capture is already running" << std::endl;
+        return;
+    }
+
+    state = CaptureState::Pending;
+    frames_left = std::max(frame_count, 1u);
+    capture_path = path;
+}
+
+auto Profiler::is_capturing() -> bool {
+    const std::scoped_lock lock(registry_mutex);
+    return state == CaptureState::Capturing || state == CaptureState::Draining;
+}
+
+void Profiler::new_frame() {
+    get_thread_data();
+
+    bool finished = false;
+    {
+        const std::scoped_lock lock(registry_mutex);
+        switch(state) {
+            case CaptureState::Idle: break;
+            case CaptureState::Pending: {
+                for(auto& thread : threads) {
+                    const std::scoped_lock thread_lock(thread->mutex);
+                    thread->zones.clear();
+                }
+                gpu_zones.clear();
+                frame_starts.clear();
+                capture_start_ns = now();
+                frame_starts.push_back(capture_start_ns);
+                state = CaptureState::Capturing;
+                capturing.store(true, std::memory_order_relaxed);
+                break;
+            }
+            case CaptureState::Capturing: {
+                frame_starts.push_back(now());
+                if(--frames_left == 0) {
+                    state = CaptureState::Draining;
+                    frames_left = DRAIN_FRAME_COUNT;
+                    capturing.store(false, std::memory_order_relaxed);
+                }
+                break;
+            }
+            case CaptureState::Draining: {
+                if(--frames_left == 0) {
+                    finished = true;
+                }
+                break;
+            }
+        }
+    }
+
+    if(finished) {
+        write_capture();
+    }
+}
+
+void Profiler::begin_zone(const char* name) {
+    get_thread_data()->open_zones.emplace_back(name, now());
+}
+
+void Profiler::end_zone() {
+    u64 end_ns = now();
+    ThreadData* data = get_thread_data();
+    if(data->open_zones.empty()) { return; }
+
+    auto [name, start_ns] = data->open_zones.back();
+    data->open_zones.pop_back();
+
+    const std::scoped_lock lock(data->mutex);
+    data->zones.push_back(ProfileZone { .name = name, .start_ns = start_ns, .end_ns = end_ns });
+}
+
+void Profiler::add_gpu_zone(const std::string& name, u64 start_ns, u64 end_ns) {
+    const std::scoped_lock lock(registry_mutex);
+    if(state != CaptureState::Capturing && state != CaptureState::Draining) { return; }
+    if(start_ns < capture_start_ns) { return; }
+
+    gpu_zones.push_back(ProfileZone { .name = name, .start_ns = start_ns, .end_ns = end_ns });
+}
+
+void Profiler::write_capture() {
+    const std::scoped_lock lock(registry_mutex);
+
+    // runs inside new_frame, a capture that cant be written is reported and dropped instead of taking the frame loop down
+    std::ofstream file(capture_path, std::ios::out | std::ios::trunc);
+    if(!file.is_open()) {
+        std::cerr << "couldnt open file: " << capture_path << ", profiler capture dropped" << std::endl;
+    } else {
+        write_trace(file);
+        if(file) {
+            std::cout << "profiler capture written to " << capture_path << std::endl;
+        } else {
+            std::cerr << "failed writing profiler capture: " << capture_path << std::endl;
+        }
+    }
+
+    for(auto& thread : threads) {
+        const std::scoped_lock thread_lock(thread->mutex);
+        thread->zones.clear();
+    }
+    gpu_zones.clear();
+    frame_starts.clear();
+    std::erase_if(threads, [](const std::unique_ptr<ThreadData>& thread) { return thread->exited; });
+    state = CaptureState::Idle;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+
+#include <atomic>
+#include <string>
+#include <string_view>
+
+// scoped cpu zones are only recorded while a capture is running, outside of a capture
+// a zone costs a single relaxed atomic load
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __COUNTER__){name}
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+
+struct Profiler {
+    static auto now() -> u64;
+
+    static void set_thread_name(const std::string& name);
+
+    // captures the next frame_count frames and writes them as chrome trace json
+    // (chrome://tracing or ui.perfetto.dev) once the last one has finished
+    static void capture_frames(u32 frame_count, const std::string& path);
+    static auto is_capturing() -> bool;
+
+    static void new_frame();
+
+    static void begin_zone(const char* name);
+    static void end_zone();
+    static void add_gpu_zone(const std::string& name, u64 start_ns, u64 end_ns);
+
+    static void write_capture();
+
+    static inline std::atomic<bool> capturing = false;
+};
+
+struct ProfileScope {
+    ProfileScope(const char* name) : active{Profiler::capturing.load(std::memory_order_relaxed)} {
+        if(active) { Profiler::begin_zone(name); }
+    }
+
+    ~ProfileScope() {
+        if(active) { Profiler::end_zone(); }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    auto operator=(const ProfileScope&) -> ProfileScope& = delete;
+
+    bool active = {};
+};
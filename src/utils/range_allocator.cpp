@@ -0,0 +1,68 @@
+#include "range_allocator.hpp"
+
+RangeAllocator::RangeAllocator(u64 _capacity) {
+    reset(_capacity, 0);
+}
+
+auto RangeAllocator::allocate(u64 size, u64 alignment) -> std::optional<u64> {
+    if(size == 0) { size = 1; }
+
+    for(auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+        u64 range_offset = it->first;
+        u64 range_size = it->second;
+        u64 aligned_offset = (range_offset + alignment - 1) / alignment * alignment;
+        if(aligned_offset + size > range_offset + range_size) { continue; }
+
+        // whatever is left in front of and behind the allocation stays free
+        free_ranges.erase(it);
+        if(aligned_offset > range_offset) {
+            free_ranges.emplace(range_offset, aligned_offset - range_offset);
+        }
+        if(aligned_offset + size < range_offset + range_size) {
+            free_ranges.emplace(aligned_offset + size, range_offset + range_size - aligned_offset - size);
+        }
+
+        used_size += size;
+        return aligned_offset;
+    }
+
+    return std::nullopt;
+}
+
+void RangeAllocator::free(u64 offset, u64 size) {
+    if(size == 0) { size = 1; }
+    used_size -= size;
+
+    auto next = free_ranges.lower_bound(offset);
+    if(next != free_ranges.end() && offset + size == next->first) {
+        size += next->second;
+        next = free_ranges.erase(next);
+    }
+
+    if(next != free_ranges.begin()) {
+        auto previous = std::prev(next);
+        if(previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+
+    free_ranges.emplace(offset, size);
+}
+
+void RangeAllocator::reset(u64 _capacity, u64 _used_size) {
+    capacity = _capacity;
+    used_size = _used_size;
+    free_ranges.clear();
+    if(used_size < capacity) {
+        free_ranges.emplace(used_size, capacity - used_size);
+    }
+}
+
+auto RangeAllocator::get_largest_free_range() const -> u64 {
+    u64 largest = 0;
+    for(const auto& [offset, size] : free_ranges) {
+        largest = std::max(largest, size);
+    }
+    return largest;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include <map>
+#include <optional>
+
+// first fit allocator over [0, capacity) in whatever unit the owner uses, neighbouring free ranges are merged when freed
+struct RangeAllocator {
+    RangeAllocator(u64 _capacity = 0);
+
+    auto allocate(u64 size, u64 alignment = 1) -> std::optional<u64>;
+    void free(u64 offset, u64 size);
+    // everything below used_size is allocated and the rest is one free range, used after the owner compacted its storage
+    void reset(u64 _capacity, u64 used_size);
+
+    [[nodiscard]] auto get_capacity() const -> u64 { return capacity; }
+    [[nodiscard]] auto get_used_size() const -> u64 { return used_size; }
+    [[nodiscard]] auto get_free_size() const -> u64 { return capacity - used_size; }
+    [[nodiscard]] auto get_largest_free_range() const -> u64;
+
+private:
+    u64 capacity = {};
+    u64 used_size = {};
+    std::map<u64, u64> free_ranges = {};
+};
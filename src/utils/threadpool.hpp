@@ -15,6 +15,8 @@
 #include <utility>           
 #include <vector>   
 
+#include "profiler.hpp"
+
 using concurrency_t = std::invoke_result_t<decltype(std::thread::hardware_concurrency)>;
 
 class ThreadPool {
@@ -99,6 +101,14 @@ public:
         this->waiting = false;
     }
 
+    // waits on just these futures, unlike wait_for_tasks it is safe to call from a worker. every future is waited on
+    // before the first exception is rethrown, since the tasks usually reference locals of the caller
+    template <typename R>
+    static void wait_for_futures(std::vector<std::future<R>>& futures) {
+        for (auto& future : futures) { future.wait(); }
+        for (auto& future : futures) { future.get(); }
+    }
+
     void reset(const concurrency_t thread_count_ = 0) {
         const bool was_paused = this->paused;
         this->paused = true;
@@ -114,7 +124,7 @@ private:
     void create_threads() {
         this->running = true;
         for (concurrency_t i = 0; i < this->thread_count; i++) {
-            this->threads[i] = std::thread(&ThreadPool::worker, this);
+            this->threads[i] = std::thread(&ThreadPool::worker, this, i);
         }
     }
 
@@ -138,7 +148,8 @@ private:
         }
     }
 
-    void worker() {
+    void worker(concurrency_t index) {
+        Profiler::set_thread_name("thread pool worker " + std::to_string(index));
         while (this->running) {
             std::function<void()> task;
             std::unique_lock<std::mutex> tasks_lock(this->tasks_mutex);
@@ -147,7 +158,10 @@ private:
                 task = std::move(this->tasks.front());
                 this->tasks.pop();
                 tasks_lock.unlock();
-                task();
+                {
+                    PROFILE_SCOPE("ThreadPool task");
+                    task();
+                }
                 tasks_lock.lock();
                 this->tasks_total--;
                 if (this->waiting) {